@@ -1,2 +0,0 @@
-@echo off
-for %%i in (*.vert *.frag *.rchit *.rgen *.rmiss) do glslangValidator.exe -V "%%~i" -o "%%~i.spv"
\ No newline at end of file
@@ -0,0 +1,117 @@
+#include "core/thread_pool.h"
+
+#include <algorithm>
+#include <exception>
+
+namespace estun
+{
+
+ThreadPool::ThreadPool(uint32_t threadCount)
+{
+    threadCount = std::max(threadCount, 1u);
+    for (uint32_t i = 0; i < threadCount; i++)
+    {
+        workers.emplace_back(&ThreadPool::Work, this);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    condition.notify_all();
+
+    for (auto &worker : workers)
+    {
+        worker.join();
+    }
+}
+
+std::future<void> ThreadPool::Submit(const std::function<void()> &task)
+{
+    std::packaged_task<void()> packagedTask(task);
+    std::future<void> future = packagedTask.get_future();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        tasks.push(std::move(packagedTask));
+    }
+    condition.notify_one();
+
+    return future;
+}
+
+void ThreadPool::ParallelFor(uint32_t count, uint32_t chunkSize, const std::function<void(uint32_t begin, uint32_t end)> &function)
+{
+    chunkSize = std::max(chunkSize, 1u);
+    if (count <= chunkSize)
+    {
+        function(0, count);
+        return;
+    }
+
+    // The calling thread takes the first chunk instead of idling on the futures
+    std::vector<std::future<void>> chunks;
+    for (uint32_t begin = chunkSize; begin < count; begin += chunkSize)
+    {
+        const uint32_t end = std::min(begin + chunkSize, count);
+        chunks.push_back(Submit([&function, begin, end]() { function(begin, end); }));
+    }
+
+    // Every chunk has to finish before returning, they reference the function, so the first
+    // exception is only rethrown once all of them are done
+    std::exception_ptr exception;
+    try
+    {
+        function(0, chunkSize);
+    }
+    catch (...)
+    {
+        exception = std::current_exception();
+    }
+
+    for (auto &chunk : chunks)
+    {
+        try
+        {
+            chunk.get();
+        }
+        catch (...)
+        {
+            if (exception == nullptr)
+            {
+                exception = std::current_exception();
+            }
+        }
+    }
+
+    if (exception != nullptr)
+    {
+        std::rethrow_exception(exception);
+    }
+}
+
+void ThreadPool::Work()
+{
+    while (true)
+    {
+        std::packaged_task<void()> task;
+
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            condition.wait(lock, [this]() { return stopping || !tasks.empty(); });
+            if (stopping && tasks.empty())
+            {
+                return;
+            }
+            task = std::move(tasks.front());
+            tasks.pop();
+        }
+
+        task();
+    }
+}
+
+} // namespace estun
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace estun
+{
+
+class ThreadPool
+{
+public:
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool(ThreadPool &&) = delete;
+
+    ThreadPool &operator=(const ThreadPool &) = delete;
+    ThreadPool &operator=(ThreadPool &&) = delete;
+
+    explicit ThreadPool(uint32_t threadCount = std::thread::hardware_concurrency());
+    ~ThreadPool();
+
+    std::future<void> Submit(const std::function<void()> &task);
+    // Calls function(begin, end) for consecutive ranges of at most chunkSize covering [0, count) and
+    // returns once all of them finished, rethrowing the first exception of any of them. Must not be
+    // called from a task of the same pool.
+    void ParallelFor(uint32_t count, uint32_t chunkSize, const std::function<void(uint32_t begin, uint32_t end)> &function);
+
+    uint32_t GetThreadCount() const { return static_cast<uint32_t>(workers.size()); }
+
+private:
+    void Work();
+
+    std::vector<std::thread> workers;
+    std::queue<std::packaged_task<void()>> tasks;
+
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool stopping = false;
+};
+
+} // namespace estun
@@ -101,8 +101,7 @@ estun::Window::Window(const WindowConfig &config) : config_(config)
 	glfwSetKeyCallback(window_, GlfwKeyCallback);
 	glfwSetCursorPosCallback(window_, GlfwCursorPositionCallback);
 	glfwSetMouseButtonCallback(window_, GlfwMouseButtonCallback);
-	glfwSetMouseButtonCallback(window_, GlfwMouseButtonCallback);
-	glfwSetMouseButtonCallback(window_, GlfwMouseButtonCallback);
+	glfwSetFramebufferSizeCallback(window_, GlfwFramebufferResizeCallback);
 }
 
 estun::Window::~Window()
@@ -1,5 +1,6 @@
 #include "renderer/renderer.h"
 #include "core/window.h"
 #include "core/core.h"
+#include "core/thread_pool.h"
 #include "core/camera.h"
 #include "includes/glm.h"
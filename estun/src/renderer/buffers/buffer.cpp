@@ -20,7 +20,9 @@ estun::Buffer::~Buffer()
 {
     if (buffer != nullptr)
     {
-        vkDestroyBuffer(DeviceLocator::GetLogicalDevice(), buffer, nullptr);
+        DeviceLocator::GetDevice().GetDeletionQueue().Push([handle = buffer]() {
+            vkDestroyBuffer(DeviceLocator::GetLogicalDevice(), handle, nullptr);
+        });
         buffer = nullptr;
     }
 }
@@ -42,18 +44,42 @@ VkMemoryRequirements estun::Buffer::GetMemoryRequirements() const
     return requirements;
 }
 
-void estun::Buffer::CopyFrom(const Buffer &src, VkDeviceSize size)
+void estun::Buffer::CopyFrom(const Buffer &src, VkDeviceSize size, VkDeviceSize srcOffset, VkDeviceSize dstOffset)
 {
-    SingleTimeCommands::SubmitTransfer(CommandPoolLocator::GetTransferPool(), [&](VkCommandBuffer commandBuffer) {
-        VkBufferCopy copyRegion = {};
-        copyRegion.srcOffset = 0;
-        copyRegion.dstOffset = 0;
-        copyRegion.size = size;
+    VkBufferCopy copyRegion = {};
+    copyRegion.srcOffset = srcOffset;
+    copyRegion.dstOffset = dstOffset;
+    copyRegion.size = size;
+
+    CopyFrom(src, std::vector<VkBufferCopy>{copyRegion});
+}
+
+void estun::Buffer::CopyFrom(const Buffer &src, const std::vector<VkBufferCopy> &regions)
+{
+    if (regions.empty())
+    {
+        return;
+    }
 
-        vkCmdCopyBuffer(commandBuffer, src.GetBuffer(), GetBuffer(), 1, &copyRegion);
+    SingleTimeCommands::SubmitTransfer(CommandPoolLocator::GetTransferPool(), [&](VkCommandBuffer commandBuffer) {
+        vkCmdCopyBuffer(commandBuffer, src.GetBuffer(), GetBuffer(), static_cast<uint32_t>(regions.size()), regions.data());
     });
 }
 
+void estun::Buffer::CopyFromStagingBuffer(const void *content, size_t contentSize, VkDeviceSize dstOffset)
+{
+    auto stagingBuffer = std::make_unique<Buffer>(contentSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
+    auto stagingBufferMemory = stagingBuffer->AllocateMemory(VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+    const auto data = stagingBufferMemory.Map(0, contentSize);
+    std::memcpy(data, content, contentSize);
+    stagingBufferMemory.Unmap();
+
+    CopyFrom(*stagingBuffer, contentSize, 0, dstOffset);
+
+    stagingBuffer.reset();
+}
+
 VkDeviceAddress estun::Buffer::GetDeviceAddress() const
 {
     VkBufferDeviceAddressInfo info;
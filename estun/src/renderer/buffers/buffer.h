@@ -24,25 +24,17 @@ public:
 	VkMemoryRequirements GetMemoryRequirements() const;
 	VkDeviceAddress GetDeviceAddress() const;
 
-	void CopyFrom(const Buffer &src, VkDeviceSize size);
+	void CopyFrom(const Buffer &src, VkDeviceSize size, VkDeviceSize srcOffset = 0, VkDeviceSize dstOffset = 0);
+	void CopyFrom(const Buffer &src, const std::vector<VkBufferCopy> &regions);
 
 	template <class T>
-	void CopyFromStagingBuffer(const std::vector<T> &content)
+	void CopyFromStagingBuffer(const std::vector<T> &content, VkDeviceSize dstOffset = 0)
 	{
-		const auto contentSize = sizeof(content[0]) * content.size();
-
-		auto stagingBuffer = std::make_unique<Buffer>(contentSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
-		auto stagingBufferMemory = stagingBuffer->AllocateMemory(VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
-		const auto data = stagingBufferMemory.Map(0, contentSize);
-		std::memcpy(data, content.data(), contentSize);
-		stagingBufferMemory.Unmap();
+		CopyFromStagingBuffer(content.data(), sizeof(content[0]) * content.size(), dstOffset);
+	}
 
-		CopyFrom(*stagingBuffer, contentSize);
+	void CopyFromStagingBuffer(const void *content, size_t contentSize, VkDeviceSize dstOffset = 0);
 
-		stagingBuffer.reset();
-	}
-	
     static void BufferMemoryBarrier(VkCommandBuffer commandBuffer, const Buffer &buffer, bool type);
 
 	VkBuffer GetBuffer() const;
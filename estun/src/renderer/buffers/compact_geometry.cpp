@@ -0,0 +1,306 @@
+#include "renderer/buffers/compact_geometry.h"
+#include "renderer/model.h"
+#include "core/core.h"
+
+namespace
+{
+    // Appends values narrowed to size bytes and pads the stream to a 4 byte boundary
+    uint32_t AppendPacked(std::vector<uint8_t> &bytes, const std::vector<uint32_t> &values, uint32_t size)
+    {
+        const uint32_t offset = static_cast<uint32_t>(bytes.size());
+        bytes.resize(offset + values.size() * size);
+
+        uint8_t *dst = bytes.data() + offset;
+        for (const uint32_t value : values)
+        {
+            if (size == sizeof(uint8_t))
+            {
+                *dst = static_cast<uint8_t>(value);
+            }
+            else if (size == sizeof(uint16_t))
+            {
+                const uint16_t value16 = static_cast<uint16_t>(value);
+                std::memcpy(dst, &value16, sizeof(value16));
+            }
+            else
+            {
+                std::memcpy(dst, &value, sizeof(value));
+            }
+            dst += size;
+        }
+
+        bytes.resize((bytes.size() + 3) & ~size_t(3));
+        return offset;
+    }
+
+    // Median splits along the longest axis of the centroid bounds until every cluster fits the config.
+    // Returns the triangle order with clusters stored contiguously and the size of each cluster.
+    std::vector<uint32_t> Partition(const estun::Model &model, const estun::ClusterConfig &config, std::vector<uint32_t> &clusterSizes)
+    {
+        const auto &vertices = model.GetVertices();
+        const auto &indices = model.GetIndices();
+        const uint32_t triangleCount = static_cast<uint32_t>(indices.size() / 3);
+
+        std::vector<uint32_t> order(triangleCount);
+        std::vector<glm::vec3> centroids(triangleCount);
+        for (uint32_t i = 0; i < triangleCount; i++)
+        {
+            order[i] = i;
+            centroids[i] = (vertices[indices[i * 3 + 0]].position +
+                            vertices[indices[i * 3 + 1]].position +
+                            vertices[indices[i * 3 + 2]].position) /
+                           3.0f;
+        }
+
+        std::vector<std::pair<uint32_t, uint32_t>> stack = {{0, triangleCount}};
+        std::vector<std::pair<uint32_t, uint32_t>> clusters;
+
+        while (!stack.empty())
+        {
+            const auto range = stack.back();
+            stack.pop_back();
+
+            glm::vec3 minBound(std::numeric_limits<float>::max());
+            glm::vec3 maxBound(std::numeric_limits<float>::lowest());
+            glm::vec3 minCentroid(std::numeric_limits<float>::max());
+            glm::vec3 maxCentroid(std::numeric_limits<float>::lowest());
+            for (uint32_t i = range.first; i < range.first + range.second; i++)
+            {
+                for (uint32_t k = 0; k < 3; k++)
+                {
+                    const glm::vec3 &position = vertices[indices[order[i] * 3 + k]].position;
+                    minBound = glm::min(minBound, position);
+                    maxBound = glm::max(maxBound, position);
+                }
+                minCentroid = glm::min(minCentroid, centroids[order[i]]);
+                maxCentroid = glm::max(maxCentroid, centroids[order[i]]);
+            }
+
+            const glm::vec3 extent = maxBound - minBound;
+            const bool fits = range.second <= config.maxTriangles && std::max(extent.x, std::max(extent.y, extent.z)) <= config.maxExtent;
+            // A single triangle can not be split any further, whatever its extent
+            if (fits || range.second <= std::max(config.minTriangles, 1u))
+            {
+                clusters.push_back(range);
+                continue;
+            }
+
+            const glm::vec3 centroidExtent = maxCentroid - minCentroid;
+            const int axis = centroidExtent.x > centroidExtent.y ? (centroidExtent.x > centroidExtent.z ? 0 : 2) : (centroidExtent.y > centroidExtent.z ? 1 : 2);
+
+            const auto first = order.begin() + range.first;
+            const auto middle = first + range.second / 2;
+            std::nth_element(first, middle, first + range.second, [&centroids, axis](uint32_t a, uint32_t b) {
+                return centroids[a][axis] < centroids[b][axis];
+            });
+
+            // Second half is pushed first so clusters come out in front to back order
+            stack.emplace_back(range.first + range.second / 2, range.second - range.second / 2);
+            stack.emplace_back(range.first, range.second / 2);
+        }
+
+        // Undo the shuffling of nth_element so the optimized triangle order survives inside a cluster
+        for (const auto &cluster : clusters)
+        {
+            std::sort(order.begin() + cluster.first, order.begin() + cluster.first + cluster.second);
+            clusterSizes.push_back(cluster.second);
+        }
+
+        return order;
+    }
+
+    // FNV-1a, bump the seed whenever the build flags or the packed layout change
+    const uint64_t hashSeed = 0xcbf29ce484222325ull ^ 1;
+
+    uint64_t Hash(const void *data, size_t size, uint64_t hash = hashSeed)
+    {
+        const uint8_t *bytes = static_cast<const uint8_t *>(data);
+        for (size_t i = 0; i < size; i++)
+        {
+            hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+        }
+        return hash;
+    }
+
+    std::vector<uint32_t> ToWords(const std::vector<uint8_t> &bytes)
+    {
+        // Storage buffers can not be empty
+        std::vector<uint32_t> words(std::max<size_t>(bytes.size() / sizeof(uint32_t), 1), 0);
+        std::memcpy(words.data(), bytes.data(), bytes.size());
+        return words;
+    }
+} // namespace
+
+estun::PackedModel estun::CompactGeometry::Pack(const Model &model, const ClusterConfig &config)
+{
+    PackedModel packed;
+
+    const uint32_t materialCount = static_cast<uint32_t>(model.GetMaterials().size());
+    if (materialCount > std::numeric_limits<uint16_t>::max() + 1u)
+    {
+        ES_CORE_ASSERT(std::string("Model '") + model.GetName() + std::string("' has too many materials for 16 bit material ids"));
+    }
+
+    std::vector<uint32_t> clusterSizes;
+    const std::vector<uint32_t> order = Partition(model, config, clusterSizes);
+
+    std::vector<uint32_t> modelIndices(order.size() * 3);
+    std::vector<uint32_t> modelMaterialIds(order.size());
+    for (size_t i = 0; i < order.size(); i++)
+    {
+        std::copy_n(model.GetIndices().begin() + order[i] * 3, 3, modelIndices.begin() + i * 3);
+        modelMaterialIds[i] = model.GetMaterialIds().empty() ? 0 : model.GetMaterialIds()[order[i]];
+    }
+
+    MeshOffsets offsets = {};
+    offsets.indexSize = model.SizeOfVertices() <= std::numeric_limits<uint16_t>::max() + 1u ? sizeof(uint16_t) : sizeof(uint32_t);
+    offsets.indexOffset = AppendPacked(packed.indices, modelIndices, offsets.indexSize);
+
+    // Single material meshes need no id stream at all
+    if (materialCount > 1)
+    {
+        offsets.materialIdSize = materialCount <= std::numeric_limits<uint8_t>::max() + 1u ? sizeof(uint8_t) : sizeof(uint16_t);
+        offsets.materialIdOffset = AppendPacked(packed.materialIds, modelMaterialIds, offsets.materialIdSize);
+    }
+
+    // Half of log2 of the uv area over the surface area, the texture size and the cone width are added in the shader
+    std::vector<uint32_t> lodConstants(order.size());
+    for (size_t i = 0; i < order.size(); i++)
+    {
+        const Vertex &v0 = model.GetVertices()[modelIndices[i * 3 + 0]];
+        const Vertex &v1 = model.GetVertices()[modelIndices[i * 3 + 1]];
+        const Vertex &v2 = model.GetVertices()[modelIndices[i * 3 + 2]];
+        const glm::vec2 uv1 = v1.texCoord - v0.texCoord;
+        const glm::vec2 uv2 = v2.texCoord - v0.texCoord;
+        const float uvArea = std::abs(uv1.x * uv2.y - uv1.y * uv2.x);
+        const float worldArea = glm::length(glm::cross(v1.position - v0.position, v2.position - v0.position));
+
+        const float lodConstant = uvArea > 0.0f && worldArea > 0.0f ? 0.5f * std::log2(uvArea / worldArea) : 0.0f;
+        lodConstants[i] = glm::packHalf1x16(glm::clamp(lodConstant, -32.0f, 32.0f));
+    }
+    offsets.lodOffset = AppendPacked(packed.materialIds, lodConstants, sizeof(uint16_t));
+
+    for (const auto &vertex : model.GetVertices())
+    {
+        packed.positions.push_back(vertex.position);
+        packed.attributes.push_back(CompactVertex::Pack(vertex));
+    }
+
+    const uint64_t positionsHash = Hash(packed.positions.data(), packed.positions.size() * sizeof(glm::vec3));
+
+    uint32_t firstTriangle = 0;
+    for (const uint32_t clusterSize : clusterSizes)
+    {
+        MeshOffsets clusterOffsets = offsets;
+        clusterOffsets.indexOffset += firstTriangle * 3 * offsets.indexSize;
+        clusterOffsets.materialIdOffset += firstTriangle * offsets.materialIdSize;
+        clusterOffsets.lodOffset += firstTriangle * sizeof(uint16_t);
+
+        uint64_t hash = Hash(packed.indices.data() + clusterOffsets.indexOffset, clusterSize * 3 * offsets.indexSize, positionsHash);
+        hash = Hash(&offsets.indexSize, sizeof(offsets.indexSize), hash);
+
+        packed.clusters.push_back(clusterOffsets);
+        packed.indexCounts.push_back(clusterSize * 3);
+        packed.hashes.push_back(hash);
+        firstTriangle += clusterSize;
+    }
+
+    if (clusterSizes.size() > 1)
+    {
+        ES_CORE_INFO("Split '{0}' into {1} clusters", model.GetName(), clusterSizes.size());
+    }
+
+    return packed;
+}
+
+estun::CompactGeometry::CompactGeometry(const std::vector<std::shared_ptr<Model>> &models, const ClusterConfig &config)
+{
+    std::vector<glm::vec3> positions;
+    std::vector<CompactVertex> attributes;
+    std::vector<uint8_t> indices;
+    std::vector<uint8_t> materialIds;
+    uint32_t materialOffset = 0;
+
+    for (const auto &model : models)
+    {
+        const PackedModel packed = Pack(*model, config);
+
+        for (size_t i = 0; i < packed.clusters.size(); i++)
+        {
+            MeshOffsets offsets = packed.clusters[i];
+            offsets.vertexOffset += static_cast<uint32_t>(positions.size());
+            offsets.indexOffset += static_cast<uint32_t>(indices.size());
+            offsets.materialIdOffset += static_cast<uint32_t>(materialIds.size());
+            offsets.lodOffset += static_cast<uint32_t>(materialIds.size());
+            offsets.materialOffset += materialOffset;
+
+            meshOffsets_.push_back(offsets);
+            vertexCounts_.push_back(static_cast<uint32_t>(packed.positions.size()));
+            indexCounts_.push_back(packed.indexCounts[i]);
+            hashes_.push_back(packed.hashes[i]);
+        }
+
+        positions.insert(positions.end(), packed.positions.begin(), packed.positions.end());
+        attributes.insert(attributes.end(), packed.attributes.begin(), packed.attributes.end());
+        indices.insert(indices.end(), packed.indices.begin(), packed.indices.end());
+        materialIds.insert(materialIds.end(), packed.materialIds.begin(), packed.materialIds.end());
+
+        materialOffset += static_cast<uint32_t>(model->GetMaterials().size());
+    }
+
+    const std::vector<uint32_t> indexWords = ToWords(indices);
+    const std::vector<uint32_t> materialIdWords = ToWords(materialIds);
+
+    const VkBufferUsageFlags usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
+    positionBuffer_ = std::make_shared<StorageBuffer<glm::vec3>>(positions, usage);
+    attributeBuffer_ = std::make_shared<StorageBuffer<CompactVertex>>(attributes, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+    indexBuffer_ = std::make_shared<StorageBuffer<uint32_t>>(indexWords, usage | VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+    materialIdBuffer_ = std::make_shared<StorageBuffer<uint32_t>>(materialIdWords, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+
+    positionsSize_ = positions.size() * sizeof(glm::vec3);
+    attributesSize_ = attributes.size() * sizeof(CompactVertex);
+    indicesSize_ = indexWords.size() * sizeof(uint32_t);
+    materialIdsSize_ = materialIdWords.size() * sizeof(uint32_t);
+
+    VkDeviceSize fullSize = 0;
+    for (const auto &model : models)
+    {
+        fullSize += model->GetVertices().size() * sizeof(Vertex) + model->GetIndices().size() * sizeof(uint32_t);
+    }
+    ES_CORE_INFO("Compact geometry: {0} bytes, {1} bytes with full vertices", GetSize(), fullSize);
+}
+
+estun::CompactGeometry::~CompactGeometry()
+{
+    positionBuffer_.reset();
+    attributeBuffer_.reset();
+    indexBuffer_.reset();
+    materialIdBuffer_.reset();
+}
+
+std::vector<estun::BLASGeometry> estun::CompactGeometry::GetBLASGeometries() const
+{
+    std::vector<BLASGeometry> geometries;
+
+    for (size_t i = 0; i < meshOffsets_.size(); i++)
+    {
+        BLASGeometry geometry = {};
+        geometry.vertexAddress = positionBuffer_->GetDeviceAddress();
+        geometry.vertexStride = sizeof(glm::vec3);
+        geometry.indexAddress = indexBuffer_->GetDeviceAddress();
+        geometry.indexType = meshOffsets_[i].indexSize == sizeof(uint16_t) ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+        geometry.vertexCount = vertexCounts_[i];
+        geometry.indexCount = indexCounts_[i];
+        geometry.vertexOffset = meshOffsets_[i].vertexOffset;
+        geometry.indexOffset = meshOffsets_[i].indexOffset;
+        geometry.hash = hashes_[i];
+        geometries.push_back(geometry);
+    }
+
+    return geometries;
+}
+
+VkDeviceSize estun::CompactGeometry::GetSize() const
+{
+    return positionsSize_ + attributesSize_ + indicesSize_ + materialIdsSize_;
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "renderer/common.h"
+#include "renderer/buffers/compact_vertex.h"
+#include "renderer/buffers/storage_buffer.h"
+#include "renderer/ray_tracing/bottom_level_acceleration_structure.h"
+
+namespace estun
+{
+
+    class Model;
+
+    // Matches MeshOffsets in main.rchit, offsets into index and material id buffers are in bytes
+    struct MeshOffsets
+    {
+        uint32_t indexOffset;
+        uint32_t vertexOffset;
+        uint32_t indexSize;
+        uint32_t materialOffset;
+        uint32_t materialIdOffset;
+        uint32_t materialIdSize;
+        // Per triangle ray cone LOD constants, half floats that follow the ids in the material id stream
+        uint32_t lodOffset;
+    };
+
+    // Meshes above either limit are split into spatial clusters with a BLAS each
+    struct ClusterConfig
+    {
+        uint32_t maxTriangles = std::numeric_limits<uint32_t>::max();
+        float maxExtent = std::numeric_limits<float>::max();
+        uint32_t minTriangles = 1024;
+    };
+
+    // Streams of a single model in the CompactGeometry layout, offsets are relative to the model.
+    // Index and material id streams are packed bytes padded to whole words, the material id stream
+    // carries every per triangle value.
+    struct PackedModel
+    {
+        std::vector<glm::vec3> positions;
+        std::vector<CompactVertex> attributes;
+        std::vector<uint8_t> indices;
+        std::vector<uint8_t> materialIds;
+        std::vector<MeshOffsets> clusters;
+        std::vector<uint32_t> indexCounts;
+        std::vector<uint64_t> hashes;
+    };
+
+    class CompactGeometry
+    {
+    public:
+        CompactGeometry(const CompactGeometry &) = delete;
+        CompactGeometry(CompactGeometry &&) = delete;
+        CompactGeometry &operator=(const CompactGeometry &) = delete;
+        CompactGeometry &operator=(CompactGeometry &&) = delete;
+
+        CompactGeometry(const std::vector<std::shared_ptr<Model>> &models, const ClusterConfig &config = ClusterConfig());
+        ~CompactGeometry();
+
+        static PackedModel Pack(const Model &model, const ClusterConfig &config);
+
+        // One entry per cluster, models that were not split own a single cluster
+        const std::vector<MeshOffsets> &GetMeshOffsets() const { return meshOffsets_; }
+        std::vector<BLASGeometry> GetBLASGeometries() const;
+
+        std::shared_ptr<StorageBuffer<glm::vec3>> GetPositionBuffer() { return positionBuffer_; }
+        std::shared_ptr<StorageBuffer<CompactVertex>> GetAttributeBuffer() { return attributeBuffer_; }
+        std::shared_ptr<StorageBuffer<uint32_t>> GetIndexBuffer() { return indexBuffer_; }
+        std::shared_ptr<StorageBuffer<uint32_t>> GetMaterialIdBuffer() { return materialIdBuffer_; }
+
+        VkDeviceSize GetSize() const;
+
+    private:
+        std::vector<MeshOffsets> meshOffsets_;
+        std::vector<uint32_t> vertexCounts_;
+        std::vector<uint32_t> indexCounts_;
+        std::vector<uint64_t> hashes_;
+
+        std::shared_ptr<StorageBuffer<glm::vec3>> positionBuffer_;
+        std::shared_ptr<StorageBuffer<CompactVertex>> attributeBuffer_;
+        std::shared_ptr<StorageBuffer<uint32_t>> indexBuffer_;
+        std::shared_ptr<StorageBuffer<uint32_t>> materialIdBuffer_;
+
+        VkDeviceSize positionsSize_ = 0;
+        VkDeviceSize attributesSize_ = 0;
+        VkDeviceSize indicesSize_ = 0;
+        VkDeviceSize materialIdsSize_ = 0;
+    };
+
+} // namespace estun
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "renderer/common.h"
+#include "renderer/buffers/vertex.h"
+
+#include "includes/glm.h"
+#include <glm/gtc/packing.hpp>
+
+namespace estun
+{
+
+    // Position lives in its own stream and materials are per triangle, see CompactGeometry
+    struct CompactVertex
+    {
+        uint32_t normal;
+        uint32_t texCoord;
+
+        static CompactVertex Pack(const Vertex &vertex)
+        {
+            CompactVertex compact;
+            compact.normal = glm::packSnorm2x16(OctEncode(vertex.normal));
+            compact.texCoord = glm::packHalf2x16(vertex.texCoord);
+            return compact;
+        }
+
+        static glm::vec2 OctEncode(glm::vec3 normal)
+        {
+            normal /= std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+            glm::vec2 encoded(normal.x, normal.y);
+            if (normal.z < 0.0f)
+            {
+                encoded.x = (1.0f - std::abs(normal.y)) * (normal.x >= 0.0f ? 1.0f : -1.0f);
+                encoded.y = (1.0f - std::abs(normal.x)) * (normal.y >= 0.0f ? 1.0f : -1.0f);
+            }
+            return encoded;
+        }
+    };
+
+} // namespace estun
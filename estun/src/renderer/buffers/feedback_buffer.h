@@ -0,0 +1,75 @@
+#pragma once
+
+#include "renderer/common.h"
+#include "renderer/material/descriptable.h"
+#include "renderer/buffers/buffer.h"
+#include "renderer/device_memory.h"
+
+namespace estun
+{
+
+    // Words written by shaders and read back by the host, stays mapped for its whole lifetime.
+    // Use one per swap chain image so the host never reads a buffer the current frame writes.
+    class FeedbackBuffer : public Descriptable
+    {
+    public:
+        FeedbackBuffer(const FeedbackBuffer &) = delete;
+        FeedbackBuffer &operator=(const FeedbackBuffer &) = delete;
+        FeedbackBuffer &operator=(FeedbackBuffer &&) = delete;
+
+        explicit FeedbackBuffer(size_t count)
+            : count_(count)
+        {
+            buffer_.reset(new Buffer(sizeof(uint32_t) * count, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT));
+            memory_.reset(new DeviceMemory(buffer_->AllocateMemory(VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)));
+            data_ = static_cast<uint32_t *>(memory_->Map(0, sizeof(uint32_t) * count));
+            Reset();
+        }
+
+        FeedbackBuffer(FeedbackBuffer &&other) noexcept
+            : buffer_(other.buffer_.release()),
+              memory_(other.memory_.release()),
+              data_(other.data_),
+              count_(other.count_)
+        {
+            other.data_ = nullptr;
+        }
+
+        ~FeedbackBuffer()
+        {
+            if (data_ != nullptr)
+            {
+                memory_->Unmap();
+            }
+            buffer_.reset();
+            memory_.reset();
+        }
+
+        DescriptableInfo GetInfo() override
+        {
+            VkDescriptorBufferInfo bufferInfo = {};
+            bufferInfo.buffer = buffer_->GetBuffer();
+            bufferInfo.range = VK_WHOLE_SIZE;
+
+            DescriptableInfo info;
+            info.bI = bufferInfo;
+
+            return info;
+        }
+
+        const uint32_t *GetData() const { return data_; }
+        size_t GetCount() const { return count_; }
+
+        void Reset()
+        {
+            std::memset(data_, 0, sizeof(uint32_t) * count_);
+        }
+
+    private:
+        std::unique_ptr<Buffer> buffer_;
+        std::unique_ptr<DeviceMemory> memory_;
+        uint32_t *data_ = nullptr;
+        size_t count_ = 0;
+    };
+
+} // namespace estun
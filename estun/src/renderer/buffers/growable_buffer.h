@@ -0,0 +1,60 @@
+#pragma once
+
+#include "renderer/common.h"
+#include "renderer/buffers/storage_buffer.h"
+
+namespace estun
+{
+
+    // Device local storage written in ranges, reallocating keeps the requested ranges but changes the
+    // buffer handle and device address, so descriptors and acceleration structure inputs must be refreshed
+    template <class T>
+    class GrowableBuffer : public StorageBuffer<T>
+    {
+    public:
+        GrowableBuffer(uint32_t capacity, VkBufferUsageFlags usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT)
+            : StorageBuffer<T>(std::max(capacity, 1u), usage | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT),
+              capacity_(std::max(capacity, 1u)),
+              usage_(usage | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT)
+        {
+        }
+
+        void Write(uint32_t offset, const void *data, uint32_t count)
+        {
+            if (count == 0)
+            {
+                return;
+            }
+            this->buffer->CopyFromStagingBuffer(data, sizeof(T) * count, sizeof(T) * offset);
+        }
+
+        // Regions are given in elements and copied from the old buffer into a new one of the given capacity
+        void Reallocate(uint32_t capacity, const std::vector<VkBufferCopy> &regions)
+        {
+            capacity_ = std::max(capacity, 1u);
+
+            std::unique_ptr<Buffer> buffer(new Buffer(sizeof(T) * capacity_, usage_));
+            std::unique_ptr<DeviceMemory> memory(new DeviceMemory(buffer->AllocateMemory(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, true)));
+
+            std::vector<VkBufferCopy> byteRegions;
+            for (const auto &region : regions)
+            {
+                if (region.size > 0)
+                {
+                    byteRegions.push_back({region.srcOffset * sizeof(T), region.dstOffset * sizeof(T), region.size * sizeof(T)});
+                }
+            }
+            buffer->CopyFrom(*this->buffer, byteRegions);
+
+            this->buffer = std::move(buffer);
+            this->memory = std::move(memory);
+        }
+
+        uint32_t GetCapacity() const { return capacity_; }
+
+    private:
+        uint32_t capacity_;
+        VkBufferUsageFlags usage_;
+    };
+
+} // namespace estun
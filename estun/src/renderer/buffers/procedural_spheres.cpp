@@ -0,0 +1,57 @@
+#include "renderer/buffers/procedural_spheres.h"
+#include "core/core.h"
+
+estun::ProceduralSpheres::ProceduralSpheres(const std::vector<Sphere> &spheres, const std::vector<uint32_t> &materialIndices, uint32_t hitGroup)
+    : count_(static_cast<uint32_t>(spheres.size())),
+      hitGroup_(hitGroup)
+{
+    if (spheres.empty() || materialIndices.size() != spheres.size())
+    {
+        ES_CORE_ASSERT("Procedural spheres need one material index per sphere");
+    }
+
+    std::vector<VkAabbPositionsKHR> aabbs(spheres.size());
+    for (size_t i = 0; i < spheres.size(); i++)
+    {
+        const glm::vec3 minBound = spheres[i].center - glm::vec3(spheres[i].radius);
+        const glm::vec3 maxBound = spheres[i].center + glm::vec3(spheres[i].radius);
+        aabbs[i] = VkAabbPositionsKHR{minBound.x, minBound.y, minBound.z, maxBound.x, maxBound.y, maxBound.z};
+    }
+
+    aabbBuffer_ = std::make_shared<StorageBuffer<VkAabbPositionsKHR>>(aabbs, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT);
+    sphereBuffer_ = std::make_shared<StorageBuffer<Sphere>>(spheres);
+    materialIndexBuffer_ = std::make_shared<StorageBuffer<uint32_t>>(materialIndices);
+}
+
+estun::ProceduralSpheres::~ProceduralSpheres()
+{
+    aabbBuffer_.reset();
+    sphereBuffer_.reset();
+    materialIndexBuffer_.reset();
+}
+
+estun::BLASProcedural estun::ProceduralSpheres::GetBLASGeometry() const
+{
+    if (aabbBuffer_ == nullptr)
+    {
+        ES_CORE_ASSERT("Sphere boxes were already released");
+    }
+
+    BLASProcedural procedural = {};
+    procedural.aabbAddress = aabbBuffer_->GetDeviceAddress();
+    procedural.aabbCount = count_;
+    procedural.aabbOffset = 0;
+    procedural.hitGroup = hitGroup_;
+    return procedural;
+}
+
+void estun::ProceduralSpheres::ReleaseAabbs()
+{
+    aabbBuffer_.reset();
+}
+
+VkDeviceSize estun::ProceduralSpheres::GetSize() const
+{
+    const VkDeviceSize aabbsSize = aabbBuffer_ != nullptr ? count_ * sizeof(VkAabbPositionsKHR) : 0;
+    return aabbsSize + count_ * (sizeof(Sphere) + sizeof(uint32_t));
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "renderer/common.h"
+#include "renderer/buffers/storage_buffer.h"
+#include "renderer/ray_tracing/bottom_level_acceleration_structure.h"
+
+namespace estun
+{
+
+    // Matches the Spheres buffer in sphere.rint and sphere.rchit
+    struct Sphere
+    {
+        glm::vec3 center;
+        float radius;
+    };
+
+    // Analytic spheres traced through an intersection shader instead of tessellated meshes,
+    // every sphere costs one box for the build plus its parameters and material index
+    class ProceduralSpheres
+    {
+    public:
+        ProceduralSpheres(const ProceduralSpheres &) = delete;
+        ProceduralSpheres(ProceduralSpheres &&) = delete;
+        ProceduralSpheres &operator=(const ProceduralSpheres &) = delete;
+        ProceduralSpheres &operator=(ProceduralSpheres &&) = delete;
+
+        // Material indices point straight into the shared material buffer
+        ProceduralSpheres(const std::vector<Sphere> &spheres, const std::vector<uint32_t> &materialIndices, uint32_t hitGroup);
+        ~ProceduralSpheres();
+
+        BLASProcedural GetBLASGeometry() const;
+
+        // Boxes are only read by builds, drop them once the BLAS exists and will not be rebuilt
+        void ReleaseAabbs();
+
+        std::shared_ptr<StorageBuffer<Sphere>> GetSphereBuffer() { return sphereBuffer_; }
+        std::shared_ptr<StorageBuffer<uint32_t>> GetMaterialIndexBuffer() { return materialIndexBuffer_; }
+
+        uint32_t GetCount() const { return count_; }
+        VkDeviceSize GetSize() const;
+
+    private:
+        uint32_t count_;
+        uint32_t hitGroup_;
+
+        std::shared_ptr<StorageBuffer<VkAabbPositionsKHR>> aabbBuffer_;
+        std::shared_ptr<StorageBuffer<Sphere>> sphereBuffer_;
+        std::shared_ptr<StorageBuffer<uint32_t>> materialIndexBuffer_;
+    };
+
+} // namespace estun
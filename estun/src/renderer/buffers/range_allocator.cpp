@@ -0,0 +1,105 @@
+#include "renderer/buffers/range_allocator.h"
+#include "core/core.h"
+
+estun::RangeAllocator::RangeAllocator(uint32_t capacity)
+    : capacity_(0)
+{
+    Grow(capacity);
+}
+
+uint32_t estun::RangeAllocator::Allocate(uint32_t size)
+{
+    for (auto it = freeRanges_.begin(); it != freeRanges_.end(); ++it)
+    {
+        if (it->second < size)
+        {
+            continue;
+        }
+
+        const uint32_t offset = it->first;
+        const uint32_t remaining = it->second - size;
+        freeRanges_.erase(it);
+        if (remaining > 0)
+        {
+            freeRanges_.emplace(offset + size, remaining);
+        }
+
+        used_ += size;
+        return offset;
+    }
+
+    return InvalidOffset;
+}
+
+void estun::RangeAllocator::Free(uint32_t offset, uint32_t size)
+{
+    if (size == 0)
+    {
+        return;
+    }
+
+    auto next = freeRanges_.lower_bound(offset);
+    if (next != freeRanges_.end() && next->first < offset + size)
+    {
+        ES_CORE_ASSERT("Freed range overlaps a free range");
+        return;
+    }
+
+    used_ -= size;
+
+    if (next != freeRanges_.end() && next->first == offset + size)
+    {
+        size += next->second;
+        next = freeRanges_.erase(next);
+    }
+
+    if (next != freeRanges_.begin())
+    {
+        auto previous = std::prev(next);
+        if (previous->first + previous->second == offset)
+        {
+            previous->second += size;
+            return;
+        }
+    }
+
+    freeRanges_.emplace(offset, size);
+}
+
+void estun::RangeAllocator::Grow(uint32_t capacity)
+{
+    if (capacity <= capacity_)
+    {
+        return;
+    }
+
+    const uint32_t oldCapacity = capacity_;
+    capacity_ = capacity;
+    used_ += capacity - oldCapacity;
+    Free(oldCapacity, capacity - oldCapacity);
+}
+
+void estun::RangeAllocator::Reset(uint32_t capacity, uint32_t used)
+{
+    capacity_ = capacity;
+    used_ = used;
+    freeRanges_.clear();
+    if (used < capacity)
+    {
+        freeRanges_.emplace(used, capacity - used);
+    }
+}
+
+uint32_t estun::RangeAllocator::GetFragmented() const
+{
+    uint32_t fragmented = capacity_ - used_;
+    if (!freeRanges_.empty())
+    {
+        const auto &tail = *freeRanges_.rbegin();
+        if (tail.first + tail.second == capacity_)
+        {
+            fragmented -= tail.second;
+        }
+    }
+    return fragmented;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "renderer/common.h"
+
+#include <limits>
+
+namespace estun
+{
+
+    // First fit allocator over an abstract range of elements, freed ranges are merged with their neighbours
+    class RangeAllocator
+    {
+    public:
+        static const uint32_t InvalidOffset = std::numeric_limits<uint32_t>::max();
+
+        explicit RangeAllocator(uint32_t capacity = 0);
+
+        // Returns InvalidOffset when no free range is large enough, Grow and try again
+        uint32_t Allocate(uint32_t size);
+        void Free(uint32_t offset, uint32_t size);
+
+        // Appends the new space as a free range
+        void Grow(uint32_t capacity);
+        // Forgets every allocation and marks [0, used) as allocated, used after a compaction
+        void Reset(uint32_t capacity, uint32_t used);
+
+        uint32_t GetCapacity() const { return capacity_; }
+        uint32_t GetUsed() const { return used_; }
+        // Free elements that are not part of the tail, i.e. space only a compaction can return
+        uint32_t GetFragmented() const;
+
+    private:
+        uint32_t capacity_;
+        uint32_t used_ = 0;
+        std::map<uint32_t, uint32_t> freeRanges_;
+    };
+
+} // namespace estun
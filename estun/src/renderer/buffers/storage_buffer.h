@@ -68,6 +68,13 @@ namespace estun
         }
 
     protected:
+        // Uninitialized storage for derived buffers that upload on their own
+        StorageBuffer(size_t count, VkBufferUsageFlags usage)
+        {
+            buffer.reset(new Buffer(sizeof(T) * count, usage));
+            memory.reset(new DeviceMemory(buffer->AllocateMemory(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, true)));
+        }
+
         std::unique_ptr<Buffer> buffer;
         std::unique_ptr<DeviceMemory> memory;
     };
@@ -85,6 +92,14 @@ namespace estun
         }
     };
 
+    // Device local TLAS instances written by transfers and compute shaders
+    class InstanceBuffer : public StorageBuffer<VkAccelerationStructureInstanceKHR>
+    {
+    public:
+        InstanceBuffer(size_t count)
+            : StorageBuffer(count, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT) {}
+    };
+
     class IndexBuffer : public StorageBuffer<uint32_t>
     {
     public:
@@ -17,9 +17,10 @@ estun::ComputeRender::~ComputeRender()
 
 std::shared_ptr<estun::ComputePipeline> estun::ComputeRender::CreatePipeline(
     const std::string computeShaderName,
-    const std::shared_ptr<Descriptor> descriptor)
+    const std::shared_ptr<Descriptor> descriptor,
+    const SpecializationConstants &constants)
 {
-    std::shared_ptr<ComputePipeline> pipeline = std::make_shared<ComputePipeline>(computeShaderName, descriptor);
+    std::shared_ptr<ComputePipeline> pipeline = std::make_shared<ComputePipeline>(computeShaderName, descriptor, constants);
     pipelines_.push_back(pipeline);
     return pipeline;
 }
@@ -58,21 +59,21 @@ void estun::ComputeRender::CopyImage(std::shared_ptr<Image> image1, std::shared_
 {
     image1->Barrier(
         GetCurrCommandBuffer(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-        VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_SHADER_READ_BIT,
-        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+        VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
     image2->Barrier(
         GetCurrCommandBuffer(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-        VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_SHADER_READ_BIT,
-        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+        VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
     image1->CopyTo(GetCurrCommandBuffer(), image2);
     image1->Barrier(
         GetCurrCommandBuffer(), VK_IMAGE_LAYOUT_GENERAL,
-        VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_SHADER_READ_BIT,
-        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+        0, VK_ACCESS_SHADER_WRITE_BIT,
+        VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
     image2->Barrier(
         GetCurrCommandBuffer(), VK_IMAGE_LAYOUT_GENERAL,
-        VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_SHADER_READ_BIT,
-        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+        VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+        VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
 }
 
 void estun::ComputeRender::ComputeMemoryBarrier()
@@ -37,7 +37,8 @@ namespace estun
 
         std::shared_ptr<ComputePipeline> CreatePipeline(
             const std::string computeShaderName,
-            const std::shared_ptr<Descriptor> descriptor);
+            const std::shared_ptr<Descriptor> descriptor,
+            const SpecializationConstants &constants = SpecializationConstants());
 
         template <class T>
         void Bind(PushConstant<T> &pushConstant, std::shared_ptr<Descriptor> descriptor)
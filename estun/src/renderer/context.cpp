@@ -55,8 +55,21 @@ estun::Context::~Context()
 void estun::Context::CreateSwapChain()
 {
     swapChain_.reset(new SwapChain(surface_.get(), gameInfo_->width_, gameInfo_->height_, gameInfo_->vsync_));
+    imageFrames_.assign(swapChain_->GetImages().size(), std::numeric_limits<uint32_t>::max());
     ES_CORE_INFO("Swap chain done");
 
+    CreateSyncObjects();
+    ES_CORE_INFO("Semaphores done");
+}
+
+void estun::Context::DeleteSwapChain()
+{
+    DeleteSyncObjects();
+    swapChain_.reset();
+}
+
+void estun::Context::CreateSyncObjects()
+{
     for (size_t i = 0; i != swapChain_->GetImageViews().size(); ++i)
     {
         imageAvailableSemaphores_.emplace_back();
@@ -64,38 +77,97 @@ void estun::Context::CreateSwapChain()
         computeFinishedSemaphores_.emplace_back();
         rayTracingFinishedSemaphores_.emplace_back();
         inFlightFences_.emplace_back(true);
+        inFlightFrames_.push_back(0);
     }
-    ES_CORE_INFO("Semaphores done");
 }
 
-void estun::Context::DeleteSwapChain()
+void estun::Context::DeleteSyncObjects()
 {
     inFlightFences_.clear();
+    inFlightFrames_.clear();
     renderFinishedSemaphores_.clear();
     imageAvailableSemaphores_.clear();
     computeFinishedSemaphores_.clear();
     rayTracingFinishedSemaphores_.clear();
-    swapChain_.reset();
 }
 
 void estun::Context::RecreateSwapChain()
 {
-    device_->WaitIdle();
-    DeleteSwapChain();
-    CreateSwapChain();
+    WaitFrames();
+    resizePending_ = false;
+
+    const VkFormat format = swapChain_->GetFormat();
+    const size_t imageCount = swapChain_->GetImages().size();
+
+    // The old swap chain goes through the deletion queue once the new one took over its surface
+    std::unique_ptr<SwapChain> oldSwapChain = std::move(swapChain_);
+    swapChain_.reset(new SwapChain(surface_.get(), gameInfo_->width_, gameInfo_->height_, gameInfo_->vsync_, oldSwapChain.get()));
+    oldSwapChain.reset();
+
+    // Semaphores and fences belong to the frames in flight, not to the images, so they outlive the swap chain.
+    // A StartDraw retrying its acquire still holds them. Everything else made per image has the old count,
+    // the application creates it again after ClearFrames.
+    if (swapChain_->GetImages().size() != imageCount)
+    {
+        ES_CORE_WARN(std::string("Swap chain image count changed from ") + std::to_string(imageCount) + std::string(" to ") + std::to_string(swapChain_->GetImages().size()));
+        imageCountChanged_ = true;
+        return;
+    }
+
     for (auto &render : graphicsRenders_)
     {
-        render->Recreate();
+        if (swapChain_->GetFormat() != format)
+        {
+            render->Recreate();
+        }
+        else
+        {
+            render->Resize();
+        }
+    }
+
+    const VkExtent2D extent = swapChain_->GetExtent();
+    for (auto &listener : resizeListeners_)
+    {
+        listener.second(extent);
     }
 }
 
 void estun::Context::Clear()
+{
+    ClearFrames();
+    DeleteSwapChain();
+    device_->GetDeletionQueue().Flush();
+}
+
+void estun::Context::ClearFrames()
 {
     device_->WaitIdle();
+    resizeListeners_.clear();
     graphicsRenders_.clear();
     computeRenders_.clear();
     rayTracingRenders_.clear();
-    DeleteSwapChain();
+    imageFrames_.assign(swapChain_->GetImages().size(), std::numeric_limits<uint32_t>::max());
+    imageIndex_ = 0;
+    imageCountChanged_ = false;
+}
+
+void estun::Context::Resize(uint32_t width, uint32_t height)
+{
+    gameInfo_->width_ = width;
+    gameInfo_->height_ = height;
+    resizePending_ = true;
+}
+
+uint32_t estun::Context::AddResizeListener(std::function<void(const VkExtent2D &)> listener)
+{
+    resizeListeners_.insert(std::make_pair(nextResizeListener_, std::move(listener)));
+    return nextResizeListener_++;
+}
+
+void estun::Context::RemoveResizeListener(uint32_t id)
+{
+    resizeListeners_.erase(id);
 }
 
 std::shared_ptr<estun::GraphicsRender> estun::Context::CreateGraphicsRender(bool toDefault)
@@ -123,30 +195,6 @@ void estun::Context::CopyImageToSwapChain(
     VkCommandBuffer &commandBuffer,
     std::shared_ptr<Image> image)
 {
-    image->Barrier(
-        commandBuffer, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-        VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT,
-        VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
-
-    VkImageMemoryBarrier barrier1 = {};
-    barrier1.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-    barrier1.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    barrier1.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-    barrier1.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    barrier1.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    barrier1.image = swapChain_->GetImages()[imageIndex_];
-    barrier1.subresourceRange.baseMipLevel = 0;
-    barrier1.subresourceRange.levelCount = 1;
-    barrier1.subresourceRange.baseArrayLayer = 0;
-    barrier1.subresourceRange.layerCount = 1;
-    barrier1.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    barrier1.srcAccessMask = 0;
-    barrier1.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-
-    auto sourceStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
-    auto destinationStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
-    vkCmdPipelineBarrier(commandBuffer, sourceStage, destinationStage, 0, 0, nullptr, 0, nullptr, 1, &barrier1);
-    
     VkImageCopy imageCopy = {};
     imageCopy.srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
     imageCopy.srcOffset = {0, 0, 0};
@@ -156,65 +204,102 @@ void estun::Context::CopyImageToSwapChain(
 
     vkCmdCopyImage(
         commandBuffer,
-        image->GetImage().GetImage(), image->GetLayout(),
+        image->GetImage().GetImage(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
         swapChain_->GetImages()[imageIndex_], VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
         1, &imageCopy);
-
-    image->Barrier(
-        commandBuffer, VK_IMAGE_LAYOUT_GENERAL,
-        0, VK_ACCESS_SHADER_WRITE_BIT,
-        VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
-
-    VkImageMemoryBarrier barrier = {};
-    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-    barrier.newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    barrier.image = swapChain_->GetImages()[imageIndex_];
-    barrier.subresourceRange.baseMipLevel = 0;
-    barrier.subresourceRange.levelCount = 1;
-    barrier.subresourceRange.baseArrayLayer = 0;
-    barrier.subresourceRange.layerCount = 1;
-    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    barrier.srcAccessMask = 0;
-    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-
-    sourceStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
-    destinationStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
-    vkCmdPipelineBarrier(commandBuffer, sourceStage, destinationStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
 }
 
 void estun::Context::WriteBuffers(const std::function<void()> &action)
 {
+    // Keep the acquired image, buffers may be written again between StartDraw and SubmitDraw
+    const uint32_t imageIndex = imageIndex_;
     for (imageIndex_ = 0; imageIndex_ < swapChain_->GetImages().size(); imageIndex_++)
     {
         action();
     }
-    imageIndex_ = 0;
+    imageIndex_ = imageIndex;
+}
+
+void estun::Context::RewriteBuffers(const std::function<void()> &action)
+{
+    WaitFrames();
+    WriteBuffers(action);
+}
+
+void estun::Context::WaitFrames()
+{
+    const auto noTimeout = std::numeric_limits<uint64_t>::max();
+
+    // Every frame ends with the graphics submission, its fence covers the compute and ray tracing work too
+    for (const auto &fence : inFlightFences_)
+    {
+        fence.Wait(noTimeout);
+    }
+    CollectDeletions();
+}
+
+void estun::Context::CollectDeletions()
+{
+    DeletionQueue &deletionQueue = device_->GetDeletionQueue();
+
+    // Fences are polled, frames may finish out of order across the queues they use
+    uint64_t oldestPendingFrame = deletionQueue.GetSubmittedFrames();
+    for (size_t i = 0; i < inFlightFences_.size(); i++)
+    {
+        if (inFlightFrames_[i] < oldestPendingFrame && !inFlightFences_[i].IsSignaled())
+        {
+            oldestPendingFrame = inFlightFrames_[i];
+        }
+    }
+    deletionQueue.Collect(oldestPendingFrame);
 }
 
-void estun::Context::StartDraw()
+bool estun::Context::StartDraw()
 {
     const auto noTimeout = std::numeric_limits<uint64_t>::max();
 
+    if (imageCountChanged_)
+    {
+        return false;
+    }
+
     auto &inFlightFence = inFlightFences_[currentFrame_];
     const auto imageAvailableSemaphore = imageAvailableSemaphores_[currentFrame_].GetSemaphore();
 
     inFlightFence.Wait(noTimeout);
+    CollectDeletions();
 
     auto result = vkAcquireNextImageKHR(device_->GetLogicalDevice(), swapChain_->GetSwapChain(), noTimeout, imageAvailableSemaphore, nullptr, &imageIndex_);
 
-    if (result == VK_ERROR_OUT_OF_DATE_KHR)
+    // A failed acquire leaves the semaphore unsignaled, the frame goes on with an image of the new swap chain
+    while (result == VK_ERROR_OUT_OF_DATE_KHR)
     {
         RecreateSwapChain();
-        return;
+        if (imageCountChanged_)
+        {
+            return false;
+        }
+        result = vkAcquireNextImageKHR(device_->GetLogicalDevice(), swapChain_->GetSwapChain(), noTimeout, imageAvailableSemaphore, nullptr, &imageIndex_);
+    }
+
+    if (result == VK_SUBOPTIMAL_KHR)
+    {
+        resizePending_ = true;
     }
 
     if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR)
     {
         ES_CORE_ASSERT(std::string("Failed to acquire next image (") + std::string(")"));
     }
+
+    // Images come back in any order, the frame that drew this one last may still run on another fence
+    const uint32_t imageFrame = imageFrames_[imageIndex_];
+    if (imageFrame != currentFrame_ && imageFrame < inFlightFences_.size())
+    {
+        inFlightFences_[imageFrame].Wait(noTimeout);
+    }
+    imageFrames_[imageIndex_] = currentFrame_;
+    return true;
 }
 
 void estun::Context::SubmitDraw()
@@ -295,6 +380,11 @@ void estun::Context::SubmitDraw()
 
     VK_CHECK_RESULT(vkQueueSubmit(device_->GetGraphicsQueue(), 1, &submitInfo, inFlightFence.GetFence()), "submit draw command buffers");
 
+    // Handles released from here on may be used by this frame
+    DeletionQueue &deletionQueue = device_->GetDeletionQueue();
+    inFlightFrames_[currentFrame_] = deletionQueue.GetSubmittedFrames();
+    deletionQueue.SetSubmittedFrames(inFlightFrames_[currentFrame_] + 1);
+
     VkSwapchainKHR swapChains[] = {swapChain_->GetSwapChain()};
     VkPresentInfoKHR presentInfo = {};
     presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
@@ -307,18 +397,18 @@ void estun::Context::SubmitDraw()
 
     auto result = vkQueuePresentKHR(device_->GetPresentQueue(), &presentInfo);
 
-    if (result == VK_ERROR_OUT_OF_DATE_KHR)
-    {
-        RecreateSwapChain();
-        return;
-    }
-
-    if (result != VK_SUCCESS)
+    if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR && result != VK_ERROR_OUT_OF_DATE_KHR)
     {
         ES_CORE_ASSERT(std::string("failed to present next image (") + std::string(")"));
     }
 
     currentFrame_ = (currentFrame_ + 1) % inFlightFences_.size();
+
+    // Some platforms never report out of date swap chains, the size reported by the window decides as well
+    if (result != VK_SUCCESS || resizePending_)
+    {
+        RecreateSwapChain();
+    }
 }
 
 estun::Context *estun::ContextLocator::currContext = nullptr;
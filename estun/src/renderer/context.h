@@ -60,8 +60,21 @@ namespace estun
         void DeleteSwapChain();
         void RecreateSwapChain();
         void Clear();
-
-        void StartDraw();
+        // Drops the renders and resize listeners but keeps the swap chain, for rebuilding everything that
+        // was created per image after the image count changed
+        void ClearFrames();
+
+        // The swap chain is replaced after the next present, the window only has to report its new size
+        void Resize(uint32_t width, uint32_t height);
+        // Called with the new extent once the swap chain was replaced and the frames in flight finished,
+        // size dependent images and the recorded command buffers are created again from here. Not called
+        // when the image count changed, StartDraw reports that instead.
+        uint32_t AddResizeListener(std::function<void(const VkExtent2D &)> listener);
+        void RemoveResizeListener(uint32_t id);
+
+        // False when the swap chain came back with a different image count, nothing was acquired then and
+        // the application has to call ClearFrames and create its per image resources again
+        bool StartDraw();
         //void EndDraw();
         void SubmitDraw();
 
@@ -72,7 +85,10 @@ namespace estun
         std::shared_ptr<RayTracingRender> CreateRayTracingRender();
 
         void WriteBuffers(const std::function<void()> &action);
+        void RewriteBuffers(const std::function<void()> &action);
 
+        // Expects the image as transfer source and the acquired image as transfer destination, the render
+        // graph places the transitions around it
         void CopyImageToSwapChain(
             VkCommandBuffer &commandBuffer, 
             std::shared_ptr<Image> image);
@@ -88,6 +104,13 @@ namespace estun
         uint32_t GetImageIndex() { return imageIndex_; }
 
     private:
+        void CreateSyncObjects();
+        void DeleteSyncObjects();
+        // Waits for the frames in flight only, other queue work such as uploads keeps running
+        void WaitFrames();
+        // Destroys the handles released before the oldest frame that is still in flight
+        void CollectDeletions();
+
         std::unique_ptr<Instance> instance_;
         std::unique_ptr<Surface> surface_;
         std::unique_ptr<Device> device_;
@@ -98,16 +121,27 @@ namespace estun
         std::unique_ptr<CommandPool> computeCommandPool_;
         std::unique_ptr<CommandPool> transferCommandPool_;
 
+        // One of each per frame in flight, created with the first swap chain and kept across recreations
         std::vector<Semaphore> imageAvailableSemaphores_;
         std::vector<Semaphore> renderFinishedSemaphores_;
         std::vector<Semaphore> computeFinishedSemaphores_;
         std::vector<Semaphore> rayTracingFinishedSemaphores_;
         std::vector<Fence> inFlightFences_;
+        // Number of the frame last submitted with each fence, frames are counted by the deletion queue
+        std::vector<uint64_t> inFlightFrames_;
+        // Frame in flight that last drew each swap chain image, per image buffers and sets are written
+        // after StartDraw, so the next frame on the image waits for it
+        std::vector<uint32_t> imageFrames_;
 
         std::vector<std::shared_ptr<GraphicsRender>> graphicsRenders_;
         std::vector<std::shared_ptr<ComputeRender>> computeRenders_;
         std::vector<std::shared_ptr<RayTracingRender>> rayTracingRenders_;
 
+        std::map<uint32_t, std::function<void(const VkExtent2D &)>> resizeListeners_;
+        uint32_t nextResizeListener_ = 0;
+        bool resizePending_ = false;
+        bool imageCountChanged_ = false;
+
         // TODO VK_POLYGON_MODE_LINE
         // VkPolygonMode polygonMode = VK_POLYGON_MODE_FILL;
 
@@ -120,7 +154,6 @@ namespace estun
 
         //uint32_t maxFramesInFlight_ = 2;
 
-        //bool framebufferResized = false;
         //bool firstCompute = true;
     };
 
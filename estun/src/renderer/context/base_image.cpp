@@ -59,7 +59,9 @@ estun::BaseImage::~BaseImage()
 {
     if (image != nullptr)
     {
-        vkDestroyImage(DeviceLocator::GetLogicalDevice(), image, nullptr);
+        DeviceLocator::GetDevice().GetDeletionQueue().Push([handle = image]() {
+            vkDestroyImage(DeviceLocator::GetLogicalDevice(), handle, nullptr);
+        });
         image = nullptr;
     }
 }
@@ -0,0 +1,118 @@
+#include "renderer/context/command_recorder.h"
+#include "renderer/context/device.h"
+#include "core/thread_pool.h"
+
+#include <algorithm>
+
+estun::CommandRecorder::CommandRecorder(CommandPoolType type, std::shared_ptr<ThreadPool> pool)
+    : type_(type), pool_(pool)
+{
+}
+
+estun::CommandRecorder::~CommandRecorder()
+{
+    // Secondary buffers go with their pools
+    frames_.clear();
+    pool_.reset();
+}
+
+void estun::CommandRecorder::Record(VkCommandBuffer primary, uint32_t frame, const std::vector<std::function<void(VkCommandBuffer)>> &parts)
+{
+    const std::vector<VkCommandBuffer> secondaries = RecordSecondaries(frame, parts);
+    if (!secondaries.empty())
+    {
+        vkCmdExecuteCommands(primary, static_cast<uint32_t>(secondaries.size()), secondaries.data());
+    }
+}
+
+std::vector<VkCommandBuffer> estun::CommandRecorder::RecordSecondaries(uint32_t frame, const std::vector<std::function<void(VkCommandBuffer)>> &parts)
+{
+    if (parts.empty())
+    {
+        return {};
+    }
+
+    // The calling thread records as well
+    const uint32_t threadCount = pool_ != nullptr ? pool_->GetThreadCount() + 1 : 1;
+    if (frame >= frames_.size())
+    {
+        frames_.resize(frame + 1);
+    }
+    std::vector<Recorder> &recorders = frames_[frame];
+    while (recorders.size() < threadCount)
+    {
+        recorders.emplace_back();
+        recorders.back().pool.reset(new CommandPool(type_));
+    }
+    Reset(recorders);
+
+    std::vector<VkCommandBuffer> secondaries(parts.size());
+    const uint32_t chunkCount = std::min(threadCount, static_cast<uint32_t>(parts.size()));
+    const uint32_t chunkSize = (static_cast<uint32_t>(parts.size()) + chunkCount - 1) / chunkCount;
+
+    // Every chunk records into its own pool, the one of the calling thread is the first
+    auto recordChunk = [&](uint32_t begin, uint32_t end) {
+        Recorder &recorder = recorders[begin / chunkSize];
+        for (uint32_t i = begin; i < end; i++)
+        {
+            VkCommandBuffer commandBuffer = Acquire(recorder);
+
+            VkCommandBufferInheritanceInfo inheritanceInfo = {};
+            inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+
+            // Primary buffers are recorded for simultaneous use, their secondaries have to match
+            VkCommandBufferBeginInfo beginInfo = {};
+            beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+            beginInfo.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
+            beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+            VK_CHECK_RESULT(vkBeginCommandBuffer(commandBuffer, &beginInfo), "Failed to begin recording secondary command buffer");
+            parts[i](commandBuffer);
+            VK_CHECK_RESULT(vkEndCommandBuffer(commandBuffer), "Failed to record secondary command buffer");
+
+            secondaries[i] = commandBuffer;
+        }
+    };
+
+    if (pool_ != nullptr)
+    {
+        pool_->ParallelFor(static_cast<uint32_t>(parts.size()), chunkSize, recordChunk);
+    }
+    else
+    {
+        recordChunk(0, static_cast<uint32_t>(parts.size()));
+    }
+
+    return secondaries;
+}
+
+VkCommandBuffer estun::CommandRecorder::Acquire(Recorder &recorder)
+{
+    if (recorder.used == recorder.buffers.size())
+    {
+        VkCommandBufferAllocateInfo allocInfo = {};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool = recorder.pool->GetCommandPool();
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+        allocInfo.commandBufferCount = 1;
+
+        VkCommandBuffer commandBuffer = nullptr;
+        VK_CHECK_RESULT(vkAllocateCommandBuffers(DeviceLocator::GetLogicalDevice(), &allocInfo, &commandBuffer), "Failed to allocate secondary command buffer");
+        recorder.buffers.push_back(commandBuffer);
+    }
+
+    return recorder.buffers[recorder.used++];
+}
+
+void estun::CommandRecorder::Reset(std::vector<Recorder> &recorders)
+{
+    // Buffers stay allocated, a pool reset returns all of them to the initial state at once
+    for (auto &recorder : recorders)
+    {
+        if (recorder.used > 0)
+        {
+            recorder.pool->Reset();
+            recorder.used = 0;
+        }
+    }
+}
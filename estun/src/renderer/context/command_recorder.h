@@ -0,0 +1,51 @@
+#pragma once
+
+#include "renderer/common.h"
+#include "renderer/context/command_pool.h"
+
+namespace estun
+{
+
+    class ThreadPool;
+
+    // Records the parts of a primary command buffer in parallel. Every part goes into its own secondary
+    // buffer, which are executed in the order of the parts, so barriers between them work as if the parts
+    // were recorded inline. State such as bound pipelines does not carry over from one part to the next.
+    // Each thread records from its own pool of the frame, recording a frame again resets those pools as a
+    // whole instead of freeing buffers, so the frame must not be in flight anymore.
+    class CommandRecorder
+    {
+    public:
+        CommandRecorder(const CommandRecorder &) = delete;
+        CommandRecorder(CommandRecorder &&) = delete;
+        CommandRecorder &operator=(const CommandRecorder &) = delete;
+        CommandRecorder &operator=(CommandRecorder &&) = delete;
+
+        // The pool type has to match the queue the primary buffers are submitted to
+        explicit CommandRecorder(CommandPoolType type, std::shared_ptr<ThreadPool> pool = nullptr);
+        ~CommandRecorder();
+
+        // The primary buffer has to be recording outside of a render pass
+        void Record(VkCommandBuffer primary, uint32_t frame, const std::vector<std::function<void(VkCommandBuffer)>> &parts);
+        // One recorded secondary buffer per part, for callers that record more between them
+        std::vector<VkCommandBuffer> RecordSecondaries(uint32_t frame, const std::vector<std::function<void(VkCommandBuffer)>> &parts);
+
+    private:
+        // Command pools are externally synchronized, one per thread and frame
+        struct Recorder
+        {
+            std::unique_ptr<CommandPool> pool;
+            std::vector<VkCommandBuffer> buffers;
+            uint32_t used = 0;
+        };
+
+        VkCommandBuffer Acquire(Recorder &recorder);
+        void Reset(std::vector<Recorder> &recorders);
+
+        CommandPoolType type_;
+        std::shared_ptr<ThreadPool> pool_;
+
+        std::vector<std::vector<Recorder>> frames_;
+    };
+
+} // namespace estun
@@ -0,0 +1,64 @@
+#include "renderer/context/deletion_queue.h"
+
+#include <limits>
+
+estun::DeletionQueue::~DeletionQueue()
+{
+    Flush();
+}
+
+void estun::DeletionQueue::Push(std::function<void()> destroy)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        // Loading releases lots of staging memory before the first frame, nothing can reference it yet
+        if (submittedFrames_ != 0)
+        {
+            entries_.push_back({submittedFrames_, std::move(destroy)});
+            return;
+        }
+    }
+    destroy();
+}
+
+void estun::DeletionQueue::SetSubmittedFrames(uint64_t submittedFrames)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    submittedFrames_ = submittedFrames;
+}
+
+uint64_t estun::DeletionQueue::GetSubmittedFrames() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return submittedFrames_;
+}
+
+void estun::DeletionQueue::Collect(uint64_t oldestPendingFrame)
+{
+    // Entries are tagged in push order, so the released ones are always at the front
+    std::vector<std::function<void()>> released;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        while (!entries_.empty() && entries_.front().frame <= oldestPendingFrame)
+        {
+            released.push_back(std::move(entries_.front().destroy));
+            entries_.pop_front();
+        }
+    }
+
+    for (auto &destroy : released)
+    {
+        destroy();
+    }
+}
+
+void estun::DeletionQueue::Flush()
+{
+    Collect(std::numeric_limits<uint64_t>::max());
+}
+
+size_t estun::DeletionQueue::GetSize() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return entries_.size();
+}
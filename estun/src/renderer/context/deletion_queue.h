@@ -0,0 +1,53 @@
+#pragma once
+
+#include "renderer/common.h"
+
+#include <deque>
+#include <mutex>
+
+namespace estun
+{
+
+    // Vulkan handles whose owners are gone but which frames in flight may still reference. Every
+    // entry is tagged with the number of frames submitted when it was pushed and destroyed once
+    // all of those frames have finished, so releasing a resource never waits for the device.
+    // Work submitted outside the frames waits for its queue, it can't hold on to anything here.
+    class DeletionQueue
+    {
+    public:
+        DeletionQueue(const DeletionQueue &) = delete;
+        DeletionQueue(DeletionQueue &&) = delete;
+        DeletionQueue &operator=(const DeletionQueue &) = delete;
+        DeletionQueue &operator=(DeletionQueue &&) = delete;
+
+        DeletionQueue() = default;
+        ~DeletionQueue();
+
+        // Safe to call from any thread. The destroy function runs on the thread that collects, or right
+        // away while no frame was submitted yet.
+        void Push(std::function<void()> destroy);
+
+        // Called after every frame submission with the number of frames submitted so far
+        void SetSubmittedFrames(uint64_t submittedFrames);
+        uint64_t GetSubmittedFrames() const;
+
+        // Destroys what was pushed before the oldest frame still in flight was submitted
+        void Collect(uint64_t oldestPendingFrame);
+        // Destroys everything, the device has to be idle
+        void Flush();
+
+        size_t GetSize() const;
+
+    private:
+        struct Entry
+        {
+            uint64_t frame;
+            std::function<void()> destroy;
+        };
+
+        mutable std::mutex mutex_;
+        std::deque<Entry> entries_;
+        uint64_t submittedFrames_ = 0;
+    };
+
+} // namespace estun
@@ -10,6 +10,7 @@ estun::Device *estun::DeviceLocator::currDevice = nullptr;
 
 estun::Device::~Device()
 {
+    WaitIdle();
     vkDestroyDevice(logicalDevice, nullptr);
 }
 
@@ -121,15 +122,29 @@ bool estun::Device::IsDeviceSuitable(VkPhysicalDevice device, estun::Surface *su
     rayTracingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_RAY_TRACING_FEATURES_KHR;
     rayTracingFeatures.pNext = nullptr;
 
+    VkPhysicalDeviceVulkan12Features vulkan12Features = {};
+    vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    vulkan12Features.pNext = &rayTracingFeatures;
+
     VkPhysicalDeviceFeatures2 deviceFeatures2;
     deviceFeatures2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
-    deviceFeatures2.pNext = &rayTracingFeatures;
+    deviceFeatures2.pNext = &vulkan12Features;
     vkGetPhysicalDeviceFeatures2(device, &deviceFeatures2);
     flag = flag && rayTracingFeatures.rayTracing;
 
+    // The resource table is written while the recorded command buffers keep it bound
+    flag = flag && vulkan12Features.runtimeDescriptorArray &&
+           vulkan12Features.descriptorBindingPartiallyBound &&
+           vulkan12Features.descriptorBindingVariableDescriptorCount &&
+           vulkan12Features.descriptorBindingUpdateUnusedWhilePending &&
+           vulkan12Features.descriptorBindingSampledImageUpdateAfterBind &&
+           vulkan12Features.descriptorBindingStorageBufferUpdateAfterBind &&
+           vulkan12Features.shaderSampledImageArrayNonUniformIndexing;
+
     VkPhysicalDeviceFeatures supportedFeatures;
     vkGetPhysicalDeviceFeatures(device, &supportedFeatures);
-    flag = flag && supportedFeatures.samplerAnisotropy;
+    // The upscaler writes the swap chain format without naming it in the shader
+    flag = flag && supportedFeatures.samplerAnisotropy && supportedFeatures.shaderStorageImageWriteWithoutFormat;
 
     bool swapChainAdequate = false;
     if (extensionsSupported)
@@ -225,10 +240,22 @@ void estun::Device::CreateLogicalDevice(estun::Instance *instance, estun::Surfac
         queueCreateInfos.push_back(queueCreateInfo);
     }
 
+    VkPhysicalDeviceRayTracingFeaturesKHR supportedRayTracingFeatures = {};
+    supportedRayTracingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_RAY_TRACING_FEATURES_KHR;
+    supportedRayTracingFeatures.pNext = nullptr;
+
+    VkPhysicalDeviceFeatures2 supportedFeatures2 = {};
+    supportedFeatures2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    supportedFeatures2.pNext = &supportedRayTracingFeatures;
+    vkGetPhysicalDeviceFeatures2(physicalDevice, &supportedFeatures2);
+    hostAccelerationStructureCommands = supportedRayTracingFeatures.rayTracingHostAccelerationStructureCommands;
+    textureCompressionBC = supportedFeatures2.features.textureCompressionBC;
+
     VkPhysicalDeviceRayTracingFeaturesKHR deviceRayTracingFeatures = {};
     deviceRayTracingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_RAY_TRACING_FEATURES_KHR;
     deviceRayTracingFeatures.pNext = nullptr;
     deviceRayTracingFeatures.rayTracing = VK_TRUE;
+    deviceRayTracingFeatures.rayTracingHostAccelerationStructureCommands = hostAccelerationStructureCommands;
 
     VkPhysicalDeviceVulkan12Features deviceVulkan12Features = {};
     deviceVulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
@@ -236,12 +263,20 @@ void estun::Device::CreateLogicalDevice(estun::Instance *instance, estun::Surfac
     deviceVulkan12Features.bufferDeviceAddress = VK_TRUE;
     deviceVulkan12Features.descriptorIndexing = VK_TRUE;
     deviceVulkan12Features.runtimeDescriptorArray = VK_TRUE;
+    deviceVulkan12Features.descriptorBindingPartiallyBound = VK_TRUE;
+    deviceVulkan12Features.descriptorBindingVariableDescriptorCount = VK_TRUE;
+    deviceVulkan12Features.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+    deviceVulkan12Features.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+    deviceVulkan12Features.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+    deviceVulkan12Features.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
 
     VkPhysicalDeviceFeatures deviceFeatures = {};
     deviceFeatures.samplerAnisotropy = VK_TRUE;
     deviceFeatures.shaderClipDistance = VK_TRUE;
     deviceFeatures.geometryShader = VK_TRUE;
     deviceFeatures.fillModeNonSolid = VK_TRUE;
+    deviceFeatures.shaderStorageImageWriteWithoutFormat = VK_TRUE;
+    deviceFeatures.textureCompressionBC = textureCompressionBC;
 
     VkDeviceCreateInfo createInfo = {};
     createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
@@ -311,9 +346,10 @@ VkQueue estun::Device::GetTransferQueue()
     return transferQueue;
 }
 
-void estun::Device::WaitIdle() const
+void estun::Device::WaitIdle()
 {
     VK_CHECK_RESULT(vkDeviceWaitIdle(logicalDevice), "Wait for device idle");
+    deletionQueue.Flush();
 }
 
 estun::SwapChainSupportDetails
@@ -2,6 +2,7 @@
 
 #include "core/core.h"
 #include "renderer/common.h"
+#include "renderer/context/deletion_queue.h"
 #include "renderer/context/utils.h"
 
 namespace estun
@@ -36,6 +37,8 @@ private:
     VkPhysicalDevice physicalDevice;
     VkDevice logicalDevice;
     VkSampleCountFlagBits msaaSamples;
+    bool hostAccelerationStructureCommands = false;
+    bool textureCompressionBC = false;
 
     QueueFamilyIndices currIndices;
 
@@ -56,6 +59,8 @@ private:
     VkQueue presentQueue;
     VkQueue transferQueue;
 
+    DeletionQueue deletionQueue;
+
 public:
     Device(const Device &) = delete;
     Device(Device &&) = delete;
@@ -76,13 +81,19 @@ public:
 
     VkSampleCountFlagBits GetMaxUsableSampleCount();
     VkSampleCountFlagBits GetMsaaSamples() const;
+    bool SupportsHostAccelerationStructureCommands() const { return hostAccelerationStructureCommands; }
+    bool SupportsTextureCompressionBC() const { return textureCompressionBC; }
 
     VkQueue GetGraphicsQueue();
     VkQueue GetComputeQueue();
     VkQueue GetPresentQueue();
     VkQueue GetTransferQueue();
 
-    void WaitIdle() const;
+    // Also destroys everything in the deletion queue, no frame can reference it afterwards
+    void WaitIdle();
+
+    // Resources release their handles through it instead of destroying them right away
+    DeletionQueue &GetDeletionQueue() { return deletionQueue; }
 
 private:
     void PickPhysicalDevice(Instance *instance, Surface *surface);
@@ -28,7 +28,19 @@ estun::DynamicFunctions::DynamicFunctions()
       vkCmdBuildAccelerationStructureKHR(GetProcedure<PFN_vkCmdBuildAccelerationStructureKHR>("vkCmdBuildAccelerationStructureKHR")),
       vkCreateRayTracingPipelinesKHR(GetProcedure<PFN_vkCreateRayTracingPipelinesKHR>("vkCreateRayTracingPipelinesKHR")),
       vkGetRayTracingShaderGroupHandlesKHR(GetProcedure<PFN_vkGetRayTracingShaderGroupHandlesKHR>("vkGetRayTracingShaderGroupHandlesKHR")),
-      vkCmdTraceRaysKHR(GetProcedure<PFN_vkCmdTraceRaysKHR>("vkCmdTraceRaysKHR"))
+      vkCmdTraceRaysKHR(GetProcedure<PFN_vkCmdTraceRaysKHR>("vkCmdTraceRaysKHR")),
+      vkCmdWriteAccelerationStructuresPropertiesKHR(GetProcedure<PFN_vkCmdWriteAccelerationStructuresPropertiesKHR>("vkCmdWriteAccelerationStructuresPropertiesKHR")),
+      vkCmdCopyAccelerationStructureToMemoryKHR(GetProcedure<PFN_vkCmdCopyAccelerationStructureToMemoryKHR>("vkCmdCopyAccelerationStructureToMemoryKHR")),
+      vkCmdCopyMemoryToAccelerationStructureKHR(GetProcedure<PFN_vkCmdCopyMemoryToAccelerationStructureKHR>("vkCmdCopyMemoryToAccelerationStructureKHR")),
+      vkGetDeviceAccelerationStructureCompatibilityKHR(GetProcedure<PFN_vkGetDeviceAccelerationStructureCompatibilityKHR>("vkGetDeviceAccelerationStructureCompatibilityKHR")),
+      vkBuildAccelerationStructureKHR(GetProcedure<PFN_vkBuildAccelerationStructureKHR>("vkBuildAccelerationStructureKHR")),
+      vkCopyAccelerationStructureToMemoryKHR(GetProcedure<PFN_vkCopyAccelerationStructureToMemoryKHR>("vkCopyAccelerationStructureToMemoryKHR")),
+      vkWriteAccelerationStructuresPropertiesKHR(GetProcedure<PFN_vkWriteAccelerationStructuresPropertiesKHR>("vkWriteAccelerationStructuresPropertiesKHR")),
+      vkCreateDeferredOperationKHR(GetProcedure<PFN_vkCreateDeferredOperationKHR>("vkCreateDeferredOperationKHR")),
+      vkDestroyDeferredOperationKHR(GetProcedure<PFN_vkDestroyDeferredOperationKHR>("vkDestroyDeferredOperationKHR")),
+      vkGetDeferredOperationMaxConcurrencyKHR(GetProcedure<PFN_vkGetDeferredOperationMaxConcurrencyKHR>("vkGetDeferredOperationMaxConcurrencyKHR")),
+      vkGetDeferredOperationResultKHR(GetProcedure<PFN_vkGetDeferredOperationResultKHR>("vkGetDeferredOperationResultKHR")),
+      vkDeferredOperationJoinKHR(GetProcedure<PFN_vkDeferredOperationJoinKHR>("vkDeferredOperationJoinKHR"))
 {
 }
 
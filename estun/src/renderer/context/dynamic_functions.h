@@ -82,6 +82,79 @@ namespace estun
             uint32_t height,
             uint32_t depth)>
             vkCmdTraceRaysKHR;
+
+        const std::function<void(
+            VkCommandBuffer commandBuffer,
+            uint32_t accelerationStructureCount,
+            const VkAccelerationStructureKHR *pAccelerationStructures,
+            VkQueryType queryType,
+            VkQueryPool queryPool,
+            uint32_t firstQuery)>
+            vkCmdWriteAccelerationStructuresPropertiesKHR;
+
+        const std::function<void(
+            VkCommandBuffer commandBuffer,
+            const VkCopyAccelerationStructureToMemoryInfoKHR *pInfo)>
+            vkCmdCopyAccelerationStructureToMemoryKHR;
+
+        const std::function<void(
+            VkCommandBuffer commandBuffer,
+            const VkCopyMemoryToAccelerationStructureInfoKHR *pInfo)>
+            vkCmdCopyMemoryToAccelerationStructureKHR;
+
+        const std::function<VkResult(
+            VkDevice device,
+            const VkAccelerationStructureVersionKHR *version)>
+            vkGetDeviceAccelerationStructureCompatibilityKHR;
+
+        const std::function<VkResult(
+            VkDevice device,
+            uint32_t infoCount,
+            const VkAccelerationStructureBuildGeometryInfoKHR *pInfos,
+            const VkAccelerationStructureBuildOffsetInfoKHR *const *ppOffsetInfos)>
+            vkBuildAccelerationStructureKHR;
+
+        const std::function<VkResult(
+            VkDevice device,
+            const VkCopyAccelerationStructureToMemoryInfoKHR *pInfo)>
+            vkCopyAccelerationStructureToMemoryKHR;
+
+        const std::function<VkResult(
+            VkDevice device,
+            uint32_t accelerationStructureCount,
+            const VkAccelerationStructureKHR *pAccelerationStructures,
+            VkQueryType queryType,
+            size_t dataSize,
+            void *pData,
+            size_t stride)>
+            vkWriteAccelerationStructuresPropertiesKHR;
+
+        const std::function<VkResult(
+            VkDevice device,
+            const VkAllocationCallbacks *pAllocator,
+            VkDeferredOperationKHR *pDeferredOperation)>
+            vkCreateDeferredOperationKHR;
+
+        const std::function<void(
+            VkDevice device,
+            VkDeferredOperationKHR operation,
+            const VkAllocationCallbacks *pAllocator)>
+            vkDestroyDeferredOperationKHR;
+
+        const std::function<uint32_t(
+            VkDevice device,
+            VkDeferredOperationKHR operation)>
+            vkGetDeferredOperationMaxConcurrencyKHR;
+
+        const std::function<VkResult(
+            VkDevice device,
+            VkDeferredOperationKHR operation)>
+            vkGetDeferredOperationResultKHR;
+
+        const std::function<VkResult(
+            VkDevice device,
+            VkDeferredOperationKHR operation)>
+            vkDeferredOperationJoinKHR;
     };
 
     class FunctionsLocator
@@ -35,6 +35,11 @@ void estun::Fence::Wait(const uint64_t timeout) const
 	VK_CHECK_RESULT(vkWaitForFences(DeviceLocator::GetLogicalDevice(), 1, &fence, VK_TRUE, timeout), "Failed to wait for fence");
 }
 
+bool estun::Fence::IsSignaled() const
+{
+	return vkGetFenceStatus(DeviceLocator::GetLogicalDevice(), fence) == VK_SUCCESS;
+}
+
 const VkFence &estun::Fence::GetFence() const 
 { 
     return fence; 
@@ -20,6 +20,7 @@ public:
 
     void Reset();
     void Wait(uint64_t timeout) const;
+    bool IsSignaled() const;
 
 private:
     VkFence fence{};
@@ -42,7 +42,9 @@ estun::Framebuffer::~Framebuffer()
 {
     if (framebuffer != nullptr)
     {
-        vkDestroyFramebuffer(DeviceLocator::GetLogicalDevice(), framebuffer, nullptr);
+        DeviceLocator::GetDevice().GetDeletionQueue().Push([handle = framebuffer]() {
+            vkDestroyFramebuffer(DeviceLocator::GetLogicalDevice(), handle, nullptr);
+        });
         framebuffer = nullptr;
     }
 }
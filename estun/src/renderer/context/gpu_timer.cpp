@@ -0,0 +1,91 @@
+#include "renderer/context/gpu_timer.h"
+#include "renderer/context/device.h"
+#include "renderer/context/single_time_commands.h"
+#include "core/core.h"
+
+estun::GpuTimer::GpuTimer(uint32_t frameCount, uint32_t queueFamily, uint32_t intervalCount)
+    : frameCount_(frameCount),
+      intervalCount_(intervalCount)
+{
+    uint32_t familyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(DeviceLocator::GetPhysicalDevice(), &familyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> families(familyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(DeviceLocator::GetPhysicalDevice(), &familyCount, families.data());
+
+    const uint32_t validBits = queueFamily < familyCount ? families[queueFamily].timestampValidBits : 0;
+    if (validBits == 0)
+    {
+        ES_CORE_WARN("Queue family {0} has no timestamps, frames are not timed", queueFamily);
+        return;
+    }
+    validMask_ = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(DeviceLocator::GetPhysicalDevice(), &properties);
+    period_ = properties.limits.timestampPeriod;
+
+    VkQueryPoolCreateInfo queryPoolInfo = {};
+    queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    queryPoolInfo.queryCount = 2 * frameCount_ * intervalCount_;
+    VK_CHECK_RESULT(vkCreateQueryPool(DeviceLocator::GetLogicalDevice(), &queryPoolInfo, nullptr, &queryPool_), "Failed to create timestamp query pool");
+
+    // Reset queries only report not ready, reading them before the first frame is fine
+    SingleTimeCommands::SubmitCompute([this](VkCommandBuffer commandBuffer) {
+        vkCmdResetQueryPool(commandBuffer, queryPool_, 0, 2 * frameCount_ * intervalCount_);
+    }, "reset timestamp queries");
+}
+
+estun::GpuTimer::~GpuTimer()
+{
+    if (queryPool_ != nullptr)
+    {
+        DeviceLocator::GetDevice().GetDeletionQueue().Push([handle = queryPool_]() {
+            vkDestroyQueryPool(DeviceLocator::GetLogicalDevice(), handle, nullptr);
+        });
+        queryPool_ = nullptr;
+    }
+}
+
+void estun::GpuTimer::Begin(VkCommandBuffer commandBuffer, uint32_t frame, uint32_t interval)
+{
+    if (queryPool_ == nullptr || frame >= frameCount_ || interval >= intervalCount_)
+    {
+        return;
+    }
+
+    // Written at the bottom of the pipe, a top of pipe timestamp would count the wait for earlier work
+    vkCmdResetQueryPool(commandBuffer, queryPool_, GetQuery(frame, interval), 2);
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPool_, GetQuery(frame, interval));
+}
+
+void estun::GpuTimer::End(VkCommandBuffer commandBuffer, uint32_t frame, uint32_t interval)
+{
+    if (queryPool_ == nullptr || frame >= frameCount_ || interval >= intervalCount_)
+    {
+        return;
+    }
+
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPool_, GetQuery(frame, interval) + 1);
+}
+
+bool estun::GpuTimer::GetMilliseconds(uint32_t frame, float &milliseconds, uint32_t interval) const
+{
+    if (queryPool_ == nullptr || frame >= frameCount_ || interval >= intervalCount_)
+    {
+        return false;
+    }
+
+    uint64_t timestamps[2];
+    const VkResult result = vkGetQueryPoolResults(
+        DeviceLocator::GetLogicalDevice(), queryPool_, GetQuery(frame, interval), 2,
+        sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+    if (result != VK_SUCCESS)
+    {
+        return false;
+    }
+
+    const uint64_t ticks = (timestamps[1] - timestamps[0]) & validMask_;
+    milliseconds = static_cast<float>(static_cast<double>(ticks) * period_ * 1e-6);
+    return true;
+}
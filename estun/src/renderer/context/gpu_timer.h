@@ -0,0 +1,44 @@
+#pragma once
+
+#include "renderer/common.h"
+
+namespace estun
+{
+
+    // Device time of a few intervals of a frame, one pair of queries per interval and swap chain image. The
+    // timestamps are recorded with the image's command buffers and read back once that image comes around
+    // again. Each timestamp is written once everything recorded before it has finished, so an interval
+    // only covers the work recorded within it.
+    class GpuTimer
+    {
+    public:
+        GpuTimer(const GpuTimer &) = delete;
+        GpuTimer(GpuTimer &&) = delete;
+        GpuTimer &operator=(const GpuTimer &) = delete;
+        GpuTimer &operator=(GpuTimer &&) = delete;
+
+        // The queue family is the one the timed command buffers are submitted to
+        GpuTimer(uint32_t frameCount, uint32_t queueFamily, uint32_t intervalCount = 1);
+        ~GpuTimer();
+
+        // Both have to be recorded outside of a render pass, Begin first. Intervals may be recorded into
+        // secondary buffers of the frame.
+        void Begin(VkCommandBuffer commandBuffer, uint32_t frame, uint32_t interval = 0);
+        void End(VkCommandBuffer commandBuffer, uint32_t frame, uint32_t interval = 0);
+
+        // False while the interval was not timed yet or is still running, never waits
+        bool GetMilliseconds(uint32_t frame, float &milliseconds, uint32_t interval = 0) const;
+
+        bool IsSupported() const { return queryPool_ != nullptr; }
+
+    private:
+        uint32_t GetQuery(uint32_t frame, uint32_t interval) const { return 2 * (frame * intervalCount_ + interval); }
+
+        VkQueryPool queryPool_ = nullptr;
+        uint32_t frameCount_;
+        uint32_t intervalCount_;
+        uint64_t validMask_ = 0;
+        float period_ = 0.0f;
+    };
+
+} // namespace estun
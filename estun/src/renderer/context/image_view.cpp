@@ -64,7 +64,13 @@ estun::ImageView::ImageView(const VkImage image, VkFormat format, VkImageAspectF
 
 estun::ImageView::~ImageView()
 {
-    vkDestroyImageView(DeviceLocator::GetLogicalDevice(), imageView, nullptr);
+    if (imageView != nullptr)
+    {
+        DeviceLocator::GetDevice().GetDeletionQueue().Push([handle = imageView]() {
+            vkDestroyImageView(DeviceLocator::GetLogicalDevice(), handle, nullptr);
+        });
+        imageView = nullptr;
+    }
 }
 
 VkImageView estun::ImageView::GetImageView() const
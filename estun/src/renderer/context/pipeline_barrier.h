@@ -0,0 +1,29 @@
+#pragma once
+
+#include "renderer/common.h"
+
+namespace estun
+{
+
+class PipelineBarrier
+{
+public:
+    // Global memory dependency, enough for buffers and acceleration structures shared by one queue
+    static void Insert(
+        const VkCommandBuffer commandBuffer,
+        const VkAccessFlags srcAccessMask,
+        const VkAccessFlags dstAccessMask,
+        const VkPipelineStageFlags srcStageMask,
+        const VkPipelineStageFlags dstStageMask)
+    {
+        VkMemoryBarrier barrier;
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.pNext = nullptr;
+        barrier.srcAccessMask = srcAccessMask;
+        barrier.dstAccessMask = dstAccessMask;
+
+        vkCmdPipelineBarrier(commandBuffer, srcStageMask, dstStageMask, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+    }
+};
+
+} // namespace estun
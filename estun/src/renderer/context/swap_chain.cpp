@@ -12,14 +12,15 @@ estun::SwapChain::SwapChain(
     Surface *surface,
     const uint32_t &width,
     const uint32_t &height,
-    bool vsync)
+    bool vsync,
+    const SwapChain *oldSwapChain)
 {
     QueueFamilyIndices indices = DeviceLocator::GetDevice().GetQueueFamilyIndices();
     SwapChainSupportDetails details = Device::QuerySwapChainSupport(DeviceLocator::GetPhysicalDevice(), surface);
 
     const auto surfaceFormat = ChooseSwapSurfaceFormat(details.formats);
     const auto presentMode = ChooseSwapPresentMode(details.presentModes, vsync);
-    const auto imageCount = ChooseImageCount(details.capabilities);
+    const auto imageCount = ChooseImageCount(details.capabilities, oldSwapChain);
     extent = ChooseSwapExtent(details.capabilities, width, height);
 
     VkSwapchainCreateInfoKHR createInfo = {};
@@ -35,7 +36,8 @@ estun::SwapChain::SwapChain(
     createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
     createInfo.presentMode = presentMode;
     createInfo.clipped = VK_TRUE;
-    createInfo.oldSwapchain = nullptr;
+    // The old swap chain is retired, presenting its acquired images still works while the new one takes over
+    createInfo.oldSwapchain = oldSwapChain != nullptr ? oldSwapChain->GetSwapChain() : nullptr;
 
     uint32_t queueFamilyIndices[] = {indices.graphicsFamily.value(), indices.presentFamily.value()};
 
@@ -59,7 +61,7 @@ estun::SwapChain::SwapChain(
     format = surfaceFormat.format;
 
     VK_CHECK_RESULT(vkGetSwapchainImagesKHR(DeviceLocator::GetLogicalDevice(), swapChain, &minImageCount, nullptr), "Failed to create swap chain images");
-    images.resize(imageCount);
+    images.resize(minImageCount);
     VK_CHECK_RESULT(vkGetSwapchainImagesKHR(DeviceLocator::GetLogicalDevice(), swapChain, &minImageCount, images.data()), "Failed to get swap chain images");
 
     imageViews.reserve(images.size());
@@ -72,11 +74,14 @@ estun::SwapChain::SwapChain(
 
 estun::SwapChain::~SwapChain()
 {
+    // Queued after the views, which go first
     imageViews.clear();
 
     if (swapChain != nullptr)
     {
-        vkDestroySwapchainKHR(DeviceLocator::GetLogicalDevice(), swapChain, nullptr);
+        DeviceLocator::GetDevice().GetDeletionQueue().Push([handle = swapChain]() {
+            vkDestroySwapchainKHR(DeviceLocator::GetLogicalDevice(), handle, nullptr);
+        });
         swapChain = nullptr;
     }
 }
@@ -139,9 +144,11 @@ VkExtent2D estun::SwapChain::ChooseSwapExtent(const VkSurfaceCapabilitiesKHR &ca
     return actualExtent;
 }
 
-uint32_t estun::SwapChain::ChooseImageCount(const VkSurfaceCapabilitiesKHR &capabilities)
+uint32_t estun::SwapChain::ChooseImageCount(const VkSurfaceCapabilitiesKHR &capabilities, const SwapChain *oldSwapChain)
 {
-    uint32_t imageCount = capabilities.minImageCount + 1;
+    // Resources are kept per image, asking for the old count keeps them when only the size changes
+    uint32_t imageCount = oldSwapChain != nullptr ? static_cast<uint32_t>(oldSwapChain->GetImages().size()) : capabilities.minImageCount + 1;
+    imageCount = std::max(imageCount, capabilities.minImageCount);
 
     if (capabilities.maxImageCount > 0 && imageCount > capabilities.maxImageCount)
     {
@@ -22,7 +22,8 @@ public:
         Surface *surface,
         const uint32_t &width,
         const uint32_t &height,
-        bool vsync);
+        bool vsync,
+        const SwapChain *oldSwapChain = nullptr);
     ~SwapChain();
 
     uint32_t GetMinImageCount() const;
@@ -37,7 +38,7 @@ private:
     static VkSurfaceFormatKHR ChooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR> &formats);
     static VkPresentModeKHR ChooseSwapPresentMode(const std::vector<VkPresentModeKHR> &presentModes, bool vsync);
     static VkExtent2D ChooseSwapExtent(const VkSurfaceCapabilitiesKHR &capabilities, const uint32_t &width, const uint32_t &height);
-    static uint32_t ChooseImageCount(const VkSurfaceCapabilitiesKHR &capabilities);
+    static uint32_t ChooseImageCount(const VkSurfaceCapabilitiesKHR &capabilities, const SwapChain *oldSwapChain);
 
     VkSwapchainKHR swapChain;
 
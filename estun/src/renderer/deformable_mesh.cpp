@@ -0,0 +1,270 @@
+#include "renderer/deformable_mesh.h"
+#include "renderer/context.h"
+#include "renderer/context/command_pool.h"
+#include "renderer/context/device.h"
+#include "renderer/context/pipeline_barrier.h"
+#include "renderer/material/descriptor_binding.h"
+#include "renderer/model.h"
+#include "core/core.h"
+
+namespace
+{
+    const uint32_t groupSize = 64;
+}
+
+estun::DeformableMesh::DeformableMesh(
+    const Model &model, const DeformTarget &target,
+    const std::vector<SkinWeights> &skin,
+    const std::vector<std::vector<MorphDelta>> &morphTargets,
+    const std::string &shaderName,
+    const DeformationPolicy &policy)
+    : policy_(policy)
+{
+    const auto &vertices = model.GetVertices();
+    const uint32_t vertexCount = static_cast<uint32_t>(vertices.size());
+
+    if (!skin.empty() && skin.size() != vertexCount)
+    {
+        ES_CORE_ASSERT(std::string("Skin of '") + model.GetName() + std::string("' needs one entry per vertex"));
+    }
+    if (morphTargets.size() > DeformUBO::MaxMorphTargets)
+    {
+        ES_CORE_ASSERT(std::string("Model '") + model.GetName() + std::string("' has too many morph targets"));
+    }
+
+    // Rest pose as position and normal pairs, the compact streams are overwritten every frame
+    std::vector<glm::vec4> rest;
+    rest.reserve(vertexCount * 2);
+    restMin_ = glm::vec3(std::numeric_limits<float>::max());
+    restMax_ = glm::vec3(std::numeric_limits<float>::lowest());
+    for (const auto &vertex : vertices)
+    {
+        rest.push_back(glm::vec4(vertex.position, 1.0f));
+        rest.push_back(glm::vec4(vertex.normal, 0.0f));
+        restMin_ = glm::min(restMin_, vertex.position);
+        restMax_ = glm::max(restMax_, vertex.position);
+    }
+
+    std::vector<MorphDelta> deltas;
+    deltas.reserve(morphTargets.size() * vertexCount);
+    for (const auto &morphTarget : morphTargets)
+    {
+        if (morphTarget.size() != vertexCount)
+        {
+            ES_CORE_ASSERT(std::string("Morph target of '") + model.GetName() + std::string("' needs one delta per vertex"));
+        }
+
+        float maxDelta = 0.0f;
+        for (const auto &delta : morphTarget)
+        {
+            maxDelta = std::max(maxDelta, glm::length(glm::vec3(delta.position)));
+        }
+        targetMaxDeltas_.push_back(maxDelta);
+        deltas.insert(deltas.end(), morphTarget.begin(), morphTarget.end());
+    }
+
+    // Joint bounds are taken on the box corners, grow it so any morphed vertex stays inside
+    float morphReach = 0.0f;
+    for (const float maxDelta : targetMaxDeltas_)
+    {
+        morphReach += maxDelta;
+    }
+    restMin_ -= glm::vec3(morphReach);
+    restMax_ += glm::vec3(morphReach);
+
+    // Storage buffers can not be empty
+    skinBuffer_ = std::make_shared<StorageBuffer<SkinWeights>>(skin.empty() ? std::vector<SkinWeights>(1, SkinWeights{}) : skin);
+    morphBuffer_ = std::make_shared<StorageBuffer<MorphDelta>>(deltas.empty() ? std::vector<MorphDelta>(1, MorphDelta{}) : deltas);
+    restBuffer_ = std::make_shared<StorageBuffer<glm::vec4>>(rest);
+
+    ubo_ = {};
+    std::fill_n(ubo_.joints, DeformUBO::MaxJoints, glm::mat4(1.0f));
+    ubo_.vertexOffset = target.vertexOffset;
+    ubo_.vertexCount = vertexCount;
+    ubo_.jointCount = 0;
+    ubo_.targetCount = static_cast<uint32_t>(morphTargets.size());
+    // The BLASes were built from the rest pose
+    buildUbo_ = ubo_;
+
+    const size_t imageCount = ContextLocator::GetSwapChain()->GetImageViews().size();
+    uniformBuffers_ = std::vector<UniformBuffer<DeformUBO>>(imageCount);
+
+    Bind(target);
+    pipeline_ = std::make_shared<ComputePipeline>(shaderName, descriptor_);
+
+    commandBuffers_ = std::make_unique<CommandBuffers>(CommandPoolLocator::GetComputePool(), static_cast<uint32_t>(imageCount));
+    for (size_t i = 0; i < imageCount; i++)
+    {
+        fences_.emplace_back(true);
+    }
+}
+
+estun::DeformableMesh::~DeformableMesh()
+{
+    for (const auto &fence : fences_)
+    {
+        fence.Wait(std::numeric_limits<uint64_t>::max());
+    }
+
+    fences_.clear();
+    commandBuffers_.reset();
+    pipeline_.reset();
+    descriptor_.reset();
+    uniformBuffers_.clear();
+    restBuffer_.reset();
+    skinBuffer_.reset();
+    morphBuffer_.reset();
+    blases_.clear();
+}
+
+void estun::DeformableMesh::Bind(const DeformTarget &target)
+{
+    blases_ = target.blases;
+    ubo_.vertexOffset = target.vertexOffset;
+
+    std::vector<DescriptorBinding> bindings = {
+        DescriptorBinding::Storage(0, target.positions, VK_SHADER_STAGE_COMPUTE_BIT),
+        DescriptorBinding::Storage(1, target.attributes, VK_SHADER_STAGE_COMPUTE_BIT),
+        DescriptorBinding::Storage(2, restBuffer_, VK_SHADER_STAGE_COMPUTE_BIT),
+        DescriptorBinding::Storage(3, skinBuffer_, VK_SHADER_STAGE_COMPUTE_BIT),
+        DescriptorBinding::Storage(4, morphBuffer_, VK_SHADER_STAGE_COMPUTE_BIT),
+        DescriptorBinding::Uniform(5, uniformBuffers_, VK_SHADER_STAGE_COMPUTE_BIT)};
+
+    if (descriptor_ == nullptr)
+    {
+        descriptor_ = std::make_shared<Descriptor>(bindings, uniformBuffers_.size());
+    }
+    else
+    {
+        descriptor_->Update(bindings);
+    }
+}
+
+void estun::DeformableMesh::SetTarget(const DeformTarget &target)
+{
+    for (const auto &fence : fences_)
+    {
+        fence.Wait(std::numeric_limits<uint64_t>::max());
+    }
+
+    Bind(target);
+
+    // The new BLASes were built from whatever pose the streams held
+    buildUbo_ = ubo_;
+    refitsSinceBuild_ = 0;
+}
+
+void estun::DeformableMesh::SetPose(const std::vector<glm::mat4> &joints, const std::vector<float> &morphWeights)
+{
+    if (joints.size() > DeformUBO::MaxJoints || morphWeights.size() > ubo_.targetCount)
+    {
+        ES_CORE_ASSERT("Pose has more joints or morph weights than the deformable mesh");
+        return;
+    }
+
+    std::copy(joints.begin(), joints.end(), ubo_.joints);
+    ubo_.jointCount = static_cast<uint32_t>(joints.size());
+
+    for (uint32_t i = 0; i < DeformUBO::MaxMorphTargets; i++)
+    {
+        ubo_.morphWeights[i / 4][i % 4] = i < morphWeights.size() ? morphWeights[i] : 0.0f;
+    }
+}
+
+float estun::DeformableMesh::EstimateDisplacement() const
+{
+    // A joint delta is affine, so its largest displacement over the rest box sits on a corner.
+    // Blended vertices move by a convex combination and can not exceed the worst joint.
+    float jointBound = 0.0f;
+    for (uint32_t j = 0; j < std::max(ubo_.jointCount, buildUbo_.jointCount); j++)
+    {
+        const glm::mat4 delta = ubo_.joints[j] - buildUbo_.joints[j];
+        for (uint32_t corner = 0; corner < 8; corner++)
+        {
+            const glm::vec3 position(
+                corner & 1 ? restMax_.x : restMin_.x,
+                corner & 2 ? restMax_.y : restMin_.y,
+                corner & 4 ? restMax_.z : restMin_.z);
+            jointBound = std::max(jointBound, glm::length(glm::vec3(delta * glm::vec4(position, 1.0f))));
+        }
+    }
+
+    float morphBound = 0.0f;
+    for (uint32_t t = 0; t < ubo_.targetCount; t++)
+    {
+        morphBound += std::abs(ubo_.morphWeights[t / 4][t % 4] - buildUbo_.morphWeights[t / 4][t % 4]) * targetMaxDeltas_[t];
+    }
+
+    const float diagonal = std::max(glm::length(restMax_ - restMin_), std::numeric_limits<float>::epsilon());
+    return (jointBound + morphBound) / diagonal;
+}
+
+void estun::DeformableMesh::Submit()
+{
+    const uint32_t imageIndex = ContextLocator::GetImageIndex();
+
+    // The previous submission for this image may still be reading the uniforms and command buffer
+    fences_[imageIndex].Wait(std::numeric_limits<uint64_t>::max());
+    fences_[imageIndex].Reset();
+
+    const bool rebuild = refitsSinceBuild_ >= policy_.maxRefits || EstimateDisplacement() > policy_.maxDisplacement;
+
+    uniformBuffers_[imageIndex].SetValue(ubo_);
+
+    VkCommandBuffer commandBuffer = (*commandBuffers_)[imageIndex];
+    commandBuffers_->Begin(imageIndex);
+
+    // Earlier frames may still trace against the deformed streams or refit from them
+    PipelineBarrier::Insert(
+        commandBuffer,
+        VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR, VK_ACCESS_SHADER_WRITE_BIT,
+        VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR | VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+
+    pipeline_->Bind(commandBuffer);
+    descriptor_->Bind(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE);
+    vkCmdDispatch(commandBuffer, (ubo_.vertexCount + groupSize - 1) / groupSize, 1, 1);
+
+    PipelineBarrier::Insert(
+        commandBuffer,
+        VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR | VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR);
+
+    for (auto &blas : blases_)
+    {
+        if (rebuild)
+        {
+            blas->Rebuild(commandBuffer);
+        }
+        else
+        {
+            blas->Update(commandBuffer);
+        }
+    }
+
+    // Covers the TLAS refit and trace recorded in the frame submitted after this one
+    PipelineBarrier::Insert(
+        commandBuffer,
+        VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR, VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR,
+        VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR, VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR | VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR);
+
+    commandBuffers_->End(imageIndex);
+
+    VkSubmitInfo submitInfo = {};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &commandBuffer;
+
+    VK_CHECK_RESULT(vkQueueSubmit(DeviceLocator::GetDevice().GetComputeQueue(), 1, &submitInfo, fences_[imageIndex].GetFence()), "submit deformation");
+
+    if (rebuild)
+    {
+        buildUbo_ = ubo_;
+        refitsSinceBuild_ = 0;
+        rebuildCount_++;
+    }
+    else
+    {
+        refitsSinceBuild_++;
+        refitCount_++;
+    }
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include "renderer/common.h"
+#include "renderer/buffers/compact_vertex.h"
+#include "renderer/buffers/storage_buffer.h"
+#include "renderer/buffers/uniform_buffer.h"
+#include "renderer/context/command_buffers.h"
+#include "renderer/context/fence.h"
+#include "renderer/material/compute_pipeline.h"
+#include "renderer/material/descriptor.h"
+#include "renderer/ray_tracing/bottom_level_acceleration_structure.h"
+
+namespace estun
+{
+
+    class Model;
+
+    // Four joint influences per vertex, weights sum to one
+    struct SkinWeights
+    {
+        glm::uvec4 joints;
+        glm::vec4 weights;
+    };
+
+    // Offset from the rest pose for one vertex of one morph target, w is unused
+    struct MorphDelta
+    {
+        glm::vec4 position;
+        glm::vec4 normal;
+    };
+
+    struct DeformationPolicy
+    {
+        // Refits in a row before the tree is rebuilt regardless of the pose
+        uint32_t maxRefits = 64;
+        // Bound on vertex movement since the last build, relative to the rest pose diagonal
+        float maxDisplacement = 0.25f;
+    };
+
+    // Compact streams the deformed vertices are written to and the BLASes built from that range,
+    // the BLASes need allowUpdate and stay out of the cache, see Scene::AddModel
+    struct DeformTarget
+    {
+        std::shared_ptr<StorageBuffer<glm::vec3>> positions;
+        std::shared_ptr<StorageBuffer<CompactVertex>> attributes;
+        uint32_t vertexOffset;
+        std::vector<std::shared_ptr<BLAS>> blases;
+    };
+
+    // Matches DeformUniforms in skin.comp
+    struct DeformUBO
+    {
+        static const uint32_t MaxJoints = 64;
+        static const uint32_t MaxMorphTargets = 8;
+
+        glm::mat4 joints[MaxJoints];
+        glm::vec4 morphWeights[MaxMorphTargets / 4];
+        uint32_t vertexOffset;
+        uint32_t vertexCount;
+        uint32_t jointCount;
+        uint32_t targetCount;
+    };
+
+    // Skins and morphs one model from its rest pose, writing positions and normals back into the
+    // model's own range of the compact streams so the usual hit shaders see the deformed mesh. Every frame the
+    // BLASes of the model are refit, and rebuilt when the policy decides the refit tree got too loose.
+    class DeformableMesh
+    {
+    public:
+        DeformableMesh(const DeformableMesh &) = delete;
+        DeformableMesh(DeformableMesh &&) = delete;
+
+        DeformableMesh &operator=(const DeformableMesh &) = delete;
+        DeformableMesh &operator=(DeformableMesh &&) = delete;
+
+        DeformableMesh(
+            const Model &model, const DeformTarget &target,
+            const std::vector<SkinWeights> &skin,
+            const std::vector<std::vector<MorphDelta>> &morphTargets,
+            const std::string &shaderName,
+            const DeformationPolicy &policy = DeformationPolicy());
+        ~DeformableMesh();
+
+        // Follows the model after its streams or BLASes were moved or rebuilt from the current pose
+        void SetTarget(const DeformTarget &target);
+
+        void SetPose(const std::vector<glm::mat4> &joints, const std::vector<float> &morphWeights = {});
+
+        // Records and submits deformation and BLAS builds for the current image on the compute queue,
+        // call between StartDraw and SubmitDraw so the traced frame is ordered after it
+        void Submit();
+
+        uint32_t GetRefitCount() const { return refitCount_; }
+        uint32_t GetRebuildCount() const { return rebuildCount_; }
+
+    private:
+        void Bind(const DeformTarget &target);
+        float EstimateDisplacement() const;
+
+        std::vector<std::shared_ptr<BLAS>> blases_;
+        DeformationPolicy policy_;
+        DeformUBO ubo_;
+        DeformUBO buildUbo_;
+
+        glm::vec3 restMin_;
+        glm::vec3 restMax_;
+        std::vector<float> targetMaxDeltas_;
+
+        uint32_t refitsSinceBuild_ = 0;
+        uint32_t refitCount_ = 0;
+        uint32_t rebuildCount_ = 0;
+
+        std::shared_ptr<StorageBuffer<glm::vec4>> restBuffer_;
+        std::shared_ptr<StorageBuffer<SkinWeights>> skinBuffer_;
+        std::shared_ptr<StorageBuffer<MorphDelta>> morphBuffer_;
+        std::vector<UniformBuffer<DeformUBO>> uniformBuffers_;
+
+        std::shared_ptr<Descriptor> descriptor_;
+        std::shared_ptr<ComputePipeline> pipeline_;
+
+        std::unique_ptr<CommandBuffers> commandBuffers_;
+        std::vector<Fence> fences_;
+    };
+
+} // namespace estun
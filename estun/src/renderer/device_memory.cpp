@@ -34,7 +34,9 @@ estun::DeviceMemory::~DeviceMemory()
 {
 	if (memory != nullptr)
 	{
-		vkFreeMemory(DeviceLocator::GetLogicalDevice(), memory, nullptr);
+		DeviceLocator::GetDevice().GetDeletionQueue().Push([handle = memory]() {
+			vkFreeMemory(DeviceLocator::GetLogicalDevice(), handle, nullptr);
+		});
 		memory = nullptr;
 	}
 }
@@ -0,0 +1,78 @@
+#include "renderer/dynamic_resolution.h"
+
+#include <algorithm>
+#include <cmath>
+
+estun::DynamicResolution::DynamicResolution(const DynamicResolutionConfig &config)
+    : config_(config)
+{
+    config_.step = std::max(config_.step, 0.01f);
+    config_.minScale = Snap(std::max(config_.minScale, config_.step));
+    config_.maxScale = std::max(Snap(config_.maxScale), config_.minScale);
+    scale_ = config_.maxScale;
+}
+
+bool estun::DynamicResolution::Update(float milliseconds)
+{
+    if (settle_ > 0)
+    {
+        settle_--;
+        return false;
+    }
+
+    average_ = hasAverage_ ? average_ + config_.smoothing * (milliseconds - average_) : milliseconds;
+    hasAverage_ = true;
+
+    const float target = config_.targetMilliseconds;
+    if (average_ <= target && average_ >= target * (1.0f - config_.tolerance))
+    {
+        return false;
+    }
+
+    // Aims at the middle of the band, rounding down keeps a raised scale within the target
+    const float desired = scale_ * std::sqrt(target * (1.0f - 0.5f * config_.tolerance) / std::max(average_, 0.001f));
+    const float scale = std::clamp(Snap(desired), config_.minScale, config_.maxScale);
+    if (scale == scale_)
+    {
+        return false;
+    }
+
+    scale_ = scale;
+    settle_ = config_.settleFrames;
+    hasAverage_ = false;
+    return true;
+}
+
+void estun::DynamicResolution::Reset()
+{
+    hasAverage_ = false;
+    settle_ = config_.settleFrames;
+}
+
+bool estun::DynamicResolution::Maximize()
+{
+    if (scale_ == config_.maxScale)
+    {
+        return false;
+    }
+
+    scale_ = config_.maxScale;
+    Reset();
+    return true;
+}
+
+VkExtent2D estun::DynamicResolution::GetExtent(const VkExtent2D &fullExtent) const
+{
+    VkExtent2D extent;
+    extent.width = std::max(1u, static_cast<uint32_t>(std::lround(fullExtent.width * scale_)));
+    extent.height = std::max(1u, static_cast<uint32_t>(std::lround(fullExtent.height * scale_)));
+    extent.width = std::min(extent.width, fullExtent.width);
+    extent.height = std::min(extent.height, fullExtent.height);
+    return extent;
+}
+
+float estun::DynamicResolution::Snap(float scale) const
+{
+    // The epsilon keeps exact multiples from falling one step short
+    return std::floor(scale / config_.step + 1e-3f) * config_.step;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "renderer/common.h"
+
+namespace estun
+{
+
+    struct DynamicResolutionConfig
+    {
+        // Device time of a frame the scale is chosen for
+        float targetMilliseconds = 16.0f;
+        float minScale = 0.5f;
+        float maxScale = 1.0f;
+        // Scales are multiples of the step, every change restarts the accumulation
+        float step = 0.05f;
+        // Frame times down to this fraction below the target keep the scale
+        float tolerance = 0.2f;
+        // Weight of a new frame time in the running average
+        float smoothing = 0.2f;
+        // Frames ignored after a change, they were timed with the previous scale
+        uint32_t settleFrames = 8;
+    };
+
+    // Picks the fraction of the full extent the frame is traced at from the device time of finished
+    // frames. The trace cost follows the pixel count, so the scale moves with the square root of the
+    // ratio between target and measured time, and only once the average leaves the tolerance band.
+    class DynamicResolution
+    {
+    public:
+        explicit DynamicResolution(const DynamicResolutionConfig &config = DynamicResolutionConfig());
+
+        // True when the scale changed and the frames trace the new extent
+        bool Update(float milliseconds);
+        // Forgets the measured times, e.g. when the work per pixel changed
+        void Reset();
+        // Back to the largest scale, true when it was lower
+        bool Maximize();
+
+        // At least one pixel in each direction
+        VkExtent2D GetExtent(const VkExtent2D &fullExtent) const;
+        float GetScale() const { return scale_; }
+        float GetAverageMilliseconds() const { return average_; }
+
+    private:
+        float Snap(float scale) const;
+
+        DynamicResolutionConfig config_;
+        float scale_;
+        float average_ = 0.0f;
+        bool hasAverage_ = false;
+        uint32_t settle_ = 0;
+    };
+
+} // namespace estun
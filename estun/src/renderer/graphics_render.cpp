@@ -30,6 +30,25 @@ void estun::GraphicsRender::Create()
     commandBuffers_.reset(new CommandBuffers(CommandPoolLocator::GetGraphicsPool(), size));
     ES_CORE_INFO("* Command buffers done");
 
+    if (toDefault_)
+    {
+        renderPass_.reset(new RenderPass(hasMsaa));
+    }
+    else
+    {
+        renderPass_.reset(new RenderPass(hasMsaa, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL));
+    }
+
+    ES_CORE_INFO("* Render pass done");
+
+    CreateFramebuffers();
+}
+
+void estun::GraphicsRender::CreateFramebuffers()
+{
+    auto msaa = ContextLocator::GetContext()->GetMsaaSamples();
+    bool hasMsaa = msaa != VK_SAMPLE_COUNT_1_BIT;
+
     colorResources_.reset(new ColorResources(ContextLocator::GetSwapChain()->GetExtent(), VK_SAMPLE_COUNT_1_BIT));
     ES_CORE_INFO("* Color resources done");
 
@@ -42,17 +61,7 @@ void estun::GraphicsRender::Create()
         ES_CORE_INFO("* Color resolve resources done");
     }
 
-    if (toDefault_)
-    {
-        renderPass_.reset(new RenderPass(hasMsaa));
-    }
-    else
-    {
-        renderPass_.reset(new RenderPass(hasMsaa, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL));
-    }
-
-    ES_CORE_INFO("* Render pass done");
-
+    auto size = static_cast<uint32_t>(ContextLocator::GetSwapChain()->GetImages().size());
     for (int i = 0; i < size; i++)
     {
         std::vector<ImageView *> attachments;
@@ -90,13 +99,18 @@ void estun::GraphicsRender::Create()
     ES_CORE_INFO("* Framebuffers done");
 }
 
-void estun::GraphicsRender::Destroy()
+void estun::GraphicsRender::DestroyFramebuffers()
 {
     framebuffers_.clear();
-    renderPass_.reset();
     colorResolveResources_.reset();
     depthResources_.reset();
     colorResources_.reset();
+}
+
+void estun::GraphicsRender::Destroy()
+{
+    DestroyFramebuffers();
+    renderPass_.reset();
     commandBuffers_.reset();
 }
 
@@ -110,6 +124,12 @@ void estun::GraphicsRender::Recreate()
     }
 }
 
+void estun::GraphicsRender::Resize()
+{
+    DestroyFramebuffers();
+    CreateFramebuffers();
+}
+
 std::shared_ptr<estun::GraphicsPipeline> estun::GraphicsRender::CreatePipeline(
     const std::vector<Shader> shaders,
     const std::shared_ptr<Descriptor> descriptor,
@@ -133,6 +153,22 @@ void estun::GraphicsRender::StartDrawInCurrent()
 {
     commandBuffers_->Begin(ContextLocator::GetImageIndex());
     renderPass_->Begin(framebuffers_[ContextLocator::GetImageIndex()], GetCurrCommandBuffer());
+
+    const VkExtent2D &extent = ContextLocator::GetSwapChain()->GetExtent();
+
+    VkViewport viewport = {};
+    viewport.x = 0.0f;
+    viewport.y = static_cast<float>(extent.height);
+    viewport.width = static_cast<float>(extent.width);
+    viewport.height = -static_cast<float>(extent.height);
+    viewport.minDepth = 0.0f;
+    viewport.maxDepth = 1.0f;
+    vkCmdSetViewport(GetCurrCommandBuffer(), 0, 1, &viewport);
+
+    VkRect2D scissor = {};
+    scissor.offset = {0, 0};
+    scissor.extent = extent;
+    vkCmdSetScissor(GetCurrCommandBuffer(), 0, 1, &scissor);
 }
 
 void estun::GraphicsRender::RecordDrawInCurrent()
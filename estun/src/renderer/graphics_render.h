@@ -38,6 +38,8 @@ namespace estun
         void Create();
         void Destroy();
         void Recreate();
+        // Only the attachments and framebuffers follow the swap chain size, the pipelines are kept
+        void Resize();
             
         std::shared_ptr<GraphicsPipeline> CreatePipeline(
             const std::vector<Shader> shaders,  
@@ -69,6 +71,9 @@ namespace estun
         std::vector<std::shared_ptr<GraphicsPipeline>> &GetPipelines() { return pipelines_; }
 
     private:
+        void CreateFramebuffers();
+        void DestroyFramebuffers();
+
         bool toDefault_;
         std::unique_ptr<CommandBuffers> commandBuffers_;
         std::shared_ptr<ColorResources> colorResources_;
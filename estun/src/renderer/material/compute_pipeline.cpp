@@ -7,7 +7,8 @@
 
 estun::ComputePipeline::ComputePipeline(
     const std::string computeShaderName,
-    std::shared_ptr<Descriptor> descriptor)
+    std::shared_ptr<Descriptor> descriptor,
+    const SpecializationConstants &constants)
     : descriptor_(descriptor)
 {
     computeShaderModule_ = std::make_unique<ShaderModule>(computeShaderName);
@@ -16,7 +17,7 @@ estun::ComputePipeline::ComputePipeline(
     pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
     pipelineInfo.layout = descriptor->GetPipelineLayout().GetPipelineLayout();
     pipelineInfo.flags = 0;
-    pipelineInfo.stage = computeShaderModule_->CreateShaderStage(VK_SHADER_STAGE_COMPUTE_BIT);
+    pipelineInfo.stage = computeShaderModule_->CreateShaderStage(VK_SHADER_STAGE_COMPUTE_BIT, constants.GetInfo());
     
     VK_CHECK_RESULT(vkCreateComputePipelines(DeviceLocator::GetLogicalDevice(), nullptr, 1, &pipelineInfo, nullptr, &pipeline_), "Failed to create compute pipeline");
 }
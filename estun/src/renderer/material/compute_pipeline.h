@@ -1,6 +1,7 @@
 #pragma once
 
 #include "renderer/common.h"
+#include "renderer/material/specialization_constants.h"
 
 namespace estun
 {
@@ -18,7 +19,8 @@ namespace estun
 
         ComputePipeline(
             const std::string computeShaderName,
-            std::shared_ptr<Descriptor> descriptor);
+            std::shared_ptr<Descriptor> descriptor,
+            const SpecializationConstants &constants = SpecializationConstants());
         ~ComputePipeline();
 
         void Bind(VkCommandBuffer &commandBuffer);
@@ -6,11 +6,14 @@
 #include "renderer/material/descriptor_pool.h"
 #include "renderer/material/descriptor_set_layout.h"
 #include "renderer/material/pipeline_layout.h"
+#include "renderer/material/resource_table.h"
 //#include "renderer/ray_tracing/TopLevelAccelerationStructure.h"
 #include "renderer/buffers/buffer.h"
 #include "renderer/material/texture.h"
 
-estun::Descriptor::Descriptor(const std::vector<DescriptorBinding> &descriptorBindings, const size_t maxSets)
+estun::Descriptor::Descriptor(const std::vector<DescriptorBinding> &descriptorBindings, const size_t maxSets, std::shared_ptr<ResourceTable> resourceTable)
+    : maxSets(maxSets),
+      resourceTable(resourceTable)
 {
     std::map<uint32_t, VkDescriptorType> bindingTypes;
 
@@ -26,6 +29,24 @@ estun::Descriptor::Descriptor(const std::vector<DescriptorBinding> &descriptorBi
     descriptorSetLayout.reset(new DescriptorSetLayout(descriptorBindings));
     descriptorSets.reset(new DescriptorSets(*descriptorPool, *descriptorSetLayout, bindingTypes, maxSets));
 
+    Update(descriptorBindings);
+
+    CreatePipelineLayout({}, false);
+}
+
+void estun::Descriptor::CreatePipelineLayout(VkPushConstantRange pushConstantRange, bool flag)
+{
+    std::vector<const DescriptorSetLayout *> layouts = {descriptorSetLayout.get()};
+    if (resourceTable != nullptr)
+    {
+        layouts.push_back(&resourceTable->GetDescriptorSetLayout());
+    }
+
+    pipelineLayout.reset(new PipelineLayout(layouts, pushConstantRange, flag));
+}
+
+void estun::Descriptor::Update(const std::vector<DescriptorBinding> &descriptorBindings)
+{
     for (int index = 0; index < maxSets; index++)
     {
         std::vector<VkWriteDescriptorSet> descriptorWrites;
@@ -39,16 +60,24 @@ estun::Descriptor::Descriptor(const std::vector<DescriptorBinding> &descriptorBi
 
         for (int binding = 0; binding < descriptorBindings.size(); binding++)
         {
-            for (int j = 0; j < descriptorBindings[binding].descriptable_.size(); j++)
+            const auto &descriptables = descriptorBindings[binding].descriptable_;
+
+            // A single descriptor with several descriptables has one per set, e.g. per swap chain image uniforms
+            if (descriptorBindings[binding].descriptorCount_ == 1 && descriptables.size() > 1)
             {
-                infos.push_back(descriptorBindings[binding].descriptable_[j]->GetInfo());
+                infos.push_back(descriptables[index % descriptables.size()]->GetInfo());
                 descriptorWrites.push_back(descriptorSets->Bind(index, descriptorBindings[binding].binding_, infos.back()));
+                continue;
+            }
+
+            for (int j = 0; j < descriptables.size(); j++)
+            {
+                infos.push_back(descriptables[j]->GetInfo());
+                descriptorWrites.push_back(descriptorSets->Bind(index, descriptorBindings[binding].binding_, infos.back(), 1, j));
             }
         }
         descriptorSets->UpdateDescriptors(index, descriptorWrites);
     }
-
-    pipelineLayout.reset(new PipelineLayout(*descriptorSetLayout, {}));
 }
 
 estun::Descriptor::~Descriptor()
@@ -76,12 +105,16 @@ estun::PipelineLayout &estun::Descriptor::GetPipelineLayout() const
 
 void estun::Descriptor::Bind(VkCommandBuffer &commandBuffer,  VkPipelineBindPoint point)
 {
-    VkDescriptorSet vkDescriptorSets[] = {descriptorSets->GetDescriptorSet(ContextLocator::GetImageIndex())};
+    std::vector<VkDescriptorSet> vkDescriptorSets = {descriptorSets->GetDescriptorSet(ContextLocator::GetImageIndex())};
+    if (resourceTable != nullptr)
+    {
+        vkDescriptorSets.push_back(resourceTable->GetDescriptorSet(ContextLocator::GetImageIndex()));
+    }
     vkCmdBindDescriptorSets(
         commandBuffer,
         point,
         pipelineLayout->GetPipelineLayout(),
-        0, 1,
-        vkDescriptorSets,
+        0, static_cast<uint32_t>(vkDescriptorSets.size()),
+        vkDescriptorSets.data(),
         0, nullptr);
 }
@@ -15,7 +15,10 @@ namespace estun
     class TopLevelAccelerationStructure;
     class Buffer;
     class Texture;
+    class ResourceTable;
 
+    // Set 0 holds the bindings given here, one set per swap chain image. A resource table, when given,
+    // is shared by every image and bound as set 1.
     class Descriptor
     {
     public:
@@ -25,11 +28,14 @@ namespace estun
         Descriptor &operator=(const Descriptor &) = delete;
         Descriptor &operator=(Descriptor &&) = delete;
 
-        explicit Descriptor(const std::vector<DescriptorBinding> &descriptorBindings, size_t maxSets);
+        explicit Descriptor(const std::vector<DescriptorBinding> &descriptorBindings, size_t maxSets, std::shared_ptr<ResourceTable> resourceTable = nullptr);
         ~Descriptor();
 
         void Bind(VkCommandBuffer &commandBuffer, VkPipelineBindPoint point);
 
+        // Rewrites every set against new resources with the same layout, no set may be in use
+        void Update(const std::vector<DescriptorBinding> &descriptorBindings);
+
         template <typename T>
         void AddPushConstants(PushConstant<T> &constant)
         {
@@ -38,7 +44,7 @@ namespace estun
             range.offset = 0;
             range.size = constant.GetSize();
 
-            pipelineLayout.reset(new PipelineLayout(*descriptorSetLayout, range, true));
+            CreatePipelineLayout(range, true);
         }
 
         DescriptorSetLayout &GetDescriptorSetLayout() const;
@@ -46,6 +52,11 @@ namespace estun
         PipelineLayout &GetPipelineLayout() const;
 
     private:
+        void CreatePipelineLayout(VkPushConstantRange pushConstantRange, bool flag);
+
+        size_t maxSets;
+        std::shared_ptr<ResourceTable> resourceTable;
+
         std::unique_ptr<DescriptorPool> descriptorPool;
         std::unique_ptr<DescriptorSetLayout> descriptorSetLayout;
         std::unique_ptr<DescriptorSets> descriptorSets;
@@ -4,6 +4,8 @@
 #include "renderer/material/descriptable.h"
 #include "renderer/buffers/uniform_buffer.h"
 #include "renderer/buffers/storage_buffer.h"
+#include "renderer/buffers/growable_buffer.h"
+#include "renderer/buffers/feedback_buffer.h"
 #include "renderer/material/texture.h"
 #include "renderer/context/image.h"
 #include "renderer/ray_tracing/top_level_acceleration_structure.h"
@@ -28,13 +30,15 @@ struct DescriptorBinding
     uint32_t descriptorCount_; // Number of descriptors to bind
     VkDescriptorType type_;    // Type of the bound descriptor(s)
     VkShaderStageFlags stage_; // Shader stage at which the bound resources will be available
+    VkDescriptorBindingFlags flags_; // Descriptor indexing behaviour, zero for bindings written once per set
 
-    DescriptorBinding(uint32_t binding, std::vector<Descriptable*> descriptable, uint32_t descriptorCount, VkDescriptorType type, VkShaderStageFlags stage)
+    DescriptorBinding(uint32_t binding, std::vector<Descriptable*> descriptable, uint32_t descriptorCount, VkDescriptorType type, VkShaderStageFlags stage, VkDescriptorBindingFlags flags = 0)
         : binding_(binding),
           descriptable_(descriptable),
           descriptorCount_(descriptorCount),
           type_(type),
-          stage_(stage)
+          stage_(stage),
+          flags_(flags)
     {
     }
 
@@ -56,6 +60,24 @@ struct DescriptorBinding
         return DescriptorBinding(binding, descriptables, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, stage);
     }
     
+    template <class T>
+    static DescriptorBinding Storage(uint32_t binding, std::shared_ptr<GrowableBuffer<T>> storageBuffer, VkShaderStageFlags stage)
+    {
+        std::vector<Descriptable*> descriptables = {storageBuffer.get()};
+        return DescriptorBinding(binding, descriptables, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, stage);
+    }
+
+    // One buffer per set, like the uniform buffers
+    static DescriptorBinding Storage(uint32_t binding, std::vector<FeedbackBuffer> &feedbackBuffers, VkShaderStageFlags stage)
+    {
+        std::vector<Descriptable*> descriptables = {};
+        for (int i = 0; i < feedbackBuffers.size(); i++)
+        {
+            descriptables.push_back(&feedbackBuffers[i]);
+        }
+        return DescriptorBinding(binding, descriptables, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, stage);
+    }
+
     static DescriptorBinding Storage(uint32_t binding, std::shared_ptr<IndexBuffer> indexBuffer, VkShaderStageFlags stage)
     {
         std::vector<Descriptable*> descriptables = {indexBuffer.get()};
@@ -68,6 +90,12 @@ struct DescriptorBinding
         return DescriptorBinding(binding, descriptables, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, stage);
     }
 
+    static DescriptorBinding Storage(uint32_t binding, std::shared_ptr<InstanceBuffer> instanceBuffer, VkShaderStageFlags stage)
+    {
+        std::vector<Descriptable*> descriptables = {instanceBuffer.get()};
+        return DescriptorBinding(binding, descriptables, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, stage);
+    }
+
     static DescriptorBinding Texture(uint32_t binding, Texture &texture, VkShaderStageFlags stage)
     {
         std::vector<Descriptable*> descriptables = {&texture};
@@ -84,6 +112,18 @@ struct DescriptorBinding
         return DescriptorBinding(binding, descriptables, static_cast<uint32_t>(textures.size()), VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, stage);
     }
 
+    // Array written slot by slot, also while command buffers that bind it are pending. Slots the shaders
+    // never reach may stay empty. A variable count binding must have the highest number in its layout.
+    static DescriptorBinding Bindless(uint32_t binding, uint32_t maxCount, VkDescriptorType type, VkShaderStageFlags stage, bool variableCount = false)
+    {
+        VkDescriptorBindingFlags flags = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT;
+        if (variableCount)
+        {
+            flags |= VK_DESCRIPTOR_BINDING_VARIABLE_DESCRIPTOR_COUNT_BIT;
+        }
+        return DescriptorBinding(binding, {}, maxCount, type, stage, flags);
+    }
+
     static DescriptorBinding AccelerationStructure(uint32_t binding, std::shared_ptr<TLAS> tlas, VkShaderStageFlags stage)
     {
         std::vector<Descriptable*> descriptables = {tlas.get()};
@@ -5,14 +5,17 @@
 estun::DescriptorPool::DescriptorPool(const std::vector<DescriptorBinding> &descriptorBindings, const size_t maxSets)
 {
     std::vector<VkDescriptorPoolSize> poolSizes;
+    bool updateAfterBind = false;
 
     for (const auto &binding : descriptorBindings)
     {
         poolSizes.push_back(VkDescriptorPoolSize{binding.type_, static_cast<uint32_t>(binding.descriptorCount_ * maxSets)});
+        updateAfterBind = updateAfterBind || (binding.flags_ & VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT) != 0;
     }
 
     VkDescriptorPoolCreateInfo poolInfo = {};
     poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.flags = updateAfterBind ? VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT : 0;
     poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
     poolInfo.pPoolSizes = poolSizes.data();
     poolInfo.maxSets = static_cast<uint32_t>(maxSets);
@@ -7,6 +7,8 @@
 estun::DescriptorSetLayout::DescriptorSetLayout(const std::vector<DescriptorBinding> &descriptorBindings) 
 {
     std::vector<VkDescriptorSetLayoutBinding> layoutBindings;
+    std::vector<VkDescriptorBindingFlags> bindingFlags;
+    VkDescriptorBindingFlags usedFlags = 0;
 
     for (const auto &binding : descriptorBindings)
     {
@@ -17,10 +19,19 @@ estun::DescriptorSetLayout::DescriptorSetLayout(const std::vector<DescriptorBind
         b.stageFlags = binding.stage_;
 
         layoutBindings.push_back(b);
+        bindingFlags.push_back(binding.flags_);
+        usedFlags |= binding.flags_;
     }
 
+    VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo = {};
+    bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+    bindingFlagsInfo.bindingCount = static_cast<uint32_t>(bindingFlags.size());
+    bindingFlagsInfo.pBindingFlags = bindingFlags.data();
+
     VkDescriptorSetLayoutCreateInfo layoutInfo = {};
     layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.pNext = usedFlags != 0 ? &bindingFlagsInfo : nullptr;
+    layoutInfo.flags = (usedFlags & VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT) != 0 ? VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT : 0;
     layoutInfo.bindingCount = static_cast<uint32_t>(layoutBindings.size());
     layoutInfo.pBindings = layoutBindings.data();
 
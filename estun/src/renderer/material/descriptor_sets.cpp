@@ -12,14 +12,23 @@ estun::DescriptorSets::DescriptorSets(
 	const DescriptorPool &descriptorPool,
 	const DescriptorSetLayout &layout,
 	std::map<uint32_t, VkDescriptorType> bindingTypes,
-	const size_t size)
+	const size_t size,
+	const uint32_t variableCount)
 	: descriptorPool(descriptorPool),
 	  bindingTypes(std::move(bindingTypes))
 {
 	std::vector<VkDescriptorSetLayout> layouts(size, layout.GetLayout());
 
+	// Length of the variable count binding, the last one of the layout, in every set
+	std::vector<uint32_t> variableCounts(size, variableCount);
+	VkDescriptorSetVariableDescriptorCountAllocateInfo variableCountInfo = {};
+	variableCountInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_VARIABLE_DESCRIPTOR_COUNT_ALLOCATE_INFO;
+	variableCountInfo.descriptorSetCount = static_cast<uint32_t>(size);
+	variableCountInfo.pDescriptorCounts = variableCounts.data();
+
 	VkDescriptorSetAllocateInfo allocInfo = {};
 	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.pNext = variableCount != 0 ? &variableCountInfo : nullptr;
 	allocInfo.descriptorPool = descriptorPool.GetDescriptorPool();
 	allocInfo.descriptorSetCount = static_cast<uint32_t>(size);
 	allocInfo.pSetLayouts = layouts.data();
@@ -43,13 +52,13 @@ estun::DescriptorSets::~DescriptorSets()
 	//}
 }
 
-VkWriteDescriptorSet estun::DescriptorSets::Bind(const uint32_t index, const uint32_t binding, const DescriptableInfo &info, const uint32_t count) const
+VkWriteDescriptorSet estun::DescriptorSets::Bind(const uint32_t index, const uint32_t binding, const DescriptableInfo &info, const uint32_t count, const uint32_t arrayElement) const
 {
 	VkWriteDescriptorSet descriptorWrite = {};
 	descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
 	descriptorWrite.dstSet = descriptorSets[index];
 	descriptorWrite.dstBinding = binding;
-	descriptorWrite.dstArrayElement = 0;
+	descriptorWrite.dstArrayElement = arrayElement;
 	descriptorWrite.descriptorType = GetBindingType(binding);
 	descriptorWrite.descriptorCount = count;
 	if (info.Collide())
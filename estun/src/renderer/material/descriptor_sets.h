@@ -22,13 +22,14 @@ public:
 		const DescriptorPool &descriptorPool,
 		const DescriptorSetLayout &layout,
 		std::map<uint32_t, VkDescriptorType> bindingTypes,
-		size_t size);
+		size_t size,
+		uint32_t variableCount = 0);
 
 	~DescriptorSets();
 
 	VkDescriptorSet GetDescriptorSet(uint32_t index) const;
 
-	VkWriteDescriptorSet Bind(uint32_t index, uint32_t binding, const DescriptableInfo &info, uint32_t count = 1) const;
+	VkWriteDescriptorSet Bind(uint32_t index, uint32_t binding, const DescriptableInfo &info, uint32_t count = 1, uint32_t arrayElement = 0) const;
 
 	void UpdateDescriptors(uint32_t index, const std::vector<VkWriteDescriptorSet> &descriptorWrites);
 
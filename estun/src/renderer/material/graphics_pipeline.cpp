@@ -54,26 +54,20 @@ void estun::GraphicsPipeline::Create(std::unique_ptr<RenderPass> &renderPass)
     inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
     inputAssembly.primitiveRestartEnable = VK_FALSE;
 
-    VkViewport viewport = {};
-    viewport.x = 0.0f;
-    viewport.y = static_cast<float>(ContextLocator::GetSwapChain()->GetExtent().height);
-    //viewport.y =  0
-    viewport.width = static_cast<float>(ContextLocator::GetSwapChain()->GetExtent().width);
-    viewport.height = -static_cast<float>(ContextLocator::GetSwapChain()->GetExtent().height);
-    //viewport.height = static_cast<float>(ContextLocator::GetSwapChain()->GetExtent().height);
-    viewport.minDepth = 0.0f;
-    viewport.maxDepth = 1.0f;
-
-    VkRect2D scissor = {};
-    scissor.offset = {0, 0};
-    scissor.extent = ContextLocator::GetSwapChain()->GetExtent();
-
+    // Viewport and scissor are set when recording, resizing keeps the pipeline
     VkPipelineViewportStateCreateInfo viewportState = {};
     viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
     viewportState.viewportCount = 1;
-    viewportState.pViewports = &viewport;
+    viewportState.pViewports = nullptr;
     viewportState.scissorCount = 1;
-    viewportState.pScissors = &scissor;
+    viewportState.pScissors = nullptr;
+
+    const std::vector<VkDynamicState> dynamicStates = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+
+    VkPipelineDynamicStateCreateInfo dynamicState = {};
+    dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
+    dynamicState.pDynamicStates = dynamicStates.data();
 
     VkPipelineRasterizationStateCreateInfo rasterizer = {};
     rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
@@ -143,7 +137,7 @@ void estun::GraphicsPipeline::Create(std::unique_ptr<RenderPass> &renderPass)
     pipelineInfo.pMultisampleState = &multisampling;
     pipelineInfo.pDepthStencilState = &depthStencil;
     pipelineInfo.pColorBlendState = &colorBlending;
-    pipelineInfo.pDynamicState = nullptr;      // Optional
+    pipelineInfo.pDynamicState = &dynamicState;
     pipelineInfo.basePipelineHandle = nullptr; // Optional
     pipelineInfo.basePipelineIndex = -1;       // Optional
     pipelineInfo.layout = descriptor_->GetPipelineLayout().GetPipelineLayout();
@@ -3,13 +3,22 @@
 #include "renderer/material/descriptor_set_layout.h"
 
 estun::PipelineLayout::PipelineLayout(const DescriptorSetLayout& descriptorSetLayout, VkPushConstantRange pushConstantRange, bool flag)
+	: PipelineLayout(std::vector<const DescriptorSetLayout *>{&descriptorSetLayout}, pushConstantRange, flag)
 {
-	VkDescriptorSetLayout descriptorSetLayouts[] = { descriptorSetLayout.GetLayout() };
+}
+
+estun::PipelineLayout::PipelineLayout(const std::vector<const DescriptorSetLayout *> &descriptorSetLayouts, VkPushConstantRange pushConstantRange, bool flag)
+{
+	std::vector<VkDescriptorSetLayout> layouts;
+	for (const DescriptorSetLayout *descriptorSetLayout : descriptorSetLayouts)
+	{
+		layouts.push_back(descriptorSetLayout->GetLayout());
+	}
 
 	VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
 	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-	pipelineLayoutInfo.setLayoutCount = 1;
-	pipelineLayoutInfo.pSetLayouts = descriptorSetLayouts;
+	pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(layouts.size());
+	pipelineLayoutInfo.pSetLayouts = layouts.data();
 	pipelineLayoutInfo.pushConstantRangeCount = flag ? 1 : 0; // Optional
 	pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange; // Optional
 
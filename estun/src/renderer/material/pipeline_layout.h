@@ -17,6 +17,8 @@ public:
     PipelineLayout &operator=(PipelineLayout &&) = delete;
 
     PipelineLayout(const DescriptorSetLayout &descriptorSetLayout, VkPushConstantRange pushConstantRange = {}, bool flag = false);
+    // Set i of the shaders uses descriptorSetLayouts[i]
+    PipelineLayout(const std::vector<const DescriptorSetLayout *> &descriptorSetLayouts, VkPushConstantRange pushConstantRange = {}, bool flag = false);
     ~PipelineLayout();
 
     VkPipelineLayout &GetPipelineLayout();
@@ -0,0 +1,191 @@
+#include "renderer/material/resource_table.h"
+#include "renderer/context.h"
+#include "renderer/context/device.h"
+#include "renderer/material/descriptor_binding.h"
+#include "renderer/material/descriptor_pool.h"
+#include "renderer/material/descriptor_set_layout.h"
+#include "renderer/material/descriptor_sets.h"
+#include "core/core.h"
+
+#include <algorithm>
+
+estun::ResourceTable::ResourceTable(const ResourceTableConfig &config)
+{
+    VkPhysicalDeviceVulkan12Properties vulkan12Properties = {};
+    vulkan12Properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_PROPERTIES;
+
+    VkPhysicalDeviceProperties2 deviceProperties2 = {};
+    deviceProperties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    deviceProperties2.pNext = &vulkan12Properties;
+    vkGetPhysicalDeviceProperties2(DeviceLocator::GetPhysicalDevice(), &deviceProperties2);
+
+    textures_.capacity = std::min({config.maxTextures,
+                                   vulkan12Properties.maxDescriptorSetUpdateAfterBindSampledImages,
+                                   vulkan12Properties.maxPerStageDescriptorUpdateAfterBindSampledImages,
+                                   vulkan12Properties.maxDescriptorSetUpdateAfterBindSamplers,
+                                   vulkan12Properties.maxPerStageDescriptorUpdateAfterBindSamplers});
+    buffers_.capacity = std::min({config.maxBuffers,
+                                  vulkan12Properties.maxDescriptorSetUpdateAfterBindStorageBuffers,
+                                  vulkan12Properties.maxPerStageDescriptorUpdateAfterBindStorageBuffers});
+    if (textures_.capacity < config.maxTextures || buffers_.capacity < config.maxBuffers)
+    {
+        ES_CORE_WARN(std::string("Resource table limited to ") + std::to_string(textures_.capacity) + std::string(" textures and ") +
+                     std::to_string(buffers_.capacity) + std::string(" buffers by the device"));
+    }
+
+    // Buffers come last so their array can be allocated with a variable count
+    const std::vector<DescriptorBinding> bindings = {
+        DescriptorBinding::Bindless(TextureBinding, textures_.capacity, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, config.stage),
+        DescriptorBinding::Bindless(BufferBinding, buffers_.capacity, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, config.stage, true)};
+
+    std::map<uint32_t, VkDescriptorType> bindingTypes;
+    for (const auto &binding : bindings)
+    {
+        bindingTypes.insert(std::make_pair(binding.binding_, binding.type_));
+    }
+
+    setCount_ = static_cast<uint32_t>(ContextLocator::GetSwapChain()->GetImageViews().size());
+    pending_.resize(setCount_);
+
+    descriptorPool_.reset(new DescriptorPool(bindings, setCount_));
+    descriptorSetLayout_.reset(new DescriptorSetLayout(bindings));
+    descriptorSets_.reset(new DescriptorSets(*descriptorPool_, *descriptorSetLayout_, bindingTypes, setCount_, buffers_.capacity));
+}
+
+estun::ResourceTable::~ResourceTable()
+{
+    descriptorSets_.reset();
+    descriptorSetLayout_.reset();
+    descriptorPool_.reset();
+}
+
+uint32_t estun::ResourceTable::AddTexture(Descriptable *texture)
+{
+    return Add(textures_, TextureBinding, texture);
+}
+
+uint32_t estun::ResourceTable::AddBuffer(Descriptable *buffer)
+{
+    return Add(buffers_, BufferBinding, buffer);
+}
+
+void estun::ResourceTable::SetTexture(uint32_t handle, Descriptable &texture)
+{
+    Set(textures_, TextureBinding, handle, texture);
+}
+
+void estun::ResourceTable::SetBuffer(uint32_t handle, Descriptable &buffer)
+{
+    Set(buffers_, BufferBinding, handle, buffer);
+}
+
+void estun::ResourceTable::RemoveTexture(uint32_t handle)
+{
+    Remove(textures_, TextureBinding, handle);
+}
+
+void estun::ResourceTable::RemoveBuffer(uint32_t handle)
+{
+    Remove(buffers_, BufferBinding, handle);
+}
+
+void estun::ResourceTable::Update(uint32_t imageIndex)
+{
+    if (imageIndex >= setCount_)
+    {
+        return;
+    }
+
+    for (const auto &write : pending_[imageIndex])
+    {
+        Write(imageIndex, static_cast<uint32_t>(write.first >> 32), static_cast<uint32_t>(write.first), write.second);
+    }
+    pending_[imageIndex].clear();
+}
+
+VkDescriptorSet estun::ResourceTable::GetDescriptorSet(uint32_t imageIndex) const
+{
+    return descriptorSets_->GetDescriptorSet(std::min(imageIndex, setCount_ - 1));
+}
+
+uint32_t estun::ResourceTable::Add(Slots &slots, uint32_t binding, Descriptable *descriptable)
+{
+    uint32_t handle = InvalidHandle;
+    if (!slots.free.empty())
+    {
+        // Lowest first keeps the reached part of the arrays short
+        std::pop_heap(slots.free.begin(), slots.free.end(), std::greater<uint32_t>());
+        handle = slots.free.back();
+        slots.free.pop_back();
+    }
+    else if (slots.next < slots.capacity)
+    {
+        handle = slots.next++;
+    }
+    else
+    {
+        ES_CORE_WARN(std::string("Resource table binding ") + std::to_string(binding) + std::string(" is full"));
+        return InvalidHandle;
+    }
+
+    if (handle >= slots.filled.size())
+    {
+        slots.filled.resize(handle + 1, false);
+    }
+    if (descriptable != nullptr)
+    {
+        Set(slots, binding, handle, *descriptable);
+    }
+    return handle;
+}
+
+void estun::ResourceTable::Set(Slots &slots, uint32_t binding, uint32_t handle, Descriptable &descriptable)
+{
+    if (handle >= slots.next)
+    {
+        return;
+    }
+
+    const DescriptableInfo info = descriptable.GetInfo();
+    const uint64_t key = (static_cast<uint64_t>(binding) << 32) | handle;
+
+    // No frame reads an empty slot, the update after bind sets take it while the frames run
+    if (!slots.filled[handle])
+    {
+        for (uint32_t set = 0; set < setCount_; set++)
+        {
+            Write(set, binding, handle, info);
+            pending_[set].erase(key);
+        }
+        slots.filled[handle] = true;
+        return;
+    }
+
+    for (auto &pending : pending_)
+    {
+        pending[key] = info;
+    }
+}
+
+void estun::ResourceTable::Write(uint32_t set, uint32_t binding, uint32_t handle, const DescriptableInfo &info)
+{
+    descriptorSets_->UpdateDescriptors(set, {descriptorSets_->Bind(set, binding, info, 1, handle)});
+}
+
+void estun::ResourceTable::Remove(Slots &slots, uint32_t binding, uint32_t handle)
+{
+    if (handle >= slots.next)
+    {
+        return;
+    }
+
+    // Partially bound arrays may keep the stale descriptor, it is simply never reached again
+    const uint64_t key = (static_cast<uint64_t>(binding) << 32) | handle;
+    for (auto &pending : pending_)
+    {
+        pending.erase(key);
+    }
+    slots.filled[handle] = false;
+    slots.free.push_back(handle);
+    std::push_heap(slots.free.begin(), slots.free.end(), std::greater<uint32_t>());
+}
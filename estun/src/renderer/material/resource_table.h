@@ -0,0 +1,92 @@
+#pragma once
+
+#include "renderer/common.h"
+#include "renderer/material/descriptable.h"
+
+#include <limits>
+
+namespace estun
+{
+
+    class DescriptorPool;
+    class DescriptorSetLayout;
+    class DescriptorSets;
+
+    struct ResourceTableConfig
+    {
+        // Slots of each array, clamped to what the device allows in update after bind sets
+        uint32_t maxTextures = 4096;
+        uint32_t maxBuffers = 1024;
+        VkShaderStageFlags stage = VK_SHADER_STAGE_RAYGEN_BIT_KHR | VK_SHADER_STAGE_MISS_BIT_KHR | VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR |
+                                   VK_SHADER_STAGE_ANY_HIT_BIT_KHR | VK_SHADER_STAGE_INTERSECTION_BIT_KHR | VK_SHADER_STAGE_COMPUTE_BIT;
+    };
+
+    // Bindless textures and storage buffers in descriptor sets that stay bound, the shaders index them by
+    // handle. Binding 0 holds combined image samplers, binding 1 storage buffers of any type. Writing a
+    // slot neither invalidates recorded command buffers nor changes the pipeline layout, so resources can
+    // come and go without recording again. Every swap chain image binds its own set: the first resource
+    // of a slot is written to all of them at once, a replacement only reaches each set in Update, once
+    // the frames that read the previous resource through it are done. A slot must only be removed once
+    // no frame in flight reads it.
+    class ResourceTable
+    {
+    public:
+        static const uint32_t TextureBinding = 0;
+        static const uint32_t BufferBinding = 1;
+        static const uint32_t InvalidHandle = std::numeric_limits<uint32_t>::max();
+
+        ResourceTable(const ResourceTable &) = delete;
+        ResourceTable(ResourceTable &&) = delete;
+        ResourceTable &operator=(const ResourceTable &) = delete;
+        ResourceTable &operator=(ResourceTable &&) = delete;
+
+        explicit ResourceTable(const ResourceTableConfig &config = ResourceTableConfig());
+        ~ResourceTable();
+
+        // Handles stay valid until removed and are reused afterwards. Without a resource the slot stays
+        // empty until Set, shaders must not reach it before. InvalidHandle when the array is full.
+        uint32_t AddTexture(Descriptable *texture = nullptr);
+        uint32_t AddBuffer(Descriptable *buffer = nullptr);
+        void SetTexture(uint32_t handle, Descriptable &texture);
+        void SetBuffer(uint32_t handle, Descriptable &buffer);
+        void RemoveTexture(uint32_t handle);
+        void RemoveBuffer(uint32_t handle);
+
+        // Writes the replacements made since the image's last update into its set. Call after StartDraw,
+        // when the frame that last drew the image is done, and before the frame is submitted.
+        void Update(uint32_t imageIndex);
+
+        uint32_t GetMaxTextures() const { return textures_.capacity; }
+        uint32_t GetMaxBuffers() const { return buffers_.capacity; }
+
+        const DescriptorSetLayout &GetDescriptorSetLayout() const { return *descriptorSetLayout_; }
+        VkDescriptorSet GetDescriptorSet(uint32_t imageIndex) const;
+
+    private:
+        struct Slots
+        {
+            uint32_t capacity = 0;
+            uint32_t next = 0;
+            std::vector<uint32_t> free;
+            // Slots that hold a resource, replacing one is deferred to the updates
+            std::vector<bool> filled;
+        };
+
+        uint32_t Add(Slots &slots, uint32_t binding, Descriptable *descriptable);
+        void Set(Slots &slots, uint32_t binding, uint32_t handle, Descriptable &descriptable);
+        void Remove(Slots &slots, uint32_t binding, uint32_t handle);
+        void Write(uint32_t set, uint32_t binding, uint32_t handle, const DescriptableInfo &info);
+
+        Slots textures_;
+        Slots buffers_;
+
+        std::unique_ptr<DescriptorPool> descriptorPool_;
+        std::unique_ptr<DescriptorSetLayout> descriptorSetLayout_;
+        std::unique_ptr<DescriptorSets> descriptorSets_;
+        uint32_t setCount_ = 0;
+
+        // Replacements each set has not seen yet, keyed by binding and handle, the latest one wins
+        std::vector<std::map<uint64_t, DescriptableInfo>> pending_;
+    };
+
+} // namespace estun
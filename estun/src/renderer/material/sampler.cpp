@@ -28,7 +28,9 @@ estun::Sampler::~Sampler()
 {
     if (sampler != nullptr)
     {
-        vkDestroySampler(DeviceLocator::GetLogicalDevice(), sampler, nullptr);
+        DeviceLocator::GetDevice().GetDeletionQueue().Push([handle = sampler]() {
+            vkDestroySampler(DeviceLocator::GetLogicalDevice(), handle, nullptr);
+        });
         sampler = nullptr;
     }
 }
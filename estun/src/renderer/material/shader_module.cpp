@@ -26,13 +26,14 @@ estun::ShaderModule::~ShaderModule()
 	}
 }
 
-VkPipelineShaderStageCreateInfo estun::ShaderModule::CreateShaderStage(VkShaderStageFlagBits stage) const
+VkPipelineShaderStageCreateInfo estun::ShaderModule::CreateShaderStage(VkShaderStageFlagBits stage, const VkSpecializationInfo *specializationInfo) const
 {
 	VkPipelineShaderStageCreateInfo createInfo = {};
 	createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
 	createInfo.stage = stage;
 	createInfo.module = shaderModule_;
 	createInfo.pName = "main";
+	createInfo.pSpecializationInfo = specializationInfo;
 
 	return createInfo;
 }
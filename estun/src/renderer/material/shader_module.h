@@ -17,7 +17,7 @@ public:
     ShaderModule(const std::vector<char> &code);
     ~ShaderModule();
 
-    VkPipelineShaderStageCreateInfo CreateShaderStage(VkShaderStageFlagBits stage) const;
+    VkPipelineShaderStageCreateInfo CreateShaderStage(VkShaderStageFlagBits stage, const VkSpecializationInfo *specializationInfo = nullptr) const;
 
     VkShaderModule GetModule() const;
 
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "renderer/common.h"
+
+namespace estun
+{
+    class SpecializationConstants
+    {
+    public:
+        template <class T>
+        SpecializationConstants &Set(uint32_t constantId, const T &value)
+        {
+            static_assert(sizeof(T) == sizeof(uint32_t), "Specialization constant must be 32 bit wide");
+            uint32_t raw;
+            std::memcpy(&raw, &value, sizeof(raw));
+            values_[constantId] = raw;
+            return *this;
+        }
+
+        SpecializationConstants &Set(uint32_t constantId, bool value)
+        {
+            return Set<VkBool32>(constantId, value ? VK_TRUE : VK_FALSE);
+        }
+
+        bool Empty() const { return values_.empty(); }
+        const std::map<uint32_t, uint32_t> &GetValues() const { return values_; }
+
+        // Pointer stays valid until the next Set or GetInfo call on this object
+        const VkSpecializationInfo *GetInfo() const
+        {
+            if (values_.empty())
+            {
+                return nullptr;
+            }
+
+            entries_.clear();
+            data_.clear();
+            for (const auto &value : values_)
+            {
+                VkSpecializationMapEntry entry = {};
+                entry.constantID = value.first;
+                entry.offset = static_cast<uint32_t>(data_.size() * sizeof(uint32_t));
+                entry.size = sizeof(uint32_t);
+                entries_.push_back(entry);
+                data_.push_back(value.second);
+            }
+
+            info_ = {};
+            info_.mapEntryCount = static_cast<uint32_t>(entries_.size());
+            info_.pMapEntries = entries_.data();
+            info_.dataSize = data_.size() * sizeof(uint32_t);
+            info_.pData = data_.data();
+
+            return &info_;
+        }
+
+    private:
+        std::map<uint32_t, uint32_t> values_;
+
+        mutable std::vector<VkSpecializationMapEntry> entries_;
+        mutable std::vector<uint32_t> data_;
+        mutable VkSpecializationInfo info_ = {};
+    };
+
+} // namespace estun
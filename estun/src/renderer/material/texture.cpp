@@ -48,6 +48,14 @@ estun::Texture::Texture(const std::string &filename, const estun::SamplerConfig
     stagingBuffer.reset();
 }
 
+estun::Texture::Texture(std::unique_ptr<BaseImage> image, std::unique_ptr<DeviceMemory> imageMemory, std::shared_ptr<Sampler> sampler)
+    : image_(std::move(image)),
+      imageMemory_(std::move(imageMemory)),
+      sampler_(sampler)
+{
+    imageView_.reset(new ImageView(image_.get(), VK_IMAGE_ASPECT_COLOR_BIT));
+}
+
 estun::Texture::~Texture()
 {
     sampler_.reset();
@@ -64,6 +72,17 @@ estun::Texture::Texture(Texture &&other) noexcept
 {
 }
 
+void estun::Texture::Replace(std::unique_ptr<BaseImage> image, std::unique_ptr<DeviceMemory> imageMemory)
+{
+    imageView_.reset();
+    image_.reset();
+    imageMemory_.reset();
+
+    image_ = std::move(image);
+    imageMemory_ = std::move(imageMemory);
+    imageView_.reset(new ImageView(image_.get(), VK_IMAGE_ASPECT_COLOR_BIT));
+}
+
 estun::DescriptableInfo estun::Texture::GetInfo()
 {
     VkDescriptorImageInfo imageInfo;
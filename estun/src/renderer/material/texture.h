@@ -24,10 +24,16 @@ public:
     Texture &operator=(Texture &&) = delete;
 
     Texture(const std::string &filename, const SamplerConfig &samplerConfig = SamplerConfig());
+    // Wraps an image that already holds its pixels in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+    Texture(std::unique_ptr<BaseImage> image, std::unique_ptr<DeviceMemory> imageMemory, std::shared_ptr<Sampler> sampler);
     ~Texture();
 
     DescriptableInfo GetInfo() override;
 
+    // Swaps in another image for the same sampler, the old one must no longer be in use by the device
+    void Replace(std::unique_ptr<BaseImage> image, std::unique_ptr<DeviceMemory> imageMemory);
+
+    BaseImage &GetImage() { return *image_; }
     const ImageView &GetImageView() const { return *imageView_; }
     const Sampler &GetSampler() const { return *sampler_; }
 
@@ -37,7 +43,7 @@ private:
     std::unique_ptr<BaseImage> image_;
     std::unique_ptr<DeviceMemory> imageMemory_;
     std::unique_ptr<ImageView> imageView_;
-    std::unique_ptr<Sampler> sampler_;
+    std::shared_ptr<Sampler> sampler_;
 };
 
 } // namespace estun
\ No newline at end of file
@@ -0,0 +1,149 @@
+#include "renderer/material/texture_cache.h"
+#include "core/core.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+namespace
+{
+    const uint32_t magic = 0x58545345; // "ESTX"
+    // Bump whenever the encoder or the layout changes, old entries are then compressed again
+    const uint32_t version = 1;
+
+    struct Header
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t compression;
+        uint32_t width;
+        uint32_t height;
+        uint32_t mipLevels;
+        uint64_t dataSize;
+    };
+} // namespace
+
+estun::TextureCache::TextureCache(const std::string &directory)
+    : directory_(directory)
+{
+    std::error_code error;
+    std::filesystem::create_directories(directory_, error);
+    if (error)
+    {
+        ES_CORE_WARN(std::string("Failed to create texture cache directory '") + directory_ + std::string("'"));
+    }
+}
+
+estun::TextureCache::~TextureCache()
+{
+}
+
+std::string estun::TextureCache::GetPath(uint64_t hash, TextureCompression compression) const
+{
+    std::stringstream path;
+    path << directory_ << "/" << std::hex << hash << "_bc" << static_cast<uint32_t>(compression) << ".tex";
+    return path.str();
+}
+
+bool estun::TextureCache::Load(uint64_t hash, TextureCompression compression, CompressedImage &image, uint32_t maxSize) const
+{
+    std::ifstream file(GetPath(hash, compression), std::ios::binary);
+    if (!file.is_open())
+    {
+        return false;
+    }
+
+    Header header;
+    if (!file.read(reinterpret_cast<char *>(&header), sizeof(header)) ||
+        header.magic != magic || header.version != version || header.compression != static_cast<uint32_t>(compression) ||
+        header.width == 0 || header.height == 0 || header.mipLevels != TextureCompressor::GetMipLevels(header.width, header.height))
+    {
+        return false;
+    }
+
+    // The layout follows from the size, anything else is a damaged entry
+    std::vector<uint64_t> expectedOffsets;
+    uint64_t expectedSize = 0;
+    for (uint32_t level = 0; level < header.mipLevels; level++)
+    {
+        expectedOffsets.push_back(expectedSize);
+        expectedSize += TextureCompressor::GetLevelSize(compression, std::max(header.width >> level, 1u), std::max(header.height >> level, 1u));
+    }
+    if (header.dataSize != expectedSize)
+    {
+        return false;
+    }
+
+    std::vector<uint64_t> mipOffsets(header.mipLevels);
+    if (!file.read(reinterpret_cast<char *>(mipOffsets.data()), header.mipLevels * sizeof(uint64_t)) || mipOffsets != expectedOffsets)
+    {
+        return false;
+    }
+
+    // Levels are stored from the largest down, the tail is one contiguous read at the end of the file
+    const uint32_t firstLevel = maxSize != 0 ? TextureCompressor::GetFirstLevel(header.width, header.height, maxSize) : 0;
+    const uint64_t skipped = expectedOffsets[firstLevel];
+
+    image.compression = compression;
+    image.width = header.width;
+    image.height = header.height;
+    image.firstLevel = firstLevel;
+    image.mipOffsets.clear();
+    for (uint32_t level = firstLevel; level < header.mipLevels; level++)
+    {
+        image.mipOffsets.push_back(expectedOffsets[level] - skipped);
+    }
+    image.data.resize(static_cast<size_t>(header.dataSize - skipped));
+
+    if (!file.seekg(static_cast<std::streamoff>(skipped), std::ios::cur) ||
+        !file.read(reinterpret_cast<char *>(image.data.data()), image.data.size()))
+    {
+        ES_CORE_WARN(std::string("Cached texture '") + GetPath(hash, compression) + std::string("' is truncated, compressing again"));
+        return false;
+    }
+
+    return true;
+}
+
+void estun::TextureCache::Store(uint64_t hash, const CompressedImage &image) const
+{
+    if (image.firstLevel != 0)
+    {
+        ES_CORE_WARN("Only whole mip chains can be stored in the texture cache");
+        return;
+    }
+
+    Header header = {};
+    header.magic = magic;
+    header.version = version;
+    header.compression = static_cast<uint32_t>(image.compression);
+    header.width = image.width;
+    header.height = image.height;
+    header.mipLevels = static_cast<uint32_t>(image.mipOffsets.size());
+    header.dataSize = image.data.size();
+
+    // Write to a temporary name first so an interrupted run never leaves a truncated entry
+    const std::string path = GetPath(hash, image.compression);
+    bool written = false;
+    {
+        std::ofstream file(path + ".tmp", std::ios::binary | std::ios::trunc);
+        if (file.is_open())
+        {
+            file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+            file.write(reinterpret_cast<const char *>(image.mipOffsets.data()), image.mipOffsets.size() * sizeof(uint64_t));
+            file.write(reinterpret_cast<const char *>(image.data.data()), image.data.size());
+            written = file.good();
+        }
+    }
+
+    std::error_code error;
+    if (written)
+    {
+        std::filesystem::rename(path + ".tmp", path, error);
+    }
+    if (!written || error)
+    {
+        ES_CORE_WARN(std::string("Failed to write texture cache '") + path + std::string("'"));
+    }
+}
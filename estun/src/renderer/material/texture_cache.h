@@ -0,0 +1,33 @@
+#pragma once
+
+#include "renderer/common.h"
+#include "renderer/material/texture_compressor.h"
+
+namespace estun
+{
+
+    // Block compressed images with their whole mip chain, keyed by the hash of the source file and the
+    // format. Entries are plain blocks and do not depend on the device, so they can be produced offline.
+    class TextureCache
+    {
+    public:
+        TextureCache(const TextureCache &) = delete;
+        TextureCache(TextureCache &&) = delete;
+        TextureCache &operator=(const TextureCache &) = delete;
+        TextureCache &operator=(TextureCache &&) = delete;
+
+        TextureCache(const std::string &directory);
+        ~TextureCache();
+
+        // Safe to call from several threads at once, false means the source has to be compressed.
+        // A max size above zero only reads the tail of the chain from the first level that fits in it.
+        bool Load(uint64_t hash, TextureCompression compression, CompressedImage &image, uint32_t maxSize = 0) const;
+        void Store(uint64_t hash, const CompressedImage &image) const;
+
+    private:
+        std::string GetPath(uint64_t hash, TextureCompression compression) const;
+
+        std::string directory_;
+    };
+
+} // namespace estun
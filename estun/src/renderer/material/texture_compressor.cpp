@@ -0,0 +1,531 @@
+#include "renderer/material/texture_compressor.h"
+#include "includes/glm.h"
+#include "core/thread_pool.h"
+#include "core/core.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    // Blocks per task, enough to outweigh submitting it
+    const uint32_t blocksPerChunk = 1024;
+
+    // Interpolation weights of 4 bit BC7 indices, out of 64
+    const uint32_t bc7Weights[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+    // Edge texels are repeated for blocks hanging over the border of small levels
+    void FetchBlock(const uint8_t *pixels, uint32_t width, uint32_t height, uint32_t blockX, uint32_t blockY, glm::vec4 texels[16])
+    {
+        for (uint32_t y = 0; y < 4; y++)
+        {
+            for (uint32_t x = 0; x < 4; x++)
+            {
+                const uint32_t sourceX = std::min(blockX * 4 + x, width - 1);
+                const uint32_t sourceY = std::min(blockY * 4 + y, height - 1);
+                const uint8_t *texel = pixels + 4 * (static_cast<size_t>(sourceY) * width + sourceX);
+                texels[4 * y + x] = glm::vec4(texel[0], texel[1], texel[2], texel[3]);
+            }
+        }
+    }
+
+    float Distance(const glm::vec4 &a, const glm::vec4 &b, const glm::vec4 &mask)
+    {
+        const glm::vec4 difference = (a - b) * mask;
+        return glm::dot(difference, difference);
+    }
+
+    // Extremes of the block along its principal axis, found by power iteration on the covariance
+    void PrincipalExtremes(const glm::vec4 texels[16], const glm::vec4 &mask, glm::vec4 &low, glm::vec4 &high)
+    {
+        glm::vec4 mean(0.0f);
+        glm::vec4 minimum(255.0f);
+        glm::vec4 maximum(0.0f);
+        for (uint32_t i = 0; i < 16; i++)
+        {
+            mean += texels[i] * mask;
+            minimum = glm::min(minimum, texels[i] * mask);
+            maximum = glm::max(maximum, texels[i] * mask);
+        }
+        mean /= 16.0f;
+
+        glm::mat4 covariance(0.0f);
+        for (uint32_t i = 0; i < 16; i++)
+        {
+            const glm::vec4 difference = texels[i] * mask - mean;
+            covariance += glm::outerProduct(difference, difference);
+        }
+
+        glm::vec4 axis = maximum - minimum;
+        for (uint32_t iteration = 0; iteration < 8; iteration++)
+        {
+            axis = covariance * axis;
+            const float scale = glm::max(glm::max(glm::abs(axis.x), glm::abs(axis.y)), glm::max(glm::abs(axis.z), glm::abs(axis.w)));
+            if (scale == 0.0f)
+            {
+                break;
+            }
+            axis /= scale;
+        }
+
+        if (glm::dot(axis, axis) == 0.0f)
+        {
+            low = mean;
+            high = mean;
+            return;
+        }
+        axis = glm::normalize(axis);
+
+        float lowT = 0.0f;
+        float highT = 0.0f;
+        for (uint32_t i = 0; i < 16; i++)
+        {
+            const float t = glm::dot(texels[i] * mask - mean, axis);
+            lowT = std::min(lowT, t);
+            highT = std::max(highT, t);
+        }
+
+        low = glm::clamp(mean + axis * lowT, 0.0f, 255.0f);
+        high = glm::clamp(mean + axis * highT, 0.0f, 255.0f);
+    }
+
+    // Least squares endpoints for texels that were assigned blend factors t between them
+    bool FitEndpoints(const glm::vec4 texels[16], const float t[16], glm::vec4 &low, glm::vec4 &high)
+    {
+        float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+        glm::vec4 ax(0.0f), bx(0.0f);
+        for (uint32_t i = 0; i < 16; i++)
+        {
+            const float a = 1.0f - t[i];
+            const float b = t[i];
+            aa += a * a;
+            ab += a * b;
+            bb += b * b;
+            ax += a * texels[i];
+            bx += b * texels[i];
+        }
+
+        const float determinant = aa * bb - ab * ab;
+        if (glm::abs(determinant) < 1e-6f)
+        {
+            return false;
+        }
+
+        low = glm::clamp((bb * ax - ab * bx) / determinant, 0.0f, 255.0f);
+        high = glm::clamp((aa * bx - ab * ax) / determinant, 0.0f, 255.0f);
+        return true;
+    }
+
+    uint16_t To565(const glm::vec4 &color)
+    {
+        const uint32_t r = static_cast<uint32_t>(glm::clamp(glm::round(color.r * 31.0f / 255.0f), 0.0f, 31.0f));
+        const uint32_t g = static_cast<uint32_t>(glm::clamp(glm::round(color.g * 63.0f / 255.0f), 0.0f, 63.0f));
+        const uint32_t b = static_cast<uint32_t>(glm::clamp(glm::round(color.b * 31.0f / 255.0f), 0.0f, 31.0f));
+        return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+    }
+
+    glm::vec4 From565(uint16_t color)
+    {
+        const uint32_t r = (color >> 11) & 31;
+        const uint32_t g = (color >> 5) & 63;
+        const uint32_t b = color & 31;
+        return glm::vec4((r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2), 255.0f);
+    }
+
+    // Four color mode only. The endpoints are swapped so color0 is the greater 565 value, equal ones would
+    // select the three color mode and only use the first entry.
+    uint32_t SelectBC1(const glm::vec4 texels[16], uint16_t &color0, uint16_t &color1, float t[16], float &error)
+    {
+        if (color0 < color1)
+        {
+            std::swap(color0, color1);
+        }
+
+        const glm::vec4 mask(1.0f, 1.0f, 1.0f, 0.0f);
+        const glm::vec4 endpoint0 = From565(color0);
+        const glm::vec4 endpoint1 = From565(color1);
+        const glm::vec4 palette[4] = {endpoint0, endpoint1, (2.0f * endpoint0 + endpoint1) / 3.0f, (endpoint0 + 2.0f * endpoint1) / 3.0f};
+        const float blend[4] = {0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f};
+
+        uint32_t indices = 0;
+        error = 0.0f;
+        for (uint32_t i = 0; i < 16; i++)
+        {
+            uint32_t best = 0;
+            float bestDistance = Distance(texels[i], palette[0], mask);
+            for (uint32_t entry = 1; entry < (color0 == color1 ? 1u : 4u); entry++)
+            {
+                const float distance = Distance(texels[i], palette[entry], mask);
+                if (distance < bestDistance)
+                {
+                    best = entry;
+                    bestDistance = distance;
+                }
+            }
+            indices |= best << (2 * i);
+            t[i] = blend[best];
+            error += bestDistance;
+        }
+        return indices;
+    }
+
+    void EncodeBC1(const glm::vec4 texels[16], uint8_t *block)
+    {
+        glm::vec4 low, high;
+        PrincipalExtremes(texels, glm::vec4(1.0f, 1.0f, 1.0f, 0.0f), low, high);
+
+        uint16_t color0 = To565(high);
+        uint16_t color1 = To565(low);
+        float t[16];
+        float error;
+        uint32_t indices = SelectBC1(texels, color0, color1, t, error);
+
+        // One refinement, kept only when it lowers the error
+        if (error > 0.0f && FitEndpoints(texels, t, high, low))
+        {
+            uint16_t refined0 = To565(high);
+            uint16_t refined1 = To565(low);
+            float refinedT[16];
+            float refinedError;
+            const uint32_t refinedIndices = SelectBC1(texels, refined0, refined1, refinedT, refinedError);
+            if (refinedError < error)
+            {
+                color0 = refined0;
+                color1 = refined1;
+                indices = refinedIndices;
+            }
+        }
+
+        std::memcpy(block, &color0, 2);
+        std::memcpy(block + 2, &color1, 2);
+        std::memcpy(block + 4, &indices, 4);
+    }
+
+    void EncodeBC4(const glm::vec4 texels[16], uint32_t channel, uint8_t *block)
+    {
+        float minimum = 255.0f;
+        float maximum = 0.0f;
+        for (uint32_t i = 0; i < 16; i++)
+        {
+            minimum = std::min(minimum, texels[i][channel]);
+            maximum = std::max(maximum, texels[i][channel]);
+        }
+
+        const uint8_t red0 = static_cast<uint8_t>(glm::round(maximum));
+        const uint8_t red1 = static_cast<uint8_t>(glm::round(minimum));
+
+        // Eight value mode, index 0 and 1 are the endpoints and 2 to 7 step from the first to the second
+        uint64_t indices = 0;
+        if (red0 > red1)
+        {
+            for (uint32_t i = 0; i < 16; i++)
+            {
+                const uint64_t step = static_cast<uint64_t>(glm::round((red0 - texels[i][channel]) * 7.0f / (red0 - red1)));
+                const uint64_t index = step == 0 ? 0 : step >= 7 ? 1 : step + 1;
+                indices |= index << (3 * i);
+            }
+        }
+
+        block[0] = red0;
+        block[1] = red1;
+        for (uint32_t i = 0; i < 6; i++)
+        {
+            block[2 + i] = static_cast<uint8_t>(indices >> (8 * i));
+        }
+    }
+
+    void EncodeBC5(const glm::vec4 texels[16], uint8_t *block)
+    {
+        EncodeBC4(texels, 0, block);
+        EncodeBC4(texels, 1, block + 8);
+    }
+
+    // 7 bit endpoints with a shared lowest bit each, the p-bit with the smaller error wins
+    void QuantizeBC7(const glm::vec4 &endpoint, uint32_t quantized[4], uint32_t &pBit)
+    {
+        float bestError = std::numeric_limits<float>::max();
+        for (uint32_t p = 0; p < 2; p++)
+        {
+            uint32_t candidate[4];
+            float error = 0.0f;
+            for (uint32_t channel = 0; channel < 4; channel++)
+            {
+                candidate[channel] = static_cast<uint32_t>(glm::clamp(glm::round((endpoint[channel] - p) / 2.0f), 0.0f, 127.0f));
+                const float difference = endpoint[channel] - static_cast<float>((candidate[channel] << 1) | p);
+                error += difference * difference;
+            }
+            if (error < bestError)
+            {
+                bestError = error;
+                pBit = p;
+                std::copy(candidate, candidate + 4, quantized);
+            }
+        }
+    }
+
+    struct BC7Mode6
+    {
+        uint32_t endpoints[2][4];
+        uint32_t pBits[2];
+        uint32_t indices[16];
+        float error;
+    };
+
+    void SelectBC7(const glm::vec4 texels[16], const glm::vec4 &low, const glm::vec4 &high, BC7Mode6 &mode, float t[16])
+    {
+        QuantizeBC7(low, mode.endpoints[0], mode.pBits[0]);
+        QuantizeBC7(high, mode.endpoints[1], mode.pBits[1]);
+
+        glm::vec4 palette[16];
+        for (uint32_t entry = 0; entry < 16; entry++)
+        {
+            for (uint32_t channel = 0; channel < 4; channel++)
+            {
+                const uint32_t endpoint0 = (mode.endpoints[0][channel] << 1) | mode.pBits[0];
+                const uint32_t endpoint1 = (mode.endpoints[1][channel] << 1) | mode.pBits[1];
+                palette[entry][channel] = static_cast<float>(((64 - bc7Weights[entry]) * endpoint0 + bc7Weights[entry] * endpoint1 + 32) >> 6);
+            }
+        }
+
+        mode.error = 0.0f;
+        for (uint32_t i = 0; i < 16; i++)
+        {
+            uint32_t best = 0;
+            float bestDistance = Distance(texels[i], palette[0], glm::vec4(1.0f));
+            for (uint32_t entry = 1; entry < 16; entry++)
+            {
+                const float distance = Distance(texels[i], palette[entry], glm::vec4(1.0f));
+                if (distance < bestDistance)
+                {
+                    best = entry;
+                    bestDistance = distance;
+                }
+            }
+            mode.indices[i] = best;
+            t[i] = bc7Weights[best] / 64.0f;
+            mode.error += bestDistance;
+        }
+    }
+
+    class BitWriter
+    {
+    public:
+        explicit BitWriter(uint8_t *bytes) : bytes_(bytes) {}
+
+        void Write(uint32_t value, uint32_t bitCount)
+        {
+            for (uint32_t bit = 0; bit < bitCount; bit++, position_++)
+            {
+                bytes_[position_ >> 3] |= static_cast<uint8_t>(((value >> bit) & 1) << (position_ & 7));
+            }
+        }
+
+    private:
+        uint8_t *bytes_;
+        uint32_t position_ = 0;
+    };
+
+    void EncodeBC7(const glm::vec4 texels[16], uint8_t *block)
+    {
+        glm::vec4 low, high;
+        PrincipalExtremes(texels, glm::vec4(1.0f), low, high);
+
+        BC7Mode6 mode;
+        float t[16];
+        SelectBC7(texels, low, high, mode, t);
+
+        if (mode.error > 0.0f && FitEndpoints(texels, t, low, high))
+        {
+            BC7Mode6 refined;
+            SelectBC7(texels, low, high, refined, t);
+            if (refined.error < mode.error)
+            {
+                mode = refined;
+            }
+        }
+
+        // The first index is stored without its top bit, which has to be zero
+        if (mode.indices[0] & 8)
+        {
+            std::swap(mode.endpoints[0], mode.endpoints[1]);
+            std::swap(mode.pBits[0], mode.pBits[1]);
+            for (uint32_t i = 0; i < 16; i++)
+            {
+                mode.indices[i] = 15 - mode.indices[i];
+            }
+        }
+
+        std::memset(block, 0, 16);
+        BitWriter writer(block);
+        writer.Write(1 << 6, 7);
+        for (uint32_t channel = 0; channel < 4; channel++)
+        {
+            writer.Write(mode.endpoints[0][channel], 7);
+            writer.Write(mode.endpoints[1][channel], 7);
+        }
+        writer.Write(mode.pBits[0], 1);
+        writer.Write(mode.pBits[1], 1);
+        for (uint32_t i = 0; i < 16; i++)
+        {
+            writer.Write(mode.indices[i], i == 0 ? 3 : 4);
+        }
+    }
+
+    std::vector<uint8_t> Downsample(const std::vector<uint8_t> &pixels, uint32_t width, uint32_t height)
+    {
+        const uint32_t nextWidth = std::max(width / 2, 1u);
+        const uint32_t nextHeight = std::max(height / 2, 1u);
+        std::vector<uint8_t> next(static_cast<size_t>(nextWidth) * nextHeight * 4);
+
+        for (uint32_t y = 0; y < nextHeight; y++)
+        {
+            for (uint32_t x = 0; x < nextWidth; x++)
+            {
+                const uint32_t x0 = std::min(2 * x, width - 1), x1 = std::min(2 * x + 1, width - 1);
+                const uint32_t y0 = std::min(2 * y, height - 1), y1 = std::min(2 * y + 1, height - 1);
+                for (uint32_t channel = 0; channel < 4; channel++)
+                {
+                    const uint32_t sum =
+                        pixels[4 * (static_cast<size_t>(y0) * width + x0) + channel] + pixels[4 * (static_cast<size_t>(y0) * width + x1) + channel] +
+                        pixels[4 * (static_cast<size_t>(y1) * width + x0) + channel] + pixels[4 * (static_cast<size_t>(y1) * width + x1) + channel];
+                    next[4 * (static_cast<size_t>(y) * nextWidth + x) + channel] = static_cast<uint8_t>((sum + 2) / 4);
+                }
+            }
+        }
+
+        return next;
+    }
+} // namespace
+
+estun::TextureCompressor::TextureCompressor(std::shared_ptr<ThreadPool> pool)
+    : pool_(pool)
+{
+}
+
+estun::TextureCompressor::~TextureCompressor()
+{
+    pool_.reset();
+}
+
+VkFormat estun::TextureCompressor::GetFormat(TextureCompression compression)
+{
+    switch (compression)
+    {
+    case TextureCompression::BC1:
+        return VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+    case TextureCompression::BC5:
+        return VK_FORMAT_BC5_UNORM_BLOCK;
+    case TextureCompression::BC7:
+        return VK_FORMAT_BC7_UNORM_BLOCK;
+    default:
+        return VK_FORMAT_R8G8B8A8_UNORM;
+    }
+}
+
+uint32_t estun::TextureCompressor::GetBlockSize(TextureCompression compression)
+{
+    return compression == TextureCompression::BC1 ? 8 : 16;
+}
+
+uint32_t estun::TextureCompressor::GetMipLevels(uint32_t width, uint32_t height)
+{
+    return static_cast<uint32_t>(std::floor(std::log2(std::max(width, height)))) + 1;
+}
+
+uint64_t estun::TextureCompressor::GetLevelSize(TextureCompression compression, uint32_t width, uint32_t height)
+{
+    if (compression == TextureCompression::None)
+    {
+        return static_cast<uint64_t>(width) * height * 4;
+    }
+    return static_cast<uint64_t>((width + 3) / 4) * ((height + 3) / 4) * GetBlockSize(compression);
+}
+
+uint32_t estun::TextureCompressor::GetFirstLevel(uint32_t width, uint32_t height, uint32_t maxSize)
+{
+    const uint32_t mipLevels = GetMipLevels(width, height);
+    uint32_t level = 0;
+    while (level + 1 < mipLevels && std::max(width >> level, height >> level) > maxSize)
+    {
+        level++;
+    }
+    return level;
+}
+
+estun::CompressedImage estun::TextureCompressor::Compress(const uint8_t *pixels, uint32_t width, uint32_t height, TextureCompression compression)
+{
+    CompressedImage image;
+    image.compression = compression;
+    image.width = width;
+    image.height = height;
+
+    const uint32_t mipLevels = GetMipLevels(width, height);
+    uint64_t size = 0;
+    for (uint32_t level = 0; level < mipLevels; level++)
+    {
+        image.mipOffsets.push_back(size);
+        size += GetLevelSize(compression, std::max(width >> level, 1u), std::max(height >> level, 1u));
+    }
+    image.data.resize(static_cast<size_t>(size));
+
+    const uint32_t blockSize = GetBlockSize(compression);
+    std::vector<uint8_t> level(pixels, pixels + static_cast<size_t>(width) * height * 4);
+    uint32_t levelWidth = width;
+    uint32_t levelHeight = height;
+
+    for (uint32_t mip = 0; mip < mipLevels; mip++)
+    {
+        const uint32_t blocksX = (levelWidth + 3) / 4;
+        const uint32_t blocksY = (levelHeight + 3) / 4;
+        uint8_t *blocks = image.data.data() + image.mipOffsets[mip];
+
+        if (compression == TextureCompression::None)
+        {
+            std::memcpy(blocks, level.data(), level.size());
+        }
+        else
+        {
+            auto encodeRows = [&](uint32_t begin, uint32_t end) {
+                glm::vec4 texels[16];
+                for (uint32_t blockY = begin; blockY < end; blockY++)
+                {
+                    for (uint32_t blockX = 0; blockX < blocksX; blockX++)
+                    {
+                        FetchBlock(level.data(), levelWidth, levelHeight, blockX, blockY, texels);
+                        uint8_t *block = blocks + (static_cast<size_t>(blockY) * blocksX + blockX) * blockSize;
+                        switch (compression)
+                        {
+                        case TextureCompression::BC1:
+                            EncodeBC1(texels, block);
+                            break;
+                        case TextureCompression::BC5:
+                            EncodeBC5(texels, block);
+                            break;
+                        default:
+                            EncodeBC7(texels, block);
+                            break;
+                        }
+                    }
+                }
+            };
+
+            if (pool_ != nullptr)
+            {
+                pool_->ParallelFor(blocksY, std::max(blocksPerChunk / blocksX, 1u), encodeRows);
+            }
+            else
+            {
+                encodeRows(0, blocksY);
+            }
+        }
+
+        if (mip + 1 < mipLevels)
+        {
+            level = Downsample(level, levelWidth, levelHeight);
+            levelWidth = std::max(levelWidth / 2, 1u);
+            levelHeight = std::max(levelHeight / 2, 1u);
+        }
+    }
+
+    return image;
+}
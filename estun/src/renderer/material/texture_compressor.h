@@ -0,0 +1,62 @@
+#pragma once
+
+#include "renderer/common.h"
+
+namespace estun
+{
+
+    class ThreadPool;
+
+    enum class TextureCompression : uint32_t
+    {
+        // Uncompressed RGBA8, mips are blitted on the device
+        None = 0,
+        // Opaque color, 4 bits per texel
+        BC1 = 1,
+        // Two channels, red and green of the source, for tangent space normals, 8 bits per texel
+        BC5 = 2,
+        // Color with alpha (mode 6 only), 8 bits per texel
+        BC7 = 3
+    };
+
+    // Every mip level of an image, tightly packed in blocks. A partially loaded image starts at
+    // firstLevel, the size is still the one of level 0 and mipOffsets[0] belongs to firstLevel.
+    struct CompressedImage
+    {
+        TextureCompression compression = TextureCompression::None;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        uint32_t firstLevel = 0;
+        std::vector<uint64_t> mipOffsets;
+        std::vector<uint8_t> data;
+    };
+
+    // Host block encoder used at import. Mips are box filtered on the host since compressed formats
+    // can't be blitted, then every level is encoded with its block rows spread across the pool.
+    class TextureCompressor
+    {
+    public:
+        TextureCompressor(const TextureCompressor &) = delete;
+        TextureCompressor(TextureCompressor &&) = delete;
+        TextureCompressor &operator=(const TextureCompressor &) = delete;
+        TextureCompressor &operator=(TextureCompressor &&) = delete;
+
+        explicit TextureCompressor(std::shared_ptr<ThreadPool> pool = nullptr);
+        ~TextureCompressor();
+
+        static VkFormat GetFormat(TextureCompression compression);
+        static uint32_t GetBlockSize(TextureCompression compression);
+        static uint32_t GetMipLevels(uint32_t width, uint32_t height);
+        static uint64_t GetLevelSize(TextureCompression compression, uint32_t width, uint32_t height);
+        // First level no larger than maxSize on either side, the last one when even that is larger
+        static uint32_t GetFirstLevel(uint32_t width, uint32_t height, uint32_t maxSize);
+
+        // Must not be called from a task of the same pool, the calling thread waits for the rows.
+        // None only builds the RGBA8 mip chain, for streaming textures that need every level on the host.
+        CompressedImage Compress(const uint8_t *pixels, uint32_t width, uint32_t height, TextureCompression compression);
+
+    private:
+        std::shared_ptr<ThreadPool> pool_;
+    };
+
+} // namespace estun
@@ -0,0 +1,1052 @@
+#include "renderer/material/texture_manager.h"
+#include "renderer/material/texture_cache.h"
+#include "renderer/material/resource_table.h"
+#include "renderer/context/base_image.h"
+#include "renderer/context/command_buffers.h"
+#include "renderer/context/device.h"
+#include "renderer/context/fence.h"
+#include "renderer/context/single_time_commands.h"
+#include "renderer/context/swap_chain.h"
+#include "renderer/context.h"
+#include "renderer/buffers/buffer.h"
+#include "renderer/device_memory.h"
+#include "core/thread_pool.h"
+#include "core/core.h"
+
+#include <stb_image.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <numeric>
+
+namespace
+{
+    const VkFormat textureFormat = VK_FORMAT_R8G8B8A8_UNORM;
+
+    // FNV-1a
+    uint64_t Hash(const void *data, size_t size, uint64_t hash = 0xcbf29ce484222325ull)
+    {
+        const uint8_t *bytes = static_cast<const uint8_t *>(data);
+        for (size_t i = 0; i < size; i++)
+        {
+            hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+        }
+        return hash;
+    }
+
+    template <class T>
+    uint64_t Hash(const T &value, uint64_t hash)
+    {
+        return Hash(&value, sizeof(value), hash);
+    }
+
+    // Field by field, the padding between the flags is not guaranteed to be zero
+    uint64_t HashSampler(const estun::SamplerConfig &config)
+    {
+        uint64_t hash = Hash(config.MagFilter, 0xcbf29ce484222325ull);
+        hash = Hash(config.MinFilter, hash);
+        hash = Hash(config.AddressModeU, hash);
+        hash = Hash(config.AddressModeV, hash);
+        hash = Hash(config.AddressModeW, hash);
+        hash = Hash(config.AnisotropyEnable, hash);
+        hash = Hash(config.MaxAnisotropy, hash);
+        hash = Hash(config.BorderColor, hash);
+        hash = Hash(config.UnnormalizedCoordinates, hash);
+        hash = Hash(config.CompareEnable, hash);
+        hash = Hash(config.CompareOp, hash);
+        hash = Hash(config.MipmapMode, hash);
+        hash = Hash(config.MipLodBias, hash);
+        hash = Hash(config.MinLod, hash);
+        return Hash(config.MaxLod, hash);
+    }
+
+    // Copies level 0 and halves it down the chain with linear blits, every level ends up shader readable
+    void RecordUpload(VkCommandBuffer commandBuffer, estun::BaseImage &image, VkBuffer stagingBuffer, VkDeviceSize stagingOffset)
+    {
+        const VkPipelineStageFlags shaderStages = VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+
+        VkImageMemoryBarrier barrier = {};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.image = image.GetImage();
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        barrier.subresourceRange.baseMipLevel = 0;
+        barrier.subresourceRange.levelCount = image.GetMipLevels();
+        barrier.subresourceRange.baseArrayLayer = 0;
+        barrier.subresourceRange.layerCount = 1;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+        VkBufferImageCopy region = {};
+        region.bufferOffset = stagingOffset;
+        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.imageSubresource.mipLevel = 0;
+        region.imageSubresource.baseArrayLayer = 0;
+        region.imageSubresource.layerCount = 1;
+        region.imageExtent = {image.GetWidth(), image.GetHeight(), 1};
+
+        vkCmdCopyBufferToImage(commandBuffer, stagingBuffer, image.GetImage(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+        barrier.subresourceRange.levelCount = 1;
+
+        int32_t mipWidth = static_cast<int32_t>(image.GetWidth());
+        int32_t mipHeight = static_cast<int32_t>(image.GetHeight());
+
+        for (uint32_t level = 1; level < image.GetMipLevels(); level++)
+        {
+            barrier.subresourceRange.baseMipLevel = level - 1;
+            barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+            vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+            const int32_t nextWidth = std::max(mipWidth / 2, 1);
+            const int32_t nextHeight = std::max(mipHeight / 2, 1);
+
+            VkImageBlit blit = {};
+            blit.srcOffsets[1] = {mipWidth, mipHeight, 1};
+            blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            blit.srcSubresource.mipLevel = level - 1;
+            blit.srcSubresource.layerCount = 1;
+            blit.dstOffsets[1] = {nextWidth, nextHeight, 1};
+            blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            blit.dstSubresource.mipLevel = level;
+            blit.dstSubresource.layerCount = 1;
+
+            vkCmdBlitImage(commandBuffer,
+                           image.GetImage(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                           image.GetImage(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                           1, &blit, VK_FILTER_LINEAR);
+
+            barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+            barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+            barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+            vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, shaderStages, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+            mipWidth = nextWidth;
+            mipHeight = nextHeight;
+        }
+
+        barrier.subresourceRange.baseMipLevel = image.GetMipLevels() - 1;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, shaderStages, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+        image.SetLayout(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    }
+
+    // Every level is already in the staging buffer, one copy fills the whole chain
+    void RecordCompressedUpload(VkCommandBuffer commandBuffer, estun::BaseImage &image, VkBuffer stagingBuffer, VkDeviceSize stagingOffset, const estun::CompressedImage &compressed)
+    {
+        VkImageMemoryBarrier barrier = {};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.image = image.GetImage();
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        barrier.subresourceRange.baseMipLevel = 0;
+        barrier.subresourceRange.levelCount = image.GetMipLevels();
+        barrier.subresourceRange.baseArrayLayer = 0;
+        barrier.subresourceRange.layerCount = 1;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+        std::vector<VkBufferImageCopy> regions(compressed.mipOffsets.size());
+        for (uint32_t level = 0; level < regions.size(); level++)
+        {
+            regions[level] = {};
+            regions[level].bufferOffset = stagingOffset + compressed.mipOffsets[level];
+            regions[level].imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            regions[level].imageSubresource.mipLevel = level;
+            regions[level].imageSubresource.baseArrayLayer = 0;
+            regions[level].imageSubresource.layerCount = 1;
+            regions[level].imageExtent = {std::max(compressed.width >> level, 1u), std::max(compressed.height >> level, 1u), 1};
+        }
+
+        vkCmdCopyBufferToImage(commandBuffer, stagingBuffer, image.GetImage(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(regions.size()), regions.data());
+
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                             0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+        image.SetLayout(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    }
+
+    // Fills a streamed image that starts at firstLevel of its chain. Levels with a staging offset come from
+    // the buffer, the smaller ones after them are copied from the previous image, which starts at previousLevel.
+    // Frames keep sampling the previous image until it is replaced, so it returns to its shader layout.
+    void RecordRebuild(VkCommandBuffer commandBuffer, estun::BaseImage &image, uint32_t firstLevel, VkBuffer stagingBuffer,
+                       const std::vector<VkDeviceSize> &stagingOffsets, estun::BaseImage *previous, uint32_t previousLevel,
+                       VkPipelineStageFlags shaderStages)
+    {
+        const uint32_t hostLevels = static_cast<uint32_t>(stagingOffsets.size());
+        const bool copyPrevious = previous != nullptr && hostLevels < image.GetMipLevels();
+
+        VkImageMemoryBarrier barriers[2] = {};
+        barriers[0].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barriers[0].image = image.GetImage();
+        barriers[0].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barriers[0].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barriers[0].subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        barriers[0].subresourceRange.baseMipLevel = 0;
+        barriers[0].subresourceRange.levelCount = image.GetMipLevels();
+        barriers[0].subresourceRange.baseArrayLayer = 0;
+        barriers[0].subresourceRange.layerCount = 1;
+        barriers[0].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        barriers[0].newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barriers[0].srcAccessMask = 0;
+        barriers[0].dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+        // Earlier frames on the queue may still sample the previous image, its transition waits for them
+        if (copyPrevious)
+        {
+            barriers[1] = barriers[0];
+            barriers[1].image = previous->GetImage();
+            barriers[1].subresourceRange.levelCount = previous->GetMipLevels();
+            barriers[1].oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            barriers[1].newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+            barriers[1].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        }
+
+        vkCmdPipelineBarrier(commandBuffer, copyPrevious ? shaderStages : static_cast<VkPipelineStageFlags>(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT), VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             0, 0, nullptr, 0, nullptr, copyPrevious ? 2 : 1, barriers);
+
+        std::vector<VkBufferImageCopy> regions(hostLevels);
+        for (uint32_t level = 0; level < hostLevels; level++)
+        {
+            regions[level] = {};
+            regions[level].bufferOffset = stagingOffsets[level];
+            regions[level].imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            regions[level].imageSubresource.mipLevel = level;
+            regions[level].imageSubresource.baseArrayLayer = 0;
+            regions[level].imageSubresource.layerCount = 1;
+            regions[level].imageExtent = {std::max(image.GetWidth() >> level, 1u), std::max(image.GetHeight() >> level, 1u), 1};
+        }
+        if (!regions.empty())
+        {
+            vkCmdCopyBufferToImage(commandBuffer, stagingBuffer, image.GetImage(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(regions.size()), regions.data());
+        }
+
+        if (copyPrevious)
+        {
+            std::vector<VkImageCopy> copies;
+            for (uint32_t level = hostLevels; level < image.GetMipLevels(); level++)
+            {
+                VkImageCopy copy = {};
+                copy.srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, firstLevel + level - previousLevel, 0, 1};
+                copy.dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1};
+                copy.extent = {std::max(image.GetWidth() >> level, 1u), std::max(image.GetHeight() >> level, 1u), 1};
+                copies.push_back(copy);
+            }
+
+            vkCmdCopyImage(commandBuffer,
+                           previous->GetImage(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                           image.GetImage(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                           static_cast<uint32_t>(copies.size()), copies.data());
+
+            barriers[1].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+            barriers[1].newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            barriers[1].srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+            barriers[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        }
+
+        barriers[0].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barriers[0].newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        barriers[0].srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barriers[0].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, shaderStages,
+                             0, 0, nullptr, 0, nullptr, copyPrevious ? 2 : 1, barriers);
+
+        image.SetLayout(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    }
+
+    // Stands in for streamed textures until their first levels are decoded
+    estun::CompressedImage CreateWhiteTexel()
+    {
+        estun::CompressedImage image;
+        image.width = 1;
+        image.height = 1;
+        image.mipOffsets = {0};
+        image.data = {255, 255, 255, 255};
+        return image;
+    }
+} // namespace
+
+estun::TextureManager::TextureManager(std::shared_ptr<ThreadPool> pool, std::shared_ptr<TextureCache> cache, const TextureStreamingConfig &streaming, std::shared_ptr<ResourceTable> table)
+    : pool_(pool),
+      cache_(cache),
+      compressor_(pool),
+      table_(table),
+      streaming_(streaming)
+{
+    compressionSupported_ = DeviceLocator::GetDevice().SupportsTextureCompressionBC();
+
+    const size_t imageCount = ContextLocator::GetSwapChain()->GetImages().size();
+    feedback_.reserve(imageCount);
+    for (size_t i = 0; i < imageCount; i++)
+    {
+        feedback_.emplace_back(std::max(streaming_.maxTextures, 1u));
+    }
+}
+
+estun::TextureManager::~TextureManager()
+{
+    if (rebuilding_ != nullptr)
+    {
+        rebuilding_->fence->Wait(std::numeric_limits<uint64_t>::max());
+        rebuilding_.reset();
+    }
+    for (auto &job : pending_)
+    {
+        if (job->decoded.valid())
+        {
+            job->decoded.wait();
+        }
+        stbi_image_free(job->pixels);
+    }
+    for (auto &streamed : streamed_)
+    {
+        if (streamed.loading.valid())
+        {
+            streamed.loading.wait();
+        }
+    }
+    if (table_ != nullptr)
+    {
+        for (const uint32_t handle : handles_)
+        {
+            table_->RemoveTexture(handle);
+        }
+    }
+    pending_.clear();
+    streamed_.clear();
+    feedback_.clear();
+    textures_.clear();
+    table_.reset();
+    samplers_.clear();
+    cache_.reset();
+    pool_.reset();
+}
+
+std::string estun::TextureManager::Resolve(const std::string &reference, const std::string &materialDirectory)
+{
+    if (reference.empty())
+    {
+        return std::string();
+    }
+
+    std::string normalized = reference;
+    std::replace(normalized.begin(), normalized.end(), '\\', '/');
+
+    const std::filesystem::path directory(materialDirectory);
+    const std::filesystem::path name = std::filesystem::path(normalized).filename();
+    const std::vector<std::filesystem::path> candidates = {
+        directory / normalized,
+        directory / name,
+        directory / "textures" / name,
+        directory.parent_path() / "textures" / name};
+
+    std::error_code error;
+    for (const auto &candidate : candidates)
+    {
+        if (std::filesystem::is_regular_file(candidate, error))
+        {
+            return candidate.lexically_normal().string();
+        }
+    }
+
+    ES_CORE_WARN(std::string("Texture '") + reference + std::string("' not found"));
+    return std::string();
+}
+
+void estun::TextureManager::WriteSlot(uint32_t index)
+{
+    if (table_ != nullptr)
+    {
+        table_->SetTexture(handles_[index], textures_[index]);
+    }
+}
+
+std::shared_ptr<estun::Sampler> estun::TextureManager::GetSampler(const SamplerConfig &samplerConfig)
+{
+    const uint64_t hash = HashSampler(samplerConfig);
+    auto sampler = samplers_.find(hash);
+    if (sampler != samplers_.end())
+    {
+        return sampler->second;
+    }
+
+    return samplers_[hash] = std::make_shared<Sampler>(samplerConfig);
+}
+
+int32_t estun::TextureManager::Load(const std::string &filename, const SamplerConfig &samplerConfig, TextureCompression compression)
+{
+    if (compression != TextureCompression::None && !compressionSupported_)
+    {
+        compression = TextureCompression::None;
+    }
+
+    // The default config clamps to level 0, which would throw the whole chain away
+    SamplerConfig config = samplerConfig;
+    if (config.MaxLod == 0.0f)
+    {
+        config.MaxLod = VK_LOD_CLAMP_NONE;
+    }
+    const uint64_t samplerHash = HashSampler(config);
+
+    std::error_code error;
+    const std::filesystem::path canonical = std::filesystem::weakly_canonical(filename, error);
+    const std::string pathKey = (error ? filename : canonical.string()) + "|" + std::to_string(samplerHash) + "|" + std::to_string(static_cast<uint32_t>(compression));
+
+    auto path = paths_.find(pathKey);
+    if (path != paths_.end())
+    {
+        return path->second;
+    }
+
+    std::ifstream file(filename, std::ios::binary | std::ios::ate);
+    if (!file.is_open())
+    {
+        ES_CORE_WARN(std::string("Failed to open texture '") + filename + std::string("'"));
+        return -1;
+    }
+
+    std::unique_ptr<Pending> job = std::make_unique<Pending>();
+    job->filename = filename;
+    job->file.resize(static_cast<size_t>(file.tellg()));
+    file.seekg(0);
+    file.read(reinterpret_cast<char *>(job->file.data()), job->file.size());
+
+    // Copies of one image under different names share a texture as long as they are sampled and stored the same way
+    job->sourceHash = Hash(job->file.data(), job->file.size());
+    const uint64_t contentKey = Hash(compression, Hash(samplerHash, job->sourceHash));
+    auto content = contents_.find(contentKey);
+    if (content != contents_.end())
+    {
+        return paths_[pathKey] = content->second;
+    }
+
+    const uint32_t handle = table_ != nullptr ? table_->AddTexture() : GetTextureCount();
+    if (handle == ResourceTable::InvalidHandle)
+    {
+        return -1;
+    }
+    const int32_t id = static_cast<int32_t>(handle);
+    handles_.push_back(handle);
+    paths_[pathKey] = id;
+    contents_[contentKey] = id;
+
+    job->sampler = GetSampler(config);
+    job->compression = compression;
+
+    Pending *pending = job.get();
+    std::shared_ptr<TextureCache> cache = cache_;
+    const bool streaming = streaming_.enabled;
+    const uint32_t residentSize = streaming_.residentSize;
+    auto decode = [pending, cache, streaming, residentSize]() {
+        // Streamed textures only read the resident tail here, misses are decoded after Flush
+        if (streaming)
+        {
+            if (cache != nullptr)
+            {
+                cache->Load(pending->sourceHash, pending->compression, pending->compressed, std::max(residentSize, 1u));
+            }
+            return;
+        }
+
+        if (pending->compression != TextureCompression::None && cache != nullptr && cache->Load(pending->sourceHash, pending->compression, pending->compressed))
+        {
+            pending->file = std::vector<uint8_t>();
+            return;
+        }
+
+        int channels;
+        pending->pixels = stbi_load_from_memory(pending->file.data(), static_cast<int>(pending->file.size()), &pending->width, &pending->height, &channels, STBI_rgb_alpha);
+        pending->file = std::vector<uint8_t>();
+    };
+
+    if (pool_ != nullptr)
+    {
+        job->decoded = pool_->Submit(decode);
+    }
+    else
+    {
+        decode();
+    }
+
+    pending_.push_back(std::move(job));
+
+    return id;
+}
+
+void estun::TextureManager::Flush()
+{
+    if (pending_.empty())
+    {
+        return;
+    }
+
+    if (streaming_.enabled)
+    {
+        FlushStreaming();
+        return;
+    }
+
+    for (auto &job : pending_)
+    {
+        if (job->decoded.valid())
+        {
+            job->decoded.wait();
+        }
+    }
+
+    VkFormatProperties formatProperties;
+    vkGetPhysicalDeviceFormatProperties(DeviceLocator::GetPhysicalDevice(), textureFormat, &formatProperties);
+    const VkFormatFeatureFlags blitFeatures = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+    const bool generateMips = (formatProperties.optimalTilingFeatures & blitFeatures) == blitFeatures;
+    if (!generateMips)
+    {
+        ES_CORE_WARN("Texture format does not support linear blitting, textures are uploaded without mips");
+    }
+
+    // A file that failed to decode still owns its index, it becomes a single white texel
+    const uint8_t white[4] = {255, 255, 255, 255};
+
+    // Misses of the cache are compressed here, each one spread across the pool now that the decodes are done
+    uint32_t compressedCount = 0;
+    for (auto &job : pending_)
+    {
+        if (job->compression == TextureCompression::None || !job->compressed.data.empty())
+        {
+            continue;
+        }
+
+        if (job->pixels == nullptr)
+        {
+            job->compression = TextureCompression::None;
+            continue;
+        }
+
+        job->compressed = compressor_.Compress(job->pixels, static_cast<uint32_t>(job->width), static_cast<uint32_t>(job->height), job->compression);
+        stbi_image_free(job->pixels);
+        job->pixels = nullptr;
+        compressedCount++;
+
+        if (cache_ != nullptr)
+        {
+            cache_->Store(job->sourceHash, job->compressed);
+        }
+    }
+
+    std::vector<VkDeviceSize> offsets;
+    VkDeviceSize stagingSize = 0;
+    for (auto &job : pending_)
+    {
+        if (job->compression == TextureCompression::None && job->pixels == nullptr)
+        {
+            ES_CORE_WARN(std::string("Failed to decode texture '") + job->filename + std::string("'"));
+            job->width = 1;
+            job->height = 1;
+        }
+
+        // Copies out of the staging buffer have to start on a whole block
+        stagingSize = (stagingSize + 15) & ~VkDeviceSize(15);
+        offsets.push_back(stagingSize);
+        stagingSize += job->compression != TextureCompression::None ? job->compressed.data.size() : static_cast<VkDeviceSize>(job->width) * job->height * 4;
+    }
+
+    auto stagingBuffer = std::make_unique<Buffer>(stagingSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
+    auto stagingBufferMemory = stagingBuffer->AllocateMemory(VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+    uint8_t *data = static_cast<uint8_t *>(stagingBufferMemory.Map(0, stagingSize));
+    for (size_t i = 0; i < pending_.size(); i++)
+    {
+        Pending &job = *pending_[i];
+        if (job.compression != TextureCompression::None)
+        {
+            std::memcpy(data + offsets[i], job.compressed.data.data(), job.compressed.data.size());
+            job.compressed.data = std::vector<uint8_t>();
+        }
+        else
+        {
+            std::memcpy(data + offsets[i], job.pixels != nullptr ? job.pixels : white, static_cast<size_t>(job.width) * job.height * 4);
+            stbi_image_free(job.pixels);
+            job.pixels = nullptr;
+        }
+    }
+    stagingBufferMemory.Unmap();
+
+    std::vector<std::unique_ptr<BaseImage>> images;
+    std::vector<std::unique_ptr<DeviceMemory>> memories;
+    for (const auto &job : pending_)
+    {
+        if (job->compression != TextureCompression::None)
+        {
+            images.emplace_back(new BaseImage(job->compressed.width, job->compressed.height, static_cast<uint32_t>(job->compressed.mipOffsets.size()), VK_SAMPLE_COUNT_1_BIT,
+                                              TextureCompressor::GetFormat(job->compression), VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT));
+        }
+        else
+        {
+            const uint32_t width = static_cast<uint32_t>(job->width);
+            const uint32_t height = static_cast<uint32_t>(job->height);
+            const uint32_t mipLevels = generateMips ? TextureCompressor::GetMipLevels(width, height) : 1;
+
+            images.emplace_back(new BaseImage(width, height, mipLevels, VK_SAMPLE_COUNT_1_BIT, textureFormat, VK_IMAGE_TILING_OPTIMAL,
+                                              VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT));
+        }
+        memories.emplace_back(new DeviceMemory(images.back()->AllocateMemory(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)));
+    }
+
+    // Blits need a graphics queue, every texture of the batch shares one submission
+    SingleTimeCommands::SubmitGraphics(CommandPoolLocator::GetGraphicsPool(), [&](VkCommandBuffer commandBuffer) {
+        for (size_t i = 0; i < images.size(); i++)
+        {
+            if (pending_[i]->compression != TextureCompression::None)
+            {
+                RecordCompressedUpload(commandBuffer, *images[i], stagingBuffer->GetBuffer(), offsets[i], pending_[i]->compressed);
+            }
+            else
+            {
+                RecordUpload(commandBuffer, *images[i], stagingBuffer->GetBuffer(), offsets[i]);
+            }
+        }
+    });
+
+    // Delete the buffer before the memory
+    stagingBuffer.reset();
+
+    textures_.reserve(textures_.size() + pending_.size());
+    for (size_t i = 0; i < pending_.size(); i++)
+    {
+        textures_.emplace_back(std::move(images[i]), std::move(memories[i]), pending_[i]->sampler);
+        WriteSlot(static_cast<uint32_t>(textures_.size() - 1));
+    }
+
+    ES_CORE_INFO(std::string("Uploaded ") + std::to_string(pending_.size()) + std::string(" textures (") +
+                 std::to_string(stagingSize >> 10) + std::string(" KiB, ") + std::to_string(compressedCount) + std::string(" compressed now, ") +
+                 std::to_string(samplers_.size()) + std::string(" samplers)"));
+
+    pending_.clear();
+}
+
+void estun::TextureManager::FlushStreaming()
+{
+    for (auto &job : pending_)
+    {
+        if (job->decoded.valid())
+        {
+            job->decoded.wait();
+        }
+    }
+
+    const CompressedImage white = CreateWhiteTexel();
+
+    std::vector<Rebuild> rebuilds;
+    uint32_t cachedCount = 0;
+    for (auto &job : pending_)
+    {
+        Streamed streamed;
+        streamed.sourceHash = job->sourceHash;
+        streamed.compression = job->compression;
+
+        if (!job->compressed.data.empty())
+        {
+            streamed.width = job->compressed.width;
+            streamed.height = job->compressed.height;
+            streamed.mipLevels = TextureCompressor::GetMipLevels(streamed.width, streamed.height);
+            streamed.tailLevel = job->compressed.firstLevel;
+            streamed.residentLevel = streamed.tailLevel;
+            streamed.placeholder = false;
+            cachedCount++;
+        }
+        else
+        {
+            streamed.file = std::move(job->file);
+        }
+
+        const uint32_t index = static_cast<uint32_t>(streamed_.size());
+        streamed_.push_back(std::move(streamed));
+
+        if (streamed_.back().placeholder)
+        {
+            rebuilds.push_back({index, &white, nullptr, 0, 0});
+            StartLoading(streamed_.back());
+        }
+        else
+        {
+            rebuilds.push_back({index, &job->compressed, nullptr, 0, streamed_.back().tailLevel});
+        }
+    }
+
+    // Nothing samples the new images yet, the load waits for them like any other upload
+    std::unique_ptr<RebuildBatch> batch = RebuildImages(rebuilds);
+    SingleTimeCommands::SubmitGraphics(CommandPoolLocator::GetGraphicsPool(), [&](VkCommandBuffer commandBuffer) {
+        RecordRebuilds(commandBuffer, *batch, VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+    });
+
+    textures_.reserve(textures_.size() + pending_.size());
+    for (size_t i = 0; i < pending_.size(); i++)
+    {
+        textures_.emplace_back(std::move(batch->images[i].first), std::move(batch->images[i].second), pending_[i]->sampler);
+        WriteSlot(static_cast<uint32_t>(textures_.size() - 1));
+    }
+
+    ES_CORE_INFO(std::string("Uploaded the resident levels of ") + std::to_string(cachedCount) + std::string(" textures, ") +
+                 std::to_string(pending_.size() - cachedCount) + std::string(" more are decoded in the background"));
+
+    pending_.clear();
+}
+
+void estun::TextureManager::StartLoading(Streamed &streamed)
+{
+    streamed.loaded = std::make_shared<CompressedImage>();
+
+    std::shared_ptr<CompressedImage> loaded = streamed.loaded;
+    std::shared_ptr<TextureCache> cache = cache_;
+    const uint64_t sourceHash = streamed.sourceHash;
+    const TextureCompression compression = streamed.compression;
+    auto load = [loaded, cache, sourceHash, compression, file = std::move(streamed.file)]() {
+        if (cache != nullptr && cache->Load(sourceHash, compression, *loaded))
+        {
+            return;
+        }
+        if (file.empty())
+        {
+            return;
+        }
+
+        int width, height, channels;
+        uint8_t *pixels = stbi_load_from_memory(file.data(), static_cast<int>(file.size()), &width, &height, &channels, STBI_rgb_alpha);
+        if (pixels == nullptr)
+        {
+            return;
+        }
+
+        // Already running on the pool, so the blocks are encoded on this thread
+        TextureCompressor compressor;
+        *loaded = compressor.Compress(pixels, static_cast<uint32_t>(width), static_cast<uint32_t>(height), compression);
+        stbi_image_free(pixels);
+
+        if (cache != nullptr)
+        {
+            cache->Store(sourceHash, *loaded);
+        }
+    };
+    streamed.file = std::vector<uint8_t>();
+
+    if (pool_ != nullptr)
+    {
+        streamed.loading = pool_->Submit(load);
+    }
+    else
+    {
+        load();
+    }
+}
+
+uint32_t estun::TextureManager::GetRequestedLevel(const Streamed &streamed) const
+{
+    if (streamed.lastRequested == 0 || frame_ - streamed.lastRequested > streaming_.evictFrames)
+    {
+        return streamed.tailLevel;
+    }
+
+    // Level 0 has log2 of the larger side texels per texture coordinate unit, every level after it one less
+    const float level = std::floor(static_cast<float>(streamed.mipLevels - 1) - streamed.detail);
+    return static_cast<uint32_t>(std::min(std::max(level, 0.0f), static_cast<float>(streamed.tailLevel)));
+}
+
+VkDeviceSize estun::TextureManager::GetStreamedSize(const Streamed &streamed, uint32_t firstLevel) const
+{
+    VkDeviceSize size = 0;
+    for (uint32_t level = firstLevel; level < streamed.tailLevel; level++)
+    {
+        size += TextureCompressor::GetLevelSize(streamed.compression, std::max(streamed.width >> level, 1u), std::max(streamed.height >> level, 1u));
+    }
+    return size;
+}
+
+VkDeviceSize estun::TextureManager::GetStreamedSize() const
+{
+    VkDeviceSize size = 0;
+    for (const auto &streamed : streamed_)
+    {
+        size += streamed.placeholder ? 0 : GetStreamedSize(streamed, streamed.residentLevel);
+    }
+    return size;
+}
+
+bool estun::TextureManager::Update(uint32_t imageIndex)
+{
+    if (!streaming_.enabled || streamed_.empty())
+    {
+        return false;
+    }
+
+    frame_++;
+
+    // A frame still in flight on this image may add to the buffer while it is read, its
+    // requests then only count an update later. Requests fade by a level over the eviction
+    // window so a texture doesn't lose its top level to a single frame that barely sees it.
+    FeedbackBuffer &feedback = feedback_[imageIndex % feedback_.size()];
+    const float fade = 1.0f / static_cast<float>(std::max(streaming_.evictFrames, 1u));
+    for (size_t i = 0; i < streamed_.size(); i++)
+    {
+        Streamed &streamed = streamed_[i];
+        streamed.detail = std::max(streamed.detail - fade, 0.0f);
+
+        const uint32_t request = handles_[i] < feedback.GetCount() ? feedback.GetData()[handles_[i]] : 0;
+        if (request != 0)
+        {
+            streamed.detail = std::max(streamed.detail, static_cast<float>(request - 1) / 256.0f);
+            streamed.lastRequested = frame_;
+        }
+    }
+    feedback.Reset();
+
+    for (auto &streamed : streamed_)
+    {
+        if (streamed.loaded == nullptr ||
+            (streamed.loading.valid() && streamed.loading.wait_for(std::chrono::seconds(0)) != std::future_status::ready))
+        {
+            continue;
+        }
+
+        if (streamed.loading.valid())
+        {
+            streamed.loading.get();
+        }
+        std::shared_ptr<CompressedImage> loaded = std::move(streamed.loaded);
+
+        if (loaded->data.empty())
+        {
+            ES_CORE_WARN(std::string("Failed to load streamed texture ") + std::to_string(&streamed - streamed_.data()));
+            streamed.failed = true;
+            continue;
+        }
+
+        if (streamed.placeholder)
+        {
+            streamed.width = loaded->width;
+            streamed.height = loaded->height;
+            streamed.mipLevels = TextureCompressor::GetMipLevels(streamed.width, streamed.height);
+            streamed.tailLevel = TextureCompressor::GetFirstLevel(streamed.width, streamed.height, std::max(streaming_.residentSize, 1u));
+            streamed.residentLevel = streamed.tailLevel;
+        }
+        streamed.source = loaded;
+    }
+
+    // Targets are chosen from the resident levels, which a batch still on the device is about to change
+    bool replaced = false;
+    if (rebuilding_ != nullptr)
+    {
+        if (!rebuilding_->fence->IsSignaled())
+        {
+            return false;
+        }
+        ReplaceImages(*rebuilding_);
+        rebuilding_.reset();
+        replaced = true;
+    }
+
+    // The most recently requested textures get the budget first, older ones fall back towards their tail
+    std::vector<uint32_t> order(streamed_.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) {
+        return streamed_[a].lastRequested > streamed_[b].lastRequested;
+    });
+
+    std::vector<uint32_t> targets(streamed_.size(), 0);
+    VkDeviceSize used = 0;
+    for (const uint32_t i : order)
+    {
+        const Streamed &streamed = streamed_[i];
+        if (streamed.mipLevels == 0)
+        {
+            continue;
+        }
+
+        uint32_t target = GetRequestedLevel(streamed);
+        while (target < streamed.tailLevel && used + GetStreamedSize(streamed, target) > streaming_.budget)
+        {
+            target++;
+        }
+        used += GetStreamedSize(streamed, target);
+        targets[i] = target;
+    }
+
+    // Evictions go first and least recently used first, so the upgrades of the same update fit in the budget
+    std::vector<Rebuild> rebuilds;
+    for (auto i = order.rbegin(); i != order.rend() && rebuilds.size() < streaming_.maxUploadsPerUpdate; i++)
+    {
+        const Streamed &streamed = streamed_[*i];
+        if (!streamed.placeholder && targets[*i] > streamed.residentLevel)
+        {
+            rebuilds.push_back({*i, nullptr, &textures_[*i].GetImage(), streamed.residentLevel, targets[*i]});
+        }
+    }
+
+    for (const uint32_t i : order)
+    {
+        if (rebuilds.size() >= streaming_.maxUploadsPerUpdate)
+        {
+            break;
+        }
+
+        Streamed &streamed = streamed_[i];
+        if (streamed.mipLevels == 0 || (!streamed.placeholder && targets[i] >= streamed.residentLevel))
+        {
+            continue;
+        }
+
+        if (streamed.source == nullptr)
+        {
+            if (streamed.loaded == nullptr && !streamed.failed)
+            {
+                StartLoading(streamed);
+            }
+            continue;
+        }
+
+        rebuilds.push_back({i, streamed.source.get(), streamed.placeholder ? nullptr : &textures_[i].GetImage(), streamed.residentLevel, targets[i]});
+    }
+
+    if (!rebuilds.empty())
+    {
+        // The compute queue runs the ray tracing, so the copies from the previous images are ordered
+        // after the frames that sample them and before the next ones
+        rebuilding_ = RebuildImages(rebuilds);
+        rebuilding_->commandBuffers.reset(new CommandBuffers(CommandPoolLocator::GetComputePool(), 1));
+        rebuilding_->fence.reset(new Fence(false));
+
+        VkCommandBuffer commandBuffer = (*rebuilding_->commandBuffers)[0];
+        VkCommandBufferBeginInfo beginInfo = {};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        VK_CHECK_RESULT(vkBeginCommandBuffer(commandBuffer, &beginInfo), "Failed to begin recording texture rebuilds");
+        RecordRebuilds(commandBuffer, *rebuilding_, VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+        VK_CHECK_RESULT(vkEndCommandBuffer(commandBuffer), "Failed to record texture rebuilds");
+
+        VkSubmitInfo submitInfo = {};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &commandBuffer;
+        VK_CHECK_RESULT(vkQueueSubmit(DeviceLocator::GetDevice().GetComputeQueue(), 1, &submitInfo, rebuilding_->fence->GetFence()), "Failed to submit texture rebuilds");
+    }
+
+    // Host copies of textures back at their tail can be read from the cache again when they are needed
+    if (cache_ != nullptr)
+    {
+        for (size_t i = 0; i < streamed_.size(); i++)
+        {
+            if (streamed_[i].source != nullptr && !streamed_[i].placeholder && streamed_[i].residentLevel == streamed_[i].tailLevel && targets[i] == streamed_[i].tailLevel)
+            {
+                streamed_[i].source.reset();
+            }
+        }
+    }
+
+    return replaced;
+}
+
+void estun::TextureManager::ReplaceImages(RebuildBatch &batch)
+{
+    // The previous images go through the deletion queue, the table hands the new ones to each image's
+    // set once the frames that read the old ones through it are done
+    for (size_t i = 0; i < batch.rebuilds.size(); i++)
+    {
+        const Rebuild &rebuild = batch.rebuilds[i];
+        textures_[rebuild.texture].Replace(std::move(batch.images[i].first), std::move(batch.images[i].second));
+        WriteSlot(rebuild.texture);
+        streamed_[rebuild.texture].residentLevel = rebuild.firstLevel;
+        streamed_[rebuild.texture].placeholder = false;
+    }
+}
+
+std::unique_ptr<estun::TextureManager::RebuildBatch> estun::TextureManager::RebuildImages(const std::vector<Rebuild> &rebuilds)
+{
+    std::unique_ptr<RebuildBatch> batch(new RebuildBatch());
+    batch->rebuilds = rebuilds;
+    batch->offsets.resize(rebuilds.size());
+    std::vector<std::vector<VkDeviceSize>> &offsets = batch->offsets;
+    VkDeviceSize stagingSize = 0;
+
+    for (size_t i = 0; i < rebuilds.size(); i++)
+    {
+        const Rebuild &rebuild = rebuilds[i];
+        const Streamed &streamed = streamed_[rebuild.texture];
+        const TextureCompression compression = rebuild.source != nullptr ? rebuild.source->compression : streamed.compression;
+        const uint32_t width = rebuild.source != nullptr ? rebuild.source->width : streamed.width;
+        const uint32_t height = rebuild.source != nullptr ? rebuild.source->height : streamed.height;
+        const uint32_t mipLevels = TextureCompressor::GetMipLevels(width, height);
+
+        // Levels the previous image doesn't have come from the host
+        const uint32_t hostEnd = rebuild.previous != nullptr ? std::max(rebuild.previousLevel, rebuild.firstLevel) : mipLevels;
+        for (uint32_t level = rebuild.firstLevel; level < hostEnd; level++)
+        {
+            stagingSize = (stagingSize + 15) & ~VkDeviceSize(15);
+            offsets[i].push_back(stagingSize);
+            stagingSize += TextureCompressor::GetLevelSize(compression, std::max(width >> level, 1u), std::max(height >> level, 1u));
+        }
+
+        std::unique_ptr<BaseImage> image(new BaseImage(std::max(width >> rebuild.firstLevel, 1u), std::max(height >> rebuild.firstLevel, 1u), mipLevels - rebuild.firstLevel,
+                                                       VK_SAMPLE_COUNT_1_BIT, TextureCompressor::GetFormat(compression), VK_IMAGE_TILING_OPTIMAL,
+                                                       VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT));
+        std::unique_ptr<DeviceMemory> memory(new DeviceMemory(image->AllocateMemory(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)));
+        batch->images.emplace_back(std::move(image), std::move(memory));
+    }
+
+    if (stagingSize != 0)
+    {
+        batch->stagingBuffer.reset(new Buffer(stagingSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT));
+        batch->stagingBufferMemory.reset(new DeviceMemory(batch->stagingBuffer->AllocateMemory(VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)));
+
+        uint8_t *data = static_cast<uint8_t *>(batch->stagingBufferMemory->Map(0, stagingSize));
+        for (size_t i = 0; i < rebuilds.size(); i++)
+        {
+            const CompressedImage *source = rebuilds[i].source;
+            for (uint32_t level = 0; level < offsets[i].size(); level++)
+            {
+                const uint32_t sourceLevel = rebuilds[i].firstLevel + level;
+                const uint64_t size = TextureCompressor::GetLevelSize(source->compression, std::max(source->width >> sourceLevel, 1u), std::max(source->height >> sourceLevel, 1u));
+                std::memcpy(data + offsets[i][level], source->data.data() + source->mipOffsets[sourceLevel - source->firstLevel], static_cast<size_t>(size));
+            }
+        }
+        batch->stagingBufferMemory->Unmap();
+    }
+
+    return batch;
+}
+
+void estun::TextureManager::RecordRebuilds(VkCommandBuffer commandBuffer, const RebuildBatch &batch, VkPipelineStageFlags shaderStages)
+{
+    const VkBuffer stagingBuffer = batch.stagingBuffer != nullptr ? batch.stagingBuffer->GetBuffer() : VK_NULL_HANDLE;
+    for (size_t i = 0; i < batch.rebuilds.size(); i++)
+    {
+        const Rebuild &rebuild = batch.rebuilds[i];
+        RecordRebuild(commandBuffer, *batch.images[i].first, rebuild.firstLevel, stagingBuffer, batch.offsets[i], rebuild.previous, rebuild.previousLevel, shaderStages);
+    }
+}
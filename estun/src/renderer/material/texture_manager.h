@@ -0,0 +1,193 @@
+#pragma once
+
+#include "renderer/common.h"
+#include "renderer/material/sampler.h"
+#include "renderer/material/texture.h"
+#include "renderer/material/texture_compressor.h"
+#include "renderer/buffers/feedback_buffer.h"
+
+#include <future>
+
+namespace estun
+{
+
+    class ThreadPool;
+    class TextureCache;
+    class ResourceTable;
+    class BaseImage;
+    class Buffer;
+    class CommandBuffers;
+    class DeviceMemory;
+    class Fence;
+
+    // Streaming textures start with their small levels only and grow as the hit shaders ask for more
+    struct TextureStreamingConfig
+    {
+        bool enabled = false;
+        // Levels at most this many texels on either side are uploaded by Flush and never evicted
+        uint32_t residentSize = 64;
+        // Device memory for the levels above the resident ones, summed over all textures
+        VkDeviceSize budget = 256ull << 20;
+        // Levels nobody asked for during this many updates are evicted even below the budget
+        uint32_t evictFrames = 300;
+        // Textures rebuilt by a single Update, bounds the staging memory and the copies of one submission
+        uint32_t maxUploadsPerUpdate = 4;
+        // Size of the feedback buffers, textures past it stay at their resident levels
+        uint32_t maxTextures = 1024;
+    };
+
+    // Owns every texture of a scene. Files are deduplicated by path and then by content hash, decoded on
+    // the pool as soon as they are requested and uploaded together by Flush, which fills all mip levels
+    // on the device in a single submission. Indices are final when Load returns, the textures exist
+    // once the next Flush returned. Block compressed textures come straight from the cache when it has
+    // them, otherwise Flush compresses them and stores the result for the next run.
+    //
+    // With streaming enabled Flush only uploads the resident tail of every chain, read from the cache, and
+    // textures the cache doesn't have yet start as a white texel while the pool decodes them. The closest
+    // hit shaders write the detail they need into a feedback buffer and Update grows or shrinks the images
+    // to match. Vulkan has no way to add levels to an image without sparse residency, so a change
+    // reallocates the image and copies the levels it keeps on the device.
+    //
+    // With a resource table every texture gets a slot when it is requested, and its id is the slot handle.
+    // Flush and Update write the slots themselves, so new and replaced textures need no rebinding.
+    class TextureManager
+    {
+    public:
+        TextureManager(const TextureManager &) = delete;
+        TextureManager(TextureManager &&) = delete;
+        TextureManager &operator=(const TextureManager &) = delete;
+        TextureManager &operator=(TextureManager &&) = delete;
+
+        explicit TextureManager(std::shared_ptr<ThreadPool> pool = nullptr, std::shared_ptr<TextureCache> cache = nullptr,
+                                const TextureStreamingConfig &streaming = TextureStreamingConfig(), std::shared_ptr<ResourceTable> table = nullptr);
+        ~TextureManager();
+
+        // Finds the file an MTL map refers to. Exporters often write absolute paths of another machine,
+        // so the file name alone is also looked up next to the material and in a sibling textures folder.
+        static std::string Resolve(const std::string &reference, const std::string &materialDirectory);
+
+        // Returns the texture id for Material::diffuseTextureId_, or -1 when the file can't be read or the table is full.
+        // Compression falls back to RGBA8 on devices without BC support.
+        int32_t Load(const std::string &filename, const SamplerConfig &samplerConfig = SamplerConfig(), TextureCompression compression = TextureCompression::None);
+
+        // Waits for the pending decodes and uploads them. Without a table rebind the textures afterwards,
+        // the array may have moved.
+        void Flush();
+
+        // Reads what the frames of this swap chain image requested, loads missing levels on the pool and
+        // rebuilds the images that change. The rebuilds run on the compute queue behind the frames already
+        // submitted and replace the textures in a later Update, once their fence signaled, so nothing waits
+        // for the device. True when textures were replaced, without a table rebind them and record again.
+        bool Update(uint32_t imageIndex);
+
+        std::vector<Texture> &GetTextures() { return textures_; }
+        uint32_t GetTextureCount() const { return static_cast<uint32_t>(textures_.size() + pending_.size()); }
+
+        // One per swap chain image, bound to the closest hit shaders even when streaming is disabled
+        std::vector<FeedbackBuffer> &GetFeedbackBuffers() { return feedback_; }
+        VkDeviceSize GetStreamedSize() const;
+
+    private:
+        struct Pending
+        {
+            std::string filename;
+            std::vector<uint8_t> file;
+            std::shared_ptr<Sampler> sampler;
+            std::future<void> decoded;
+
+            TextureCompression compression = TextureCompression::None;
+            uint64_t sourceHash = 0;
+            // Filled from the cache, or by Flush from the decoded pixels
+            CompressedImage compressed;
+
+            uint8_t *pixels = nullptr;
+            int width = 0;
+            int height = 0;
+        };
+
+        struct Streamed
+        {
+            uint64_t sourceHash = 0;
+            TextureCompression compression = TextureCompression::None;
+            // Unknown until a texture that was not in the cache is decoded
+            uint32_t width = 0;
+            uint32_t height = 0;
+            uint32_t mipLevels = 0;
+            // The device holds the chain from residentLevel on, the levels from tailLevel on are never evicted
+            uint32_t tailLevel = 0;
+            uint32_t residentLevel = 0;
+            bool placeholder = true;
+
+            // log2 of the texels per texture coordinate unit the shaders asked for, and when they did
+            float detail = 0.0f;
+            uint64_t lastRequested = 0;
+
+            // Every level on the host, dropped again once the texture is back at its tail
+            std::shared_ptr<CompressedImage> source;
+            std::shared_ptr<CompressedImage> loaded;
+            std::future<void> loading;
+            // Encoded file, only kept until the first decode when there is no cache entry
+            std::vector<uint8_t> file;
+            bool failed = false;
+        };
+
+        // A new image for a texture, levels missing from previous come from source
+        struct Rebuild
+        {
+            uint32_t texture;
+            const CompressedImage *source;
+            BaseImage *previous;
+            uint32_t previousLevel;
+            uint32_t firstLevel;
+        };
+
+        // New images with their staging data, kept until the submission that fills them is done
+        struct RebuildBatch
+        {
+            std::vector<Rebuild> rebuilds;
+            std::vector<std::pair<std::unique_ptr<BaseImage>, std::unique_ptr<DeviceMemory>>> images;
+            std::vector<std::vector<VkDeviceSize>> offsets;
+            // The buffer is declared last so it is released before its memory
+            std::unique_ptr<DeviceMemory> stagingBufferMemory;
+            std::unique_ptr<Buffer> stagingBuffer;
+            std::unique_ptr<CommandBuffers> commandBuffers;
+            std::unique_ptr<Fence> fence;
+        };
+
+        void FlushStreaming();
+        void StartLoading(Streamed &streamed);
+        uint32_t GetRequestedLevel(const Streamed &streamed) const;
+        VkDeviceSize GetStreamedSize(const Streamed &streamed, uint32_t firstLevel) const;
+        std::unique_ptr<RebuildBatch> RebuildImages(const std::vector<Rebuild> &rebuilds);
+        // Records the copies of every image, shaderStages are the stages that sample the textures on the queue
+        void RecordRebuilds(VkCommandBuffer commandBuffer, const RebuildBatch &batch, VkPipelineStageFlags shaderStages);
+        // Swaps in the images of a finished batch
+        void ReplaceImages(RebuildBatch &batch);
+
+        std::shared_ptr<Sampler> GetSampler(const SamplerConfig &samplerConfig);
+        void WriteSlot(uint32_t index);
+
+        std::shared_ptr<ThreadPool> pool_;
+        std::shared_ptr<TextureCache> cache_;
+        TextureCompressor compressor_;
+        bool compressionSupported_ = false;
+
+        std::vector<Texture> textures_;
+        std::vector<std::unique_ptr<Pending>> pending_;
+        // Id of every texture, flushed or pending, the table handle or else the index
+        std::vector<uint32_t> handles_;
+        std::shared_ptr<ResourceTable> table_;
+
+        TextureStreamingConfig streaming_;
+        std::vector<Streamed> streamed_;
+        std::vector<FeedbackBuffer> feedback_;
+        uint64_t frame_ = 0;
+        // At most one batch is on the device, the next one is chosen once it was applied
+        std::unique_ptr<RebuildBatch> rebuilding_;
+
+        std::unordered_map<std::string, int32_t> paths_;
+        std::unordered_map<uint64_t, int32_t> contents_;
+        std::unordered_map<uint64_t, std::shared_ptr<Sampler>> samplers_;
+    };
+
+} // namespace estun
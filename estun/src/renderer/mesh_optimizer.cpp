@@ -0,0 +1,602 @@
+#include "renderer/mesh_optimizer.h"
+#include "renderer/model.h"
+#include "core/core.h"
+#include "core/thread_pool.h"
+
+#include <algorithm>
+#include <deque>
+#include <unordered_map>
+
+namespace
+{
+    const size_t cacheSize = 16;
+    const size_t cacheLineSize = 64;
+    const size_t lineCacheSize = 64;
+
+    uint32_t ExpandBits(uint32_t v)
+    {
+        v = (v * 0x00010001u) & 0xFF0000FFu;
+        v = (v * 0x00000101u) & 0x0F00F00Fu;
+        v = (v * 0x00000011u) & 0xC30C30C3u;
+        v = (v * 0x00000005u) & 0x49249249u;
+        return v;
+    }
+
+    uint32_t MortonCode(const glm::vec3 &position)
+    {
+        const glm::uvec3 cell = glm::clamp(position * 1024.0f, glm::vec3(0.0f), glm::vec3(1023.0f));
+        return (ExpandBits(cell.x) << 2) | (ExpandBits(cell.y) << 1) | ExpandBits(cell.z);
+    }
+
+    // Area weighted sum of squared distances to triangle planes, Garland and Heckbert 1997
+    struct Quadric
+    {
+        double a2 = 0, ab = 0, ac = 0, ad = 0;
+        double b2 = 0, bc = 0, bd = 0;
+        double c2 = 0, cd = 0;
+        double d2 = 0;
+        double weight = 0;
+
+        void AddPlane(const glm::dvec3 &n, double d, double w)
+        {
+            a2 += w * n.x * n.x, ab += w * n.x * n.y, ac += w * n.x * n.z, ad += w * n.x * d;
+            b2 += w * n.y * n.y, bc += w * n.y * n.z, bd += w * n.y * d;
+            c2 += w * n.z * n.z, cd += w * n.z * d;
+            d2 += w * d * d;
+            weight += w;
+        }
+
+        void Add(const Quadric &q)
+        {
+            a2 += q.a2, ab += q.ab, ac += q.ac, ad += q.ad;
+            b2 += q.b2, bc += q.bc, bd += q.bd;
+            c2 += q.c2, cd += q.cd;
+            d2 += q.d2;
+            weight += q.weight;
+        }
+
+        // Mean squared distance of p to the accumulated planes
+        double Evaluate(const glm::vec3 &p) const
+        {
+            const double x = p.x, y = p.y, z = p.z;
+            const double error =
+                a2 * x * x + 2 * ab * x * y + 2 * ac * x * z + 2 * ad * x +
+                b2 * y * y + 2 * bc * y * z + 2 * bd * y +
+                c2 * z * z + 2 * cd * z +
+                d2;
+            return weight > 0 ? std::max(error, 0.0) / weight : 0.0;
+        }
+    };
+
+    uint64_t EdgeKey(uint32_t a, uint32_t b)
+    {
+        return a < b ? (uint64_t(a) << 32) | b : (uint64_t(b) << 32) | a;
+    }
+} // namespace
+
+estun::MeshOptimizer::Metrics estun::MeshOptimizer::Analyze(const std::vector<uint32_t> &indices, size_t vertexCount, size_t positionSize, size_t attributeSize)
+{
+    Metrics metrics = {};
+    if (indices.empty() || vertexCount == 0)
+    {
+        return metrics;
+    }
+
+    // Every stream goes through its own lines, a vertex shader miss fetches the vertex from both
+    struct Stream
+    {
+        explicit Stream(size_t vertexSize) : vertexSize(vertexSize) {}
+
+        size_t vertexSize;
+        std::deque<size_t> lines;
+        size_t fetchedBytes = 0;
+
+        void Fetch(uint32_t index)
+        {
+            const size_t firstLine = index * vertexSize / cacheLineSize;
+            const size_t lastLine = ((index + 1) * vertexSize - 1) / cacheLineSize;
+            for (size_t line = firstLine; line <= lastLine; line++)
+            {
+                if (std::find(lines.begin(), lines.end(), line) != lines.end())
+                {
+                    continue;
+                }
+
+                fetchedBytes += cacheLineSize;
+                lines.push_back(line);
+                if (lines.size() > lineCacheSize)
+                {
+                    lines.pop_front();
+                }
+            }
+        }
+    };
+
+    std::deque<uint32_t> cache;
+    std::vector<bool> used(vertexCount, false);
+    Stream positions(positionSize);
+    Stream attributes(attributeSize);
+    size_t misses = 0;
+    size_t usedVertices = 0;
+
+    for (const uint32_t index : indices)
+    {
+        if (!used[index])
+        {
+            used[index] = true;
+            usedVertices++;
+        }
+
+        if (std::find(cache.begin(), cache.end(), index) != cache.end())
+        {
+            continue;
+        }
+
+        misses++;
+        cache.push_back(index);
+        if (cache.size() > cacheSize)
+        {
+            cache.pop_front();
+        }
+
+        positions.Fetch(index);
+        attributes.Fetch(index);
+    }
+
+    metrics.acmr = static_cast<float>(misses) / static_cast<float>(indices.size() / 3);
+    metrics.positionOverfetch = static_cast<float>(positions.fetchedBytes) / static_cast<float>(usedVertices * positionSize);
+    metrics.attributeOverfetch = static_cast<float>(attributes.fetchedBytes) / static_cast<float>(usedVertices * attributeSize);
+
+    return metrics;
+}
+
+void estun::MeshOptimizer::SortTrianglesSpatial(const std::vector<Vertex> &vertices, std::vector<uint32_t> &indices, std::vector<uint32_t> &materialIds)
+{
+    const size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0)
+    {
+        return;
+    }
+
+    std::vector<glm::vec3> centroids(triangleCount);
+    glm::vec3 minBound(std::numeric_limits<float>::max());
+    glm::vec3 maxBound(std::numeric_limits<float>::lowest());
+
+    for (size_t i = 0; i < triangleCount; i++)
+    {
+        centroids[i] = (vertices[indices[i * 3 + 0]].position +
+                        vertices[indices[i * 3 + 1]].position +
+                        vertices[indices[i * 3 + 2]].position) /
+                       3.0f;
+        minBound = glm::min(minBound, centroids[i]);
+        maxBound = glm::max(maxBound, centroids[i]);
+    }
+
+    const glm::vec3 extent = glm::max(maxBound - minBound, glm::vec3(std::numeric_limits<float>::epsilon()));
+
+    std::vector<std::pair<uint32_t, uint32_t>> codes(triangleCount);
+    for (size_t i = 0; i < triangleCount; i++)
+    {
+        codes[i] = {MortonCode((centroids[i] - minBound) / extent), static_cast<uint32_t>(i)};
+    }
+    std::sort(codes.begin(), codes.end());
+
+    std::vector<uint32_t> order(triangleCount);
+    for (size_t i = 0; i < triangleCount; i++)
+    {
+        order[i] = codes[i].second;
+    }
+
+    ReorderTriangles(order, indices, materialIds);
+}
+
+// Tipsify, Sander et al. 2007. Dead ends resume at the next unemitted triangle in input
+// order rather than the next vertex, so a spatially sorted input keeps its locality.
+void estun::MeshOptimizer::OptimizeVertexCache(std::vector<uint32_t> &indices, std::vector<uint32_t> &materialIds, size_t vertexCount)
+{
+    const size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0)
+    {
+        return;
+    }
+
+    std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+    for (const uint32_t index : indices)
+    {
+        adjacencyOffsets[index + 1]++;
+    }
+    for (size_t i = 0; i < vertexCount; i++)
+    {
+        adjacencyOffsets[i + 1] += adjacencyOffsets[i];
+    }
+
+    std::vector<uint32_t> adjacency(indices.size());
+    std::vector<uint32_t> liveTriangles(vertexCount, 0);
+    for (size_t i = 0; i < indices.size(); i++)
+    {
+        const uint32_t vertex = indices[i];
+        adjacency[adjacencyOffsets[vertex] + liveTriangles[vertex]++] = static_cast<uint32_t>(i / 3);
+    }
+
+    std::vector<uint32_t> cacheTime(vertexCount, 0);
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<uint32_t> deadEnds;
+    std::vector<uint32_t> candidates;
+    std::vector<uint32_t> order;
+    order.reserve(triangleCount);
+
+    uint32_t time = cacheSize + 1;
+    size_t cursor = 0;
+    int64_t fanning = indices[0];
+
+    while (fanning >= 0)
+    {
+        candidates.clear();
+
+        for (uint32_t i = adjacencyOffsets[fanning]; i < adjacencyOffsets[fanning + 1]; i++)
+        {
+            const uint32_t triangle = adjacency[i];
+            if (emitted[triangle])
+            {
+                continue;
+            }
+
+            for (uint32_t k = 0; k < 3; k++)
+            {
+                const uint32_t vertex = indices[triangle * 3 + k];
+                deadEnds.push_back(vertex);
+                candidates.push_back(vertex);
+                liveTriangles[vertex]--;
+                if (time - cacheTime[vertex] > cacheSize)
+                {
+                    cacheTime[vertex] = time++;
+                }
+            }
+
+            emitted[triangle] = true;
+            order.push_back(triangle);
+        }
+
+        fanning = -1;
+        int64_t bestPriority = -1;
+        for (const uint32_t vertex : candidates)
+        {
+            if (liveTriangles[vertex] == 0)
+            {
+                continue;
+            }
+
+            int64_t priority = 0;
+            if (time - cacheTime[vertex] + 2 * liveTriangles[vertex] <= cacheSize)
+            {
+                priority = time - cacheTime[vertex];
+            }
+
+            if (priority > bestPriority)
+            {
+                bestPriority = priority;
+                fanning = vertex;
+            }
+        }
+
+        while (fanning < 0 && !deadEnds.empty())
+        {
+            const uint32_t vertex = deadEnds.back();
+            deadEnds.pop_back();
+            if (liveTriangles[vertex] > 0)
+            {
+                fanning = vertex;
+            }
+        }
+
+        while (fanning < 0 && cursor < triangleCount)
+        {
+            if (!emitted[cursor])
+            {
+                fanning = indices[cursor * 3];
+            }
+            cursor++;
+        }
+    }
+
+    ReorderTriangles(order, indices, materialIds);
+}
+
+void estun::MeshOptimizer::OptimizeVertexFetch(std::vector<Vertex> &vertices, std::vector<uint32_t> &indices)
+{
+    const uint32_t unused = std::numeric_limits<uint32_t>::max();
+    std::vector<uint32_t> remap(vertices.size(), unused);
+    std::vector<Vertex> remapped;
+    remapped.reserve(vertices.size());
+
+    for (auto &index : indices)
+    {
+        if (remap[index] == unused)
+        {
+            remap[index] = static_cast<uint32_t>(remapped.size());
+            remapped.push_back(vertices[index]);
+        }
+        index = remap[index];
+    }
+
+    vertices = std::move(remapped);
+}
+
+float estun::MeshOptimizer::Simplify(std::vector<Vertex> &vertices, std::vector<uint32_t> &indices, std::vector<uint32_t> &materialIds, size_t targetIndexCount, float targetError)
+{
+    const uint32_t vertexCount = static_cast<uint32_t>(vertices.size());
+    if (indices.size() <= targetIndexCount || vertexCount == 0)
+    {
+        return 0.0f;
+    }
+
+    glm::vec3 minBound(std::numeric_limits<float>::max());
+    glm::vec3 maxBound(std::numeric_limits<float>::lowest());
+    for (const auto &vertex : vertices)
+    {
+        minBound = glm::min(minBound, vertex.position);
+        maxBound = glm::max(maxBound, vertex.position);
+    }
+    const double errorLimit = targetError * glm::length(maxBound - minBound);
+    const double costLimit = errorLimit * errorLimit;
+
+    // Vertices split for normals or texture coordinates share a position, each position owns one quadric
+    std::unordered_map<glm::vec3, uint32_t> positions;
+    std::vector<uint32_t> wedge(vertexCount);
+    std::vector<uint32_t> wedgeSize(vertexCount, 0);
+    for (uint32_t i = 0; i < vertexCount; i++)
+    {
+        wedge[i] = positions.emplace(vertices[i].position, i).first->second;
+        wedgeSize[wedge[i]]++;
+    }
+
+    std::vector<bool> locked(vertexCount, false);
+    for (uint32_t i = 0; i < vertexCount; i++)
+    {
+        locked[i] = wedgeSize[wedge[i]] > 1;
+    }
+
+    // An edge with one triangle is a border, one between two materials a boundary
+    std::unordered_map<uint64_t, std::pair<uint32_t, uint32_t>> edges;
+    for (size_t t = 0; t < indices.size() / 3; t++)
+    {
+        const uint32_t material = materialIds.empty() ? 0 : materialIds[t];
+        for (uint32_t k = 0; k < 3; k++)
+        {
+            const uint64_t key = EdgeKey(wedge[indices[t * 3 + k]], wedge[indices[t * 3 + (k + 1) % 3]]);
+            auto it = edges.emplace(key, std::make_pair(0u, material)).first;
+            it->second.first += it->second.second == material ? 1 : 2;
+        }
+    }
+    for (const auto &edge : edges)
+    {
+        if (edge.second.first != 2)
+        {
+            locked[edge.first >> 32] = true;
+            locked[edge.first & 0xFFFFFFFF] = true;
+        }
+    }
+    for (uint32_t i = 0; i < vertexCount; i++)
+    {
+        locked[i] = locked[i] || locked[wedge[i]];
+    }
+
+    std::vector<Quadric> quadrics(vertexCount);
+    for (size_t t = 0; t < indices.size() / 3; t++)
+    {
+        const glm::dvec3 p0 = vertices[indices[t * 3 + 0]].position;
+        const glm::dvec3 p1 = vertices[indices[t * 3 + 1]].position;
+        const glm::dvec3 p2 = vertices[indices[t * 3 + 2]].position;
+        const glm::dvec3 normal = glm::cross(p1 - p0, p2 - p0);
+        const double area = glm::length(normal);
+        if (area == 0.0)
+        {
+            continue;
+        }
+
+        const glm::dvec3 n = normal / area;
+        for (uint32_t k = 0; k < 3; k++)
+        {
+            quadrics[wedge[indices[t * 3 + k]]].AddPlane(n, -glm::dot(n, p0), area * 0.5);
+        }
+    }
+
+    struct Collapse
+    {
+        double cost;
+        uint32_t from;
+        uint32_t to;
+
+        bool operator<(const Collapse &other) const { return cost < other.cost; }
+    };
+
+    double maxCost = 0.0;
+    std::vector<Collapse> collapses;
+    std::vector<uint32_t> remap(vertexCount);
+    std::vector<bool> touched(vertexCount);
+    std::vector<uint32_t> adjacencyOffsets(vertexCount + 1);
+    std::vector<uint32_t> adjacency;
+
+    // Independent collapses are applied in passes, cheapest first, the mesh is rebuilt between passes
+    while (indices.size() > targetIndexCount)
+    {
+        collapses.clear();
+        for (size_t i = 0; i < indices.size(); i++)
+        {
+            const uint32_t from = indices[i];
+            const uint32_t to = indices[i - i % 3 + (i + 1) % 3];
+            if (!locked[from] && wedge[from] != wedge[to])
+            {
+                Quadric quadric = quadrics[wedge[from]];
+                quadric.Add(quadrics[wedge[to]]);
+                collapses.push_back({quadric.Evaluate(vertices[to].position), from, to});
+            }
+        }
+        std::sort(collapses.begin(), collapses.end());
+
+        std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+        for (const uint32_t index : indices)
+        {
+            adjacencyOffsets[index + 1]++;
+        }
+        for (uint32_t i = 0; i < vertexCount; i++)
+        {
+            adjacencyOffsets[i + 1] += adjacencyOffsets[i];
+        }
+        adjacency.resize(indices.size());
+        std::vector<uint32_t> filled(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+        for (size_t i = 0; i < indices.size(); i++)
+        {
+            adjacency[filled[indices[i]]++] = static_cast<uint32_t>(i / 3);
+        }
+
+        for (uint32_t i = 0; i < vertexCount; i++)
+        {
+            remap[i] = i;
+        }
+        std::fill(touched.begin(), touched.end(), false);
+
+        size_t remainingIndices = indices.size();
+        size_t applied = 0;
+        for (const auto &collapse : collapses)
+        {
+            if (collapse.cost > costLimit || remainingIndices <= targetIndexCount)
+            {
+                break;
+            }
+            if (touched[collapse.from] || touched[collapse.to])
+            {
+                continue;
+            }
+
+            // Moving the vertex must not turn any of its other triangles over
+            bool flips = false;
+            size_t removed = 0;
+            for (uint32_t a = adjacencyOffsets[collapse.from]; a < adjacencyOffsets[collapse.from + 1] && !flips; a++)
+            {
+                const uint32_t *triangle = &indices[adjacency[a] * 3];
+                if (triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to)
+                {
+                    removed += 3;
+                    continue;
+                }
+
+                glm::vec3 before[3];
+                glm::vec3 after[3];
+                for (uint32_t k = 0; k < 3; k++)
+                {
+                    before[k] = vertices[triangle[k]].position;
+                    after[k] = triangle[k] == collapse.from ? vertices[collapse.to].position : before[k];
+                }
+                const glm::vec3 normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+                const glm::vec3 normalAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+                flips = glm::dot(normalBefore, normalAfter) <= 0.0f;
+            }
+            if (flips)
+            {
+                continue;
+            }
+
+            for (uint32_t a = adjacencyOffsets[collapse.from]; a < adjacencyOffsets[collapse.from + 1]; a++)
+            {
+                for (uint32_t k = 0; k < 3; k++)
+                {
+                    touched[indices[adjacency[a] * 3 + k]] = true;
+                }
+            }
+
+            remap[collapse.from] = collapse.to;
+            quadrics[wedge[collapse.to]].Add(quadrics[wedge[collapse.from]]);
+            maxCost = std::max(maxCost, collapse.cost);
+            remainingIndices -= removed;
+            applied++;
+        }
+
+        if (applied == 0)
+        {
+            break;
+        }
+
+        size_t kept = 0;
+        for (size_t t = 0; t < indices.size() / 3; t++)
+        {
+            const uint32_t i0 = remap[indices[t * 3 + 0]];
+            const uint32_t i1 = remap[indices[t * 3 + 1]];
+            const uint32_t i2 = remap[indices[t * 3 + 2]];
+            if (i0 == i1 || i1 == i2 || i0 == i2)
+            {
+                continue;
+            }
+
+            indices[kept * 3 + 0] = i0;
+            indices[kept * 3 + 1] = i1;
+            indices[kept * 3 + 2] = i2;
+            if (!materialIds.empty())
+            {
+                materialIds[kept] = materialIds[t];
+            }
+            kept++;
+        }
+        indices.resize(kept * 3);
+        if (!materialIds.empty())
+        {
+            materialIds.resize(kept);
+        }
+    }
+
+    OptimizeVertexFetch(vertices, indices);
+
+    return static_cast<float>(std::sqrt(maxCost));
+}
+
+void estun::MeshOptimizer::ReorderTriangles(const std::vector<uint32_t> &order, std::vector<uint32_t> &indices, std::vector<uint32_t> &materialIds)
+{
+    std::vector<uint32_t> newIndices(order.size() * 3);
+    std::vector<uint32_t> newMaterialIds(materialIds.empty() ? 0 : order.size());
+
+    for (size_t i = 0; i < order.size(); i++)
+    {
+        newIndices[i * 3 + 0] = indices[order[i] * 3 + 0];
+        newIndices[i * 3 + 1] = indices[order[i] * 3 + 1];
+        newIndices[i * 3 + 2] = indices[order[i] * 3 + 2];
+        if (!materialIds.empty())
+        {
+            newMaterialIds[i] = materialIds[order[i]];
+        }
+    }
+
+    indices = std::move(newIndices);
+    materialIds = std::move(newMaterialIds);
+}
+
+void estun::MeshOptimizer::Optimize(const std::vector<std::shared_ptr<Model>> &models, std::shared_ptr<ThreadPool> pool)
+{
+    std::vector<std::pair<Metrics, Metrics>> results(models.size());
+
+    auto optimize = [&](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; i++)
+        {
+            results[i] = models[i]->Optimize();
+        }
+    };
+
+    if (pool != nullptr)
+    {
+        pool->ParallelFor(static_cast<uint32_t>(models.size()), 1, optimize);
+    }
+    else
+    {
+        optimize(0, static_cast<uint32_t>(models.size()));
+    }
+
+    // The core logger is single threaded, report once every mesh is done
+    for (size_t i = 0; i < models.size(); i++)
+    {
+        const auto &metrics = results[i];
+        ES_CORE_INFO("Optimized '{0}': ACMR {1:.3f} -> {2:.3f}, position overfetch {3:.3f} -> {4:.3f}, attribute overfetch {5:.3f} -> {6:.3f}",
+                     models[i]->GetName(),
+                     metrics.first.acmr, metrics.second.acmr,
+                     metrics.first.positionOverfetch, metrics.second.positionOverfetch,
+                     metrics.first.attributeOverfetch, metrics.second.attributeOverfetch);
+    }
+}
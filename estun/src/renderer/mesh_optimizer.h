@@ -0,0 +1,43 @@
+#pragma once
+
+#include "renderer/common.h"
+#include "renderer/buffers/vertex.h"
+
+namespace estun
+{
+
+    class Model;
+    class ThreadPool;
+
+    class MeshOptimizer
+    {
+    public:
+        struct Metrics
+        {
+            // Average cache miss ratio, vertex shader invocations per triangle
+            float acmr;
+            // Bytes fetched through 64 byte lines relative to the used part of each stream, the streams are
+            // the ones CompactGeometry uploads
+            float positionOverfetch;
+            float attributeOverfetch;
+        };
+
+        static Metrics Analyze(const std::vector<uint32_t> &indices, size_t vertexCount, size_t positionSize, size_t attributeSize);
+
+        static void SortTrianglesSpatial(const std::vector<Vertex> &vertices, std::vector<uint32_t> &indices, std::vector<uint32_t> &materialIds);
+        static void OptimizeVertexCache(std::vector<uint32_t> &indices, std::vector<uint32_t> &materialIds, size_t vertexCount);
+        static void OptimizeVertexFetch(std::vector<Vertex> &vertices, std::vector<uint32_t> &indices);
+
+        // Quadric error edge collapse towards targetIndexCount, stopping early once a collapse would move the
+        // surface by more than targetError relative to the mesh extent. Borders, attribute seams and material
+        // boundaries are kept. Returns the largest surface distance introduced, in model units.
+        static float Simplify(std::vector<Vertex> &vertices, std::vector<uint32_t> &indices, std::vector<uint32_t> &materialIds, size_t targetIndexCount, float targetError);
+
+        // Optimizes the models in parallel on the pool, or one after another without it, and logs the metrics
+        static void Optimize(const std::vector<std::shared_ptr<Model>> &models, std::shared_ptr<ThreadPool> pool = nullptr);
+
+    private:
+        static void ReorderTriangles(const std::vector<uint32_t> &order, std::vector<uint32_t> &indices, std::vector<uint32_t> &materialIds);
+    };
+
+} // namespace estun
@@ -1,6 +1,8 @@
 #include "renderer/model.h"
 #include "core/core.h"
 #include "renderer/context.h"
+#include "renderer/material/texture_manager.h"
+#include "renderer/buffers/compact_vertex.h"
 
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/gtc/matrix_inverse.hpp>
@@ -14,7 +16,7 @@
 #include <unordered_map>
 #include <vector>
 
-estun::Model estun::Model::LoadModel(const std::string &name, const std::string &filename)
+estun::Model estun::Model::LoadModel(const std::string &name, const std::string &filename, std::shared_ptr<TextureManager> textureManager)
 {
     ES_CORE_INFO(std::string("Loading '") + filename + std::string("'... "));
 
@@ -42,6 +44,15 @@ estun::Model estun::Model::LoadModel(const std::string &name, const std::string
         m.diffuse_ = glm::vec4(material.diffuse[0], material.diffuse[1], material.diffuse[2], 1.0);
         m.diffuseTextureId_ = -1;
 
+        if (textureManager != nullptr && !material.diffuse_texname.empty())
+        {
+            const std::string texturePath = TextureManager::Resolve(material.diffuse_texname, materialPath);
+            if (!texturePath.empty())
+            {
+                m.diffuseTextureId_ = textureManager->Load(texturePath, SamplerConfig(), TextureCompression::BC7);
+            }
+        }
+
         materials.emplace_back(m);
     }
 
@@ -60,13 +71,18 @@ estun::Model estun::Model::LoadModel(const std::string &name, const std::string
 
     std::vector<Vertex> vertices;
     std::vector<uint32_t> indices;
+    std::vector<uint32_t> materialIds;
     std::unordered_map<Vertex, uint32_t> uniqueVertices(objAttrib.vertices.size());
-    size_t faceId = 0;
 
     for (const auto &shape : objReader.GetShapes())
     {
         const auto &mesh = shape.mesh;
 
+        for (const auto materialId : mesh.material_ids)
+        {
+            materialIds.push_back(static_cast<uint32_t>(std::max(0, materialId)));
+        }
+
         for (const auto &index : mesh.indices)
         {
             Vertex vertex = {};
@@ -91,8 +107,6 @@ estun::Model estun::Model::LoadModel(const std::string &name, const std::string
                         1 - objAttrib.texcoords[2 * index.texcoord_index + 1]};
             }
 
-            //vertex.materialIndex = std::max(0, mesh.material_ids[faceId++ / 3]);
-
             if (uniqueVertices.count(vertex) == 0)
             {
                 uniqueVertices[vertex] = static_cast<uint32_t>(vertices.size());
@@ -108,7 +122,7 @@ estun::Model estun::Model::LoadModel(const std::string &name, const std::string
                  std::to_string(uniqueVertices.size()) + std::string(" unique vertices, ") +
                  std::to_string(materials.size()) + std::string(" materials)"));
 
-    return Model(name, std::move(vertices), std::move(indices), std::move(materials));
+    return Model(name, std::move(vertices), std::move(indices), std::move(materials), std::move(materialIds));
 }
 
 estun::Model estun::Model::CreateBox(const glm::vec3 &p0, const glm::vec3 &p1, const Material &material)
@@ -253,6 +267,57 @@ void estun::Model::Transform(const glm::mat4 &transform)
     }
 }
 
+std::pair<estun::MeshOptimizer::Metrics, estun::MeshOptimizer::Metrics> estun::Model::Optimize()
+{
+    const auto before = MeshOptimizer::Analyze(indices_, vertices_.size(), sizeof(glm::vec3), sizeof(CompactVertex));
+
+    MeshOptimizer::SortTrianglesSpatial(vertices_, indices_, materialIds_);
+    MeshOptimizer::OptimizeVertexCache(indices_, materialIds_, vertices_.size());
+    MeshOptimizer::OptimizeVertexFetch(vertices_, indices_);
+
+    verticesSize_ = vertices_.size();
+    indicesSize_ = indices_.size();
+
+    return {before, MeshOptimizer::Analyze(indices_, vertices_.size(), sizeof(glm::vec3), sizeof(CompactVertex))};
+}
+
+void estun::Model::GenerateLods(uint32_t maxLods, float reduction, float maxError)
+{
+    lods_.clear();
+    lodErrors_.clear();
+
+    std::vector<Vertex> vertices = vertices_;
+    std::vector<uint32_t> indices = indices_;
+    std::vector<uint32_t> materialIds = materialIds_;
+    float error = 0.0f;
+
+    for (uint32_t lod = 1; lod <= maxLods; lod++)
+    {
+        const size_t previous = indices.size();
+        error += MeshOptimizer::Simplify(vertices, indices, materialIds, previous / 3 * reduction * 3, maxError);
+
+        // Locked borders and seams stall the reduction, a level that barely shrinks only costs memory
+        if (indices.empty() || indices.size() > previous * (1.0f + reduction) * 0.5f)
+        {
+            break;
+        }
+
+        auto model = std::make_shared<Model>(
+            name_ + "_lod" + std::to_string(lod),
+            std::vector<Vertex>(vertices),
+            std::vector<uint32_t>(indices),
+            std::vector<Material>(materials_),
+            std::vector<uint32_t>(materialIds));
+        model->Optimize();
+
+        lods_.push_back(model);
+        lodErrors_.push_back(error);
+    }
+
+    ES_CORE_INFO("Generated {0} LODs for '{1}', {2} triangles down to {3}",
+                 lods_.size(), name_, indices_.size() / 3, lods_.empty() ? indices_.size() / 3 : lods_.back()->GetIndices().size() / 3);
+}
+
 estun::Model::Model(const std::string &name, std::vector<Vertex> &&vertices, std::vector<uint32_t> &&indices, std::vector<Material> &&materials)
     : name_(name),
       vertices_(std::move(vertices)),
@@ -260,6 +325,28 @@ estun::Model::Model(const std::string &name, std::vector<Vertex> &&vertices, std
       materials_(std::move(materials)),
       verticesSize_(vertices_.size()),
       indicesSize_(indices_.size()),
-      materialsSize_(materials.size())
+      materialsSize_(materials_.size())
 {
+    // Procedural models tag materials per vertex, the first vertex of a triangle decides
+    materialIds_.reserve(indices_.size() / 3);
+    for (size_t i = 0; i + 2 < indices_.size(); i += 3)
+    {
+        materialIds_.push_back(static_cast<uint32_t>(std::max(0, vertices_[indices_[i]].materialIndex)));
+    }
+}
+
+estun::Model::Model(const std::string &name, std::vector<Vertex> &&vertices, std::vector<uint32_t> &&indices, std::vector<Material> &&materials, std::vector<uint32_t> &&materialIds)
+    : vertices_(std::move(vertices)),
+      indices_(std::move(indices)),
+      materials_(std::move(materials)),
+      materialIds_(std::move(materialIds)),
+      name_(name),
+      verticesSize_(vertices_.size()),
+      indicesSize_(indices_.size()),
+      materialsSize_(materials_.size())
+{
+    if (materialIds_.size() != indices_.size() / 3)
+    {
+        ES_CORE_ASSERT(std::string("Model '") + name_ + std::string("' has a material id count that does not match its triangles"));
+    }
 }
@@ -4,14 +4,18 @@
 #include "includes/glm.h"
 #include "renderer/buffers/vertex.h"
 #include "renderer/material/material.h"
+#include "renderer/mesh_optimizer.h"
 
 namespace estun
 {
 
+class TextureManager;
+
 class Model
 {
 public:
-    static Model LoadModel(const std::string &name, const std::string &filename);
+    // Diffuse maps of the MTL file are requested as BC7 from the texture manager when one is given
+    static Model LoadModel(const std::string &name, const std::string &filename, std::shared_ptr<TextureManager> textureManager = nullptr);
     static Model CreateBox(const glm::vec3 &p0, const glm::vec3 &p1, const Material &material);
     static Model CreateSphere(const glm::vec3 &center, float radius, const Material &material);
 
@@ -24,13 +28,23 @@ public:
     ~Model() = default;
 
     Model(const std::string &name, std::vector<Vertex> &&vertices, std::vector<uint32_t> &&indices, std::vector<Material> &&materials);
+    Model(const std::string &name, std::vector<Vertex> &&vertices, std::vector<uint32_t> &&indices, std::vector<Material> &&materials, std::vector<uint32_t> &&materialIds);
 
     void SetMaterial(const Material &material);
     void Transform(const glm::mat4 &transform);
+    std::pair<MeshOptimizer::Metrics, MeshOptimizer::Metrics> Optimize();
+
+    // Simplifies the model into up to maxLods coarser copies, each aiming at reduction times the triangles of
+    // the one before. Call once the model is in its final space, the errors are in model units.
+    void GenerateLods(uint32_t maxLods, float reduction = 0.5f, float maxError = 0.05f);
+    const std::vector<std::shared_ptr<Model>> &GetLods() const { return lods_; }
+    // Surface distance of every LOD to this model, a bound accumulated over the chain
+    const std::vector<float> &GetLodErrors() const { return lodErrors_; }
 
     const std::vector<Vertex> &GetVertices() const { return vertices_; }
     const std::vector<uint32_t> &GetIndices() const { return indices_; }
     const std::vector<Material> &GetMaterials() const { return materials_; }
+    const std::vector<uint32_t> &GetMaterialIds() const { return materialIds_; }
     const std::string &GetName() const { return name_; }
 
     uint32_t SizeOfVertices() const { return verticesSize_; }   //static_cast<uint32_t>(vertices_.size())
@@ -41,8 +55,12 @@ private:
     std::vector<Vertex> vertices_;
     std::vector<uint32_t> indices_;
     std::vector<Material> materials_;
+    std::vector<uint32_t> materialIds_;
     std::string name_;
 
+    std::vector<std::shared_ptr<Model>> lods_;
+    std::vector<float> lodErrors_;
+
     uint32_t verticesSize_;
     uint32_t indicesSize_;
     uint32_t materialsSize_;
@@ -0,0 +1,203 @@
+#include "renderer/ray_tracing/acceleration_structure_cache.h"
+#include "renderer/buffers/buffer.h"
+#include "renderer/context/device.h"
+#include "renderer/context/dynamic_functions.h"
+#include "renderer/context/single_time_commands.h"
+#include "renderer/device_memory.h"
+#include "core/core.h"
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+namespace
+{
+    // Serialized header: driver uuid, compatibility uuid, serialized size, deserialized size
+    const size_t versionSize = 2 * VK_UUID_SIZE;
+    const size_t headerSize = versionSize + 2 * sizeof(uint64_t);
+} // namespace
+
+estun::AccelerationStructureCache::AccelerationStructureCache(const std::string &directory)
+    : directory_(directory)
+{
+    std::error_code error;
+    std::filesystem::create_directories(directory_, error);
+    if (error)
+    {
+        ES_CORE_WARN(std::string("Failed to create acceleration structure cache directory '") + directory_ + std::string("'"));
+    }
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(DeviceLocator::GetPhysicalDevice(), &properties);
+
+    std::stringstream key;
+    key << std::hex << properties.vendorID << "_" << properties.deviceID << "_" << properties.driverVersion;
+    deviceKey_ = key.str();
+}
+
+estun::AccelerationStructureCache::~AccelerationStructureCache()
+{
+}
+
+std::string estun::AccelerationStructureCache::GetPath(uint64_t hash) const
+{
+    std::stringstream path;
+    path << directory_ << "/" << std::hex << hash << "_" << deviceKey_ << ".as";
+    return path.str();
+}
+
+bool estun::AccelerationStructureCache::Contains(uint64_t hash) const
+{
+    std::error_code error;
+    return pending_.count(hash) != 0 || std::filesystem::exists(GetPath(hash), error);
+}
+
+bool estun::AccelerationStructureCache::Load(uint64_t hash, VkAccelerationStructureKHR accelerationStructure, VkDeviceSize objectSize)
+{
+    auto pending = pending_.find(hash);
+    if (pending != pending_.end())
+    {
+        const std::vector<uint8_t> data = std::move(pending->second);
+        pending_.erase(pending);
+        return Deserialize(hash, data, accelerationStructure, objectSize);
+    }
+
+    std::ifstream file(GetPath(hash), std::ios::binary | std::ios::ate);
+    if (!file.is_open())
+    {
+        return false;
+    }
+
+    std::vector<uint8_t> data(static_cast<size_t>(file.tellg()));
+    file.seekg(0);
+    file.read(reinterpret_cast<char *>(data.data()), data.size());
+
+    return Deserialize(hash, data, accelerationStructure, objectSize);
+}
+
+bool estun::AccelerationStructureCache::Deserialize(uint64_t hash, const std::vector<uint8_t> &data, VkAccelerationStructureKHR accelerationStructure, VkDeviceSize objectSize)
+{
+    const size_t size = data.size();
+    if (size < headerSize)
+    {
+        return false;
+    }
+
+    VkAccelerationStructureVersionKHR version = {};
+    version.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_VERSION_KHR;
+    version.pNext = nullptr;
+    version.versionData = data.data();
+
+    if (FunctionsLocator::GetFunctions().vkGetDeviceAccelerationStructureCompatibilityKHR(DeviceLocator::GetLogicalDevice(), &version) != VK_SUCCESS)
+    {
+        ES_CORE_WARN(std::string("Cached acceleration structure '") + GetPath(hash) + std::string("' is incompatible, rebuilding"));
+        return false;
+    }
+
+    uint64_t serializedSize;
+    uint64_t deserializedSize;
+    std::memcpy(&serializedSize, data.data() + versionSize, sizeof(uint64_t));
+    std::memcpy(&deserializedSize, data.data() + versionSize + sizeof(uint64_t), sizeof(uint64_t));
+    if (serializedSize != size || deserializedSize > objectSize)
+    {
+        ES_CORE_WARN(std::string("Cached acceleration structure '") + GetPath(hash) + std::string("' does not fit, rebuilding"));
+        return false;
+    }
+
+    Buffer buffer(size, VK_BUFFER_USAGE_RAY_TRACING_BIT_KHR | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT);
+    DeviceMemory memory = buffer.AllocateMemory(VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, true);
+
+    std::memcpy(memory.Map(0, size), data.data(), size);
+    memory.Unmap();
+
+    SingleTimeCommands::SubmitCompute([&buffer, accelerationStructure](VkCommandBuffer commandBuffer) {
+        VkCopyMemoryToAccelerationStructureInfoKHR copyInfo = {};
+        copyInfo.sType = VK_STRUCTURE_TYPE_COPY_MEMORY_TO_ACCELERATION_STRUCTURE_INFO_KHR;
+        copyInfo.pNext = nullptr;
+        copyInfo.src.deviceAddress = buffer.GetDeviceAddress();
+        copyInfo.dst = accelerationStructure;
+        copyInfo.mode = VK_COPY_ACCELERATION_STRUCTURE_MODE_DESERIALIZE_KHR;
+
+        FunctionsLocator::GetFunctions().vkCmdCopyMemoryToAccelerationStructureKHR(commandBuffer, &copyInfo);
+    }, "deserialize acceleration structure");
+
+    return true;
+}
+
+void estun::AccelerationStructureCache::Store(uint64_t hash, VkAccelerationStructureKHR accelerationStructure)
+{
+    VkQueryPoolCreateInfo queryPoolInfo = {};
+    queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    queryPoolInfo.queryType = VK_QUERY_TYPE_ACCELERATION_STRUCTURE_SERIALIZATION_SIZE_KHR;
+    queryPoolInfo.queryCount = 1;
+
+    VkQueryPool queryPool;
+    VK_CHECK_RESULT(vkCreateQueryPool(DeviceLocator::GetLogicalDevice(), &queryPoolInfo, nullptr, &queryPool), "create query pool");
+
+    SingleTimeCommands::SubmitCompute([queryPool, accelerationStructure](VkCommandBuffer commandBuffer) {
+        vkCmdResetQueryPool(commandBuffer, queryPool, 0, 1);
+        FunctionsLocator::GetFunctions().vkCmdWriteAccelerationStructuresPropertiesKHR(
+            commandBuffer, 1, &accelerationStructure,
+            VK_QUERY_TYPE_ACCELERATION_STRUCTURE_SERIALIZATION_SIZE_KHR, queryPool, 0);
+    }, "query acceleration structure serialization size");
+
+    uint64_t size = 0;
+    VK_CHECK_RESULT(vkGetQueryPoolResults(DeviceLocator::GetLogicalDevice(), queryPool, 0, 1, sizeof(size), &size, sizeof(size), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT), "get serialization size");
+    vkDestroyQueryPool(DeviceLocator::GetLogicalDevice(), queryPool, nullptr);
+
+    if (size == 0)
+    {
+        return;
+    }
+
+    Buffer buffer(size, VK_BUFFER_USAGE_RAY_TRACING_BIT_KHR | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT);
+    DeviceMemory memory = buffer.AllocateMemory(VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, true);
+
+    SingleTimeCommands::SubmitCompute([&buffer, accelerationStructure](VkCommandBuffer commandBuffer) {
+        VkCopyAccelerationStructureToMemoryInfoKHR copyInfo = {};
+        copyInfo.sType = VK_STRUCTURE_TYPE_COPY_ACCELERATION_STRUCTURE_TO_MEMORY_INFO_KHR;
+        copyInfo.pNext = nullptr;
+        copyInfo.src = accelerationStructure;
+        copyInfo.dst.deviceAddress = buffer.GetDeviceAddress();
+        copyInfo.mode = VK_COPY_ACCELERATION_STRUCTURE_MODE_SERIALIZE_KHR;
+
+        FunctionsLocator::GetFunctions().vkCmdCopyAccelerationStructureToMemoryKHR(commandBuffer, &copyInfo);
+    }, "serialize acceleration structure");
+
+    std::vector<uint8_t> data(size);
+    std::memcpy(data.data(), memory.Map(0, size), size);
+    memory.Unmap();
+
+    Write(hash, data);
+}
+
+void estun::AccelerationStructureCache::Store(uint64_t hash, std::vector<uint8_t> &&data)
+{
+    Write(hash, data);
+    pending_[hash] = std::move(data);
+}
+
+void estun::AccelerationStructureCache::Write(uint64_t hash, const std::vector<uint8_t> &data) const
+{
+    // Write to a temporary name first so an interrupted run never leaves a truncated entry
+    const std::string path = GetPath(hash);
+    bool written = false;
+    {
+        std::ofstream file(path + ".tmp", std::ios::binary | std::ios::trunc);
+        if (file.is_open())
+        {
+            file.write(reinterpret_cast<const char *>(data.data()), data.size());
+            written = file.good();
+        }
+    }
+
+    std::error_code error;
+    if (written)
+    {
+        std::filesystem::rename(path + ".tmp", path, error);
+    }
+    if (!written || error)
+    {
+        ES_CORE_WARN(std::string("Failed to write acceleration structure cache '") + path + std::string("'"));
+    }
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "renderer/common.h"
+
+namespace estun
+{
+
+    class AccelerationStructureCache
+    {
+    public:
+        AccelerationStructureCache(const AccelerationStructureCache &) = delete;
+        AccelerationStructureCache(AccelerationStructureCache &&) = delete;
+        AccelerationStructureCache &operator=(const AccelerationStructureCache &) = delete;
+        AccelerationStructureCache &operator=(AccelerationStructureCache &&) = delete;
+
+        AccelerationStructureCache(const std::string &directory);
+        ~AccelerationStructureCache();
+
+        // Deserializes into an already created and bound structure, false means it has to be built
+        bool Load(uint64_t hash, VkAccelerationStructureKHR accelerationStructure, VkDeviceSize objectSize);
+        void Store(uint64_t hash, VkAccelerationStructureKHR accelerationStructure);
+
+        // Stores an already serialized structure, it stays in memory until the next Load of the same hash
+        void Store(uint64_t hash, std::vector<uint8_t> &&data);
+        bool Contains(uint64_t hash) const;
+
+    private:
+        std::string GetPath(uint64_t hash) const;
+        void Write(uint64_t hash, const std::vector<uint8_t> &data) const;
+        bool Deserialize(uint64_t hash, const std::vector<uint8_t> &data, VkAccelerationStructureKHR accelerationStructure, VkDeviceSize objectSize);
+
+        std::string directory_;
+        std::string deviceKey_;
+        std::unordered_map<uint64_t, std::vector<uint8_t>> pending_;
+    };
+
+} // namespace estun
@@ -1,10 +1,13 @@
 #include "renderer/ray_tracing/bottom_level_acceleration_structure.h"
+#include "renderer/ray_tracing/acceleration_structure_cache.h"
 #include "renderer/buffers/buffer.h"
 #include "renderer/buffers/storage_buffer.h"
 #include "renderer/context/device.h"
 #include "renderer/context/dynamic_functions.h"
 #include "renderer/context/single_time_commands.h"
 
+#include <chrono>
+
 VkMemoryRequirements estun::BLAS::GetBufferMemoryRequirements(VkAccelerationStructureKHR accelerationStructure, VkAccelerationStructureMemoryRequirementsTypeKHR type)
 {
     VkMemoryRequirements2 memoryRequirements2;
@@ -26,35 +29,36 @@ estun::BLAS::BLAS(
     std::shared_ptr<VertexBuffer> vertexBuffer, std::shared_ptr<IndexBuffer> indexBuffer,
     uint32_t vertexCount, uint32_t indexCount,
     uint32_t vertexOffset, uint32_t indexOffset)
+    : BLAS(BLASGeometry{
+          vertexBuffer->GetDeviceAddress(), sizeof(Vertex),
+          indexBuffer->GetDeviceAddress(), VK_INDEX_TYPE_UINT32,
+          vertexCount, indexCount, vertexOffset, indexOffset})
+{
+}
+
+estun::BLAS::BLAS(const BLASGeometry &blasGeometry, std::shared_ptr<AccelerationStructureCache> cache)
 {
+    hitGroup_ = blasGeometry.hitGroup;
+
+    const uint32_t vertexCount = blasGeometry.vertexCount;
+    const uint32_t indexCount = blasGeometry.indexCount;
+
     VkAccelerationStructureCreateGeometryTypeInfoKHR geometryTypeInfo = {};
     geometryTypeInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_CREATE_GEOMETRY_TYPE_INFO_KHR;
     geometryTypeInfo.pNext = nullptr;
     geometryTypeInfo.geometryType = VK_GEOMETRY_TYPE_TRIANGLES_KHR;
     geometryTypeInfo.maxPrimitiveCount = indexCount / 3;
-    geometryTypeInfo.indexType = VK_INDEX_TYPE_UINT32;
+    geometryTypeInfo.indexType = blasGeometry.indexType;
     geometryTypeInfo.maxVertexCount = vertexCount;
     geometryTypeInfo.vertexFormat = VK_FORMAT_R32G32B32_SFLOAT;
     geometryTypeInfo.allowsTransforms = VK_FALSE;
 
-    VkAccelerationStructureCreateInfoKHR structureCreateInfo = {};
-    structureCreateInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_CREATE_INFO_KHR;
-    structureCreateInfo.pNext = nullptr;
-    structureCreateInfo.compactedSize = 0;
-    structureCreateInfo.type = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR;
-    structureCreateInfo.flags = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR;
-    structureCreateInfo.maxGeometryCount = 1;
-    structureCreateInfo.pGeometryInfos = &geometryTypeInfo;
-    structureCreateInfo.deviceAddress = VK_NULL_HANDLE;
-
-    VK_CHECK_RESULT(FunctionsLocator::GetFunctions().vkCreateAccelerationStructureKHR(DeviceLocator::GetLogicalDevice(), &structureCreateInfo, nullptr, &accelerationStructure_), "create acceleration structure");
-
-    auto blasMemoryRequirements = GetBufferMemoryRequirements(accelerationStructure_, VK_ACCELERATION_STRUCTURE_MEMORY_REQUIREMENTS_TYPE_OBJECT_KHR);
-    buildScratchSize_ = GetBufferMemoryRequirements(accelerationStructure_, VK_ACCELERATION_STRUCTURE_MEMORY_REQUIREMENTS_TYPE_BUILD_SCRATCH_KHR).size;
-    objectSize_ = blasMemoryRequirements.size;
+    if (blasGeometry.allowUpdate)
+    {
+        flags_ |= VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_UPDATE_BIT_KHR;
+    }
 
-    std::shared_ptr<Buffer> scratchBuffer = std::make_shared<Buffer>(buildScratchSize_, VK_BUFFER_USAGE_RAY_TRACING_BIT_KHR | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT);
-    std::shared_ptr<DeviceMemory> scratchMemory = std::make_shared<DeviceMemory>(scratchBuffer->AllocateMemory(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, true));
+    Create(geometryTypeInfo);
 
     VkAccelerationStructureGeometryKHR geometry = {};
     geometry.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR;
@@ -64,22 +68,98 @@ estun::BLAS::BLAS(
     geometry.geometry.triangles.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_TRIANGLES_DATA_KHR;
     geometry.geometry.triangles.pNext = nullptr;
     geometry.geometry.triangles.vertexFormat = VK_FORMAT_R32G32B32_SFLOAT;
-    geometry.geometry.triangles.vertexData.deviceAddress = vertexBuffer->GetDeviceAddress();
-    geometry.geometry.triangles.vertexStride = sizeof(Vertex);
-    geometry.geometry.triangles.indexType = VK_INDEX_TYPE_UINT32;
-    geometry.geometry.triangles.indexData.deviceAddress = indexBuffer->GetDeviceAddress();
+    geometry.geometry.triangles.vertexData.deviceAddress = blasGeometry.vertexAddress;
+    geometry.geometry.triangles.vertexStride = blasGeometry.vertexStride;
+    geometry.geometry.triangles.indexType = blasGeometry.indexType;
+    geometry.geometry.triangles.indexData.deviceAddress = blasGeometry.indexAddress;
     geometry.geometry.triangles.transformData.deviceAddress = 0;
     geometry.flags = VK_GEOMETRY_OPAQUE_BIT_KHR;
 
     VkAccelerationStructureBuildOffsetInfoKHR buildOffsetInfo = {};
     buildOffsetInfo.primitiveCount = indexCount / 3;
-    buildOffsetInfo.primitiveOffset = indexOffset;
-    buildOffsetInfo.firstVertex = vertexOffset;
+    buildOffsetInfo.primitiveOffset = blasGeometry.indexOffset;
+    buildOffsetInfo.firstVertex = blasGeometry.vertexOffset;
+    buildOffsetInfo.transformOffset = 0;
+
+    accelerationGeometries_.push_back(geometry);
+    buildOffsets_.push_back(buildOffsetInfo);
+
+    const bool cacheable = cache != nullptr && blasGeometry.hash != 0;
+    if (cacheable && cache->Load(blasGeometry.hash, accelerationStructure_, objectSize_))
+    {
+        return;
+    }
+
+    Build();
+
+    if (cacheable)
+    {
+        cache->Store(blasGeometry.hash, accelerationStructure_);
+    }
+}
+
+estun::BLAS::BLAS(const BLASProcedural &procedural)
+{
+    hitGroup_ = procedural.hitGroup;
+
+    VkAccelerationStructureCreateGeometryTypeInfoKHR geometryTypeInfo = {};
+    geometryTypeInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_CREATE_GEOMETRY_TYPE_INFO_KHR;
+    geometryTypeInfo.pNext = nullptr;
+    geometryTypeInfo.geometryType = VK_GEOMETRY_TYPE_AABBS_KHR;
+    geometryTypeInfo.maxPrimitiveCount = procedural.aabbCount;
+    geometryTypeInfo.indexType = VK_INDEX_TYPE_NONE_KHR;
+    geometryTypeInfo.maxVertexCount = 0;
+    geometryTypeInfo.vertexFormat = VK_FORMAT_UNDEFINED;
+    geometryTypeInfo.allowsTransforms = VK_FALSE;
+
+    Create(geometryTypeInfo);
+
+    VkAccelerationStructureGeometryKHR geometry = {};
+    geometry.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR;
+    geometry.pNext = nullptr;
+    geometry.geometryType = VK_GEOMETRY_TYPE_AABBS_KHR;
+    geometry.geometry = {};
+    geometry.geometry.aabbs.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_AABBS_DATA_KHR;
+    geometry.geometry.aabbs.pNext = nullptr;
+    geometry.geometry.aabbs.data.deviceAddress = procedural.aabbAddress;
+    geometry.geometry.aabbs.stride = sizeof(VkAabbPositionsKHR);
+    geometry.flags = VK_GEOMETRY_OPAQUE_BIT_KHR;
+
+    VkAccelerationStructureBuildOffsetInfoKHR buildOffsetInfo = {};
+    buildOffsetInfo.primitiveCount = procedural.aabbCount;
+    buildOffsetInfo.primitiveOffset = procedural.aabbOffset;
+    buildOffsetInfo.firstVertex = 0;
     buildOffsetInfo.transformOffset = 0;
 
     accelerationGeometries_.push_back(geometry);
-    buildOffsets_.push_back(&buildOffsetInfo);
-    
+    buildOffsets_.push_back(buildOffsetInfo);
+
+    Build();
+}
+
+void estun::BLAS::Create(const VkAccelerationStructureCreateGeometryTypeInfoKHR &geometryTypeInfo)
+{
+    VkAccelerationStructureCreateInfoKHR structureCreateInfo = {};
+    structureCreateInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_CREATE_INFO_KHR;
+    structureCreateInfo.pNext = nullptr;
+    structureCreateInfo.compactedSize = 0;
+    structureCreateInfo.type = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR;
+    structureCreateInfo.flags = flags_;
+    structureCreateInfo.maxGeometryCount = 1;
+    structureCreateInfo.pGeometryInfos = &geometryTypeInfo;
+    structureCreateInfo.deviceAddress = VK_NULL_HANDLE;
+
+    VK_CHECK_RESULT(FunctionsLocator::GetFunctions().vkCreateAccelerationStructureKHR(DeviceLocator::GetLogicalDevice(), &structureCreateInfo, nullptr, &accelerationStructure_), "create acceleration structure");
+
+    auto blasMemoryRequirements = GetBufferMemoryRequirements(accelerationStructure_, VK_ACCELERATION_STRUCTURE_MEMORY_REQUIREMENTS_TYPE_OBJECT_KHR);
+    buildScratchSize_ = GetBufferMemoryRequirements(accelerationStructure_, VK_ACCELERATION_STRUCTURE_MEMORY_REQUIREMENTS_TYPE_BUILD_SCRATCH_KHR).size;
+    if (flags_ & VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_UPDATE_BIT_KHR)
+    {
+        const uint32_t updateScratchSize = GetBufferMemoryRequirements(accelerationStructure_, VK_ACCELERATION_STRUCTURE_MEMORY_REQUIREMENTS_TYPE_UPDATE_SCRATCH_KHR).size;
+        buildScratchSize_ = std::max(buildScratchSize_, updateScratchSize);
+    }
+    objectSize_ = blasMemoryRequirements.size;
+
     blasMemory_.reset(new DeviceMemory(objectSize_, blasMemoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, true));
 
     VkBindAccelerationStructureMemoryInfoKHR bindMemoryInfo = {};
@@ -92,34 +172,77 @@ estun::BLAS::BLAS(
     bindMemoryInfo.pDeviceIndices = nullptr;
 
     VK_CHECK_RESULT(FunctionsLocator::GetFunctions().vkBindAccelerationStructureMemoryKHR(DeviceLocator::GetLogicalDevice(), 1, &bindMemoryInfo), "bind acceleration structure");
+}
+
+void estun::BLAS::Build()
+{
+    std::shared_ptr<Buffer> scratchBuffer = std::make_shared<Buffer>(buildScratchSize_, VK_BUFFER_USAGE_RAY_TRACING_BIT_KHR | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT);
+    std::shared_ptr<DeviceMemory> scratchMemory = std::make_shared<DeviceMemory>(scratchBuffer->AllocateMemory(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, true));
 
     SingleTimeCommands::SubmitCompute([this, scratchBuffer](VkCommandBuffer commandBuffer) {
-        const VkAccelerationStructureGeometryKHR *pGeometries = accelerationGeometries_.data();
-
-        VkAccelerationStructureBuildGeometryInfoKHR buildGeometryInfo = {};
-        buildGeometryInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR;
-        buildGeometryInfo.pNext = nullptr;
-        buildGeometryInfo.type = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR;
-        buildGeometryInfo.flags = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR;
-        buildGeometryInfo.update = false;
-        buildGeometryInfo.srcAccelerationStructure = VK_NULL_HANDLE;
-        buildGeometryInfo.dstAccelerationStructure = accelerationStructure_;
-        buildGeometryInfo.geometryArrayOfPointers = VK_FALSE;
-        buildGeometryInfo.geometryCount = 1;
-        buildGeometryInfo.ppGeometries = &pGeometries;
-        buildGeometryInfo.scratchData.deviceAddress = scratchBuffer->GetDeviceAddress();
-
-        FunctionsLocator::GetFunctions().vkCmdBuildAccelerationStructureKHR(commandBuffer, 1, &buildGeometryInfo, buildOffsets_.data());
+        Record(commandBuffer, false, scratchBuffer->GetDeviceAddress());
     }, "create blas");
+
+    if (flags_ & VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_UPDATE_BIT_KHR)
+    {
+        scratchBuffer_ = scratchBuffer;
+        scratchMemory_ = scratchMemory;
+    }
+}
+
+void estun::BLAS::Update(VkCommandBuffer commandBuffer)
+{
+    if (scratchBuffer_ == nullptr)
+    {
+        ES_CORE_ASSERT("BLAS was not created with allowUpdate");
+        return;
+    }
+
+    Record(commandBuffer, true, scratchBuffer_->GetDeviceAddress());
+}
+
+void estun::BLAS::Rebuild(VkCommandBuffer commandBuffer)
+{
+    if (scratchBuffer_ == nullptr)
+    {
+        ES_CORE_ASSERT("BLAS was not created with allowUpdate");
+        return;
+    }
+
+    Record(commandBuffer, false, scratchBuffer_->GetDeviceAddress());
 }
 
+void estun::BLAS::Record(VkCommandBuffer commandBuffer, bool update, VkDeviceAddress scratchAddress)
+{
+    const VkAccelerationStructureGeometryKHR *pGeometries = accelerationGeometries_.data();
+    const VkAccelerationStructureBuildOffsetInfoKHR *pBuildOffsets = buildOffsets_.data();
+
+    VkAccelerationStructureBuildGeometryInfoKHR buildGeometryInfo = {};
+    buildGeometryInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR;
+    buildGeometryInfo.pNext = nullptr;
+    buildGeometryInfo.type = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR;
+    buildGeometryInfo.flags = flags_;
+    buildGeometryInfo.update = update ? VK_TRUE : VK_FALSE;
+    buildGeometryInfo.srcAccelerationStructure = update ? accelerationStructure_ : VK_NULL_HANDLE;
+    buildGeometryInfo.dstAccelerationStructure = accelerationStructure_;
+    buildGeometryInfo.geometryArrayOfPointers = VK_FALSE;
+    buildGeometryInfo.geometryCount = 1;
+    buildGeometryInfo.ppGeometries = &pGeometries;
+    buildGeometryInfo.scratchData.deviceAddress = scratchAddress;
+
+    FunctionsLocator::GetFunctions().vkCmdBuildAccelerationStructureKHR(commandBuffer, 1, &buildGeometryInfo, &pBuildOffsets);
+}
 
 estun::BLAS::~BLAS()
 {
+    scratchBuffer_.reset();
+    scratchMemory_.reset();
     blasMemory_.reset();
     if (accelerationStructure_ != nullptr)
     {
-        FunctionsLocator::GetFunctions().vkDestroyAccelerationStructureKHR(DeviceLocator::GetLogicalDevice(), accelerationStructure_, nullptr);
+        DeviceLocator::GetDevice().GetDeletionQueue().Push([handle = accelerationStructure_]() {
+            FunctionsLocator::GetFunctions().vkDestroyAccelerationStructureKHR(DeviceLocator::GetLogicalDevice(), handle, nullptr);
+        });
         accelerationStructure_ = nullptr;
     }
 }
@@ -161,3 +284,21 @@ std::vector<std::shared_ptr<estun::BLAS>> estun::BLAS::CreateBlases(
 
     return blases;
 }
+
+std::vector<std::shared_ptr<estun::BLAS>> estun::BLAS::CreateBlases(const std::vector<BLASGeometry> &geometries, std::shared_ptr<AccelerationStructureCache> cache)
+{
+    ES_CORE_INFO("creating BLASes ...");
+    std::vector<std::shared_ptr<BLAS>> blases;
+
+    const auto start = std::chrono::high_resolution_clock::now();
+
+    for (const auto &geometry : geometries)
+    {
+        blases.push_back(std::make_shared<BLAS>(geometry, cache));
+    }
+
+    const auto elapsed = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    ES_CORE_INFO("BLASes created in {0} ms", elapsed);
+
+    return blases;
+}
@@ -11,6 +11,36 @@ namespace estun
     class Buffer;
     class Model;
     class DeviceMemory;
+    class AccelerationStructureCache;
+
+    struct BLASGeometry
+    {
+        VkDeviceAddress vertexAddress;
+        VkDeviceSize vertexStride;
+        VkDeviceAddress indexAddress;
+        VkIndexType indexType;
+        uint32_t vertexCount;
+        uint32_t indexCount;
+        uint32_t vertexOffset;
+        uint32_t indexOffset;
+        // Content hash for the acceleration structure cache, zero disables caching
+        uint64_t hash = 0;
+        // Host copies of the same streams for host builds, may be null
+        const void *hostVertexData = nullptr;
+        const void *hostIndexData = nullptr;
+        // Keeps scratch memory around so deformed vertices can be refit with Update
+        bool allowUpdate = false;
+        uint32_t hitGroup = 0;
+    };
+
+    // Axis aligned boxes resolved by the intersection shader of the given hit group
+    struct BLASProcedural
+    {
+        VkDeviceAddress aabbAddress;
+        uint32_t aabbCount;
+        uint32_t aabbOffset;
+        uint32_t hitGroup;
+    };
 
     class BLAS
     {
@@ -25,30 +55,49 @@ namespace estun
             std::shared_ptr<VertexBuffer> vertexBuffer, std::shared_ptr<IndexBuffer> indexBuffer,
             uint32_t vertexCount, uint32_t indexCount, 
             uint32_t vertexOffset, uint32_t indexOffset);
+        BLAS(const BLASGeometry &geometry, std::shared_ptr<AccelerationStructureCache> cache = nullptr);
+        BLAS(const BLASProcedural &procedural);
         ~BLAS();
 
         VkMemoryRequirements GetBufferMemoryRequirements(VkAccelerationStructureKHR accelerationStructure, VkAccelerationStructureMemoryRequirementsTypeKHR type);
 
         void Generate(std::shared_ptr<DeviceMemory> blasesMemory, uint32_t blasOffset);
 
+        // Records an in place refit from the current vertex data, the caller owns the barriers around it
+        void Update(VkCommandBuffer commandBuffer);
+        // Records a full build into the same structure, used when refits have degraded the tree
+        void Rebuild(VkCommandBuffer commandBuffer);
+
         uint32_t GetSize() { return objectSize_; };
         VkDeviceAddress GetDeviceAddress();
         uint32_t GetHitGroup() { return hitGroup_; };
+        // Instance custom index seen by the hit shaders, defaults to the position in the TLAS
+        void SetCustomIndex(uint32_t customIndex) { customIndex_ = customIndex; };
+        uint32_t GetCustomIndex() { return customIndex_; };
         glm::mat4* GetTransformMatrix() { return &transform_; };
         VkAccelerationStructureKHR GetStructure() { return accelerationStructure_; };
 
         static std::vector<std::shared_ptr<BLAS>> CreateBlases(std::vector<std::shared_ptr<Model>> models, std::shared_ptr<VertexBuffer> vertexBuffer, std::shared_ptr<IndexBuffer> indexBuffer);
+        static std::vector<std::shared_ptr<BLAS>> CreateBlases(const std::vector<BLASGeometry> &geometries, std::shared_ptr<AccelerationStructureCache> cache = nullptr);
 
     private:
+        void Create(const VkAccelerationStructureCreateGeometryTypeInfoKHR &geometryTypeInfo);
+        void Build();
+        void Record(VkCommandBuffer commandBuffer, bool update, VkDeviceAddress scratchAddress);
+
         std::shared_ptr<DeviceMemory> blasMemory_;
+        std::shared_ptr<Buffer> scratchBuffer_;
+        std::shared_ptr<DeviceMemory> scratchMemory_;
+        VkBuildAccelerationStructureFlagsKHR flags_ = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR;
 
         uint32_t buildScratchSize_;
         uint32_t objectSize_;
         uint32_t hitGroup_ = 0;
+        uint32_t customIndex_ = std::numeric_limits<uint32_t>::max();
         glm::mat4 transform_ = glm::mat4(1.0f);
         VkAccelerationStructureKHR accelerationStructure_;
 
-        std::vector<VkAccelerationStructureBuildOffsetInfoKHR *> buildOffsets_;
+        std::vector<VkAccelerationStructureBuildOffsetInfoKHR> buildOffsets_;
         std::vector<VkAccelerationStructureGeometryKHR> accelerationGeometries_;
     };
 
@@ -0,0 +1,277 @@
+#include "renderer/ray_tracing/host_blas_builder.h"
+#include "renderer/ray_tracing/acceleration_structure_cache.h"
+#include "renderer/context/device.h"
+#include "renderer/context/dynamic_functions.h"
+#include "renderer/device_memory.h"
+#include "core/thread_pool.h"
+#include "core/core.h"
+
+#include <chrono>
+
+namespace
+{
+    // Everything a deferred build reads has to stay at a fixed address until the operation completes
+    struct HostBuild
+    {
+        VkAccelerationStructureKHR accelerationStructure = VK_NULL_HANDLE;
+        std::unique_ptr<estun::DeviceMemory> memory;
+        std::vector<uint8_t> scratch;
+
+        VkAccelerationStructureGeometryKHR geometry = {};
+        const VkAccelerationStructureGeometryKHR *pGeometry = nullptr;
+        VkAccelerationStructureBuildOffsetInfoKHR buildOffset = {};
+        const VkAccelerationStructureBuildOffsetInfoKHR *pBuildOffset = nullptr;
+
+        VkDeferredOperationKHR operation = VK_NULL_HANDLE;
+        VkDeferredOperationInfoKHR deferredInfo = {};
+        VkAccelerationStructureBuildGeometryInfoKHR buildInfo = {};
+
+        uint64_t hash = 0;
+        VkResult result = VK_SUCCESS;
+        std::vector<uint8_t> serialized;
+    };
+
+    VkMemoryRequirements GetHostMemoryRequirements(VkAccelerationStructureKHR accelerationStructure, VkAccelerationStructureMemoryRequirementsTypeKHR type)
+    {
+        VkMemoryRequirements2 memoryRequirements2;
+        memoryRequirements2.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2;
+        memoryRequirements2.pNext = nullptr;
+
+        VkAccelerationStructureMemoryRequirementsInfoKHR accelerationMemoryRequirements;
+        accelerationMemoryRequirements.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_MEMORY_REQUIREMENTS_INFO_KHR;
+        accelerationMemoryRequirements.pNext = nullptr;
+        accelerationMemoryRequirements.type = type;
+        accelerationMemoryRequirements.buildType = VK_ACCELERATION_STRUCTURE_BUILD_TYPE_HOST_KHR;
+        accelerationMemoryRequirements.accelerationStructure = accelerationStructure;
+        estun::FunctionsLocator::GetFunctions().vkGetAccelerationStructureMemoryRequirementsKHR(estun::DeviceLocator::GetLogicalDevice(), &accelerationMemoryRequirements, &memoryRequirements2);
+
+        return memoryRequirements2.memoryRequirements;
+    }
+
+    void Start(HostBuild &build, const estun::BLASGeometry &blasGeometry)
+    {
+        const estun::DynamicFunctions &functions = estun::FunctionsLocator::GetFunctions();
+        VkDevice device = estun::DeviceLocator::GetLogicalDevice();
+
+        VkAccelerationStructureCreateGeometryTypeInfoKHR geometryTypeInfo = {};
+        geometryTypeInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_CREATE_GEOMETRY_TYPE_INFO_KHR;
+        geometryTypeInfo.pNext = nullptr;
+        geometryTypeInfo.geometryType = VK_GEOMETRY_TYPE_TRIANGLES_KHR;
+        geometryTypeInfo.maxPrimitiveCount = blasGeometry.indexCount / 3;
+        geometryTypeInfo.indexType = blasGeometry.indexType;
+        geometryTypeInfo.maxVertexCount = blasGeometry.vertexCount;
+        geometryTypeInfo.vertexFormat = VK_FORMAT_R32G32B32_SFLOAT;
+        geometryTypeInfo.allowsTransforms = VK_FALSE;
+
+        // Same create info as the device path, otherwise the serialized result would not fit the device structure
+        VkAccelerationStructureCreateInfoKHR structureCreateInfo = {};
+        structureCreateInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_CREATE_INFO_KHR;
+        structureCreateInfo.pNext = nullptr;
+        structureCreateInfo.compactedSize = 0;
+        structureCreateInfo.type = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR;
+        structureCreateInfo.flags = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR;
+        structureCreateInfo.maxGeometryCount = 1;
+        structureCreateInfo.pGeometryInfos = &geometryTypeInfo;
+        structureCreateInfo.deviceAddress = VK_NULL_HANDLE;
+
+        VK_CHECK_RESULT(functions.vkCreateAccelerationStructureKHR(device, &structureCreateInfo, nullptr, &build.accelerationStructure), "create host acceleration structure");
+
+        const VkMemoryRequirements objectRequirements = GetHostMemoryRequirements(build.accelerationStructure, VK_ACCELERATION_STRUCTURE_MEMORY_REQUIREMENTS_TYPE_OBJECT_KHR);
+        const VkMemoryRequirements scratchRequirements = GetHostMemoryRequirements(build.accelerationStructure, VK_ACCELERATION_STRUCTURE_MEMORY_REQUIREMENTS_TYPE_BUILD_SCRATCH_KHR);
+
+        build.memory.reset(new estun::DeviceMemory(objectRequirements.size, objectRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT));
+        build.scratch.resize(scratchRequirements.size);
+
+        VkBindAccelerationStructureMemoryInfoKHR bindMemoryInfo = {};
+        bindMemoryInfo.sType = VK_STRUCTURE_TYPE_BIND_ACCELERATION_STRUCTURE_MEMORY_INFO_KHR;
+        bindMemoryInfo.pNext = nullptr;
+        bindMemoryInfo.accelerationStructure = build.accelerationStructure;
+        bindMemoryInfo.memory = build.memory->GetMemory();
+        bindMemoryInfo.memoryOffset = 0;
+        bindMemoryInfo.deviceIndexCount = 0;
+        bindMemoryInfo.pDeviceIndices = nullptr;
+
+        VK_CHECK_RESULT(functions.vkBindAccelerationStructureMemoryKHR(device, 1, &bindMemoryInfo), "bind host acceleration structure");
+
+        build.geometry.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR;
+        build.geometry.pNext = nullptr;
+        build.geometry.geometryType = VK_GEOMETRY_TYPE_TRIANGLES_KHR;
+        build.geometry.geometry.triangles.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_TRIANGLES_DATA_KHR;
+        build.geometry.geometry.triangles.pNext = nullptr;
+        build.geometry.geometry.triangles.vertexFormat = VK_FORMAT_R32G32B32_SFLOAT;
+        build.geometry.geometry.triangles.vertexData.hostAddress = blasGeometry.hostVertexData;
+        build.geometry.geometry.triangles.vertexStride = blasGeometry.vertexStride;
+        build.geometry.geometry.triangles.indexType = blasGeometry.indexType;
+        build.geometry.geometry.triangles.indexData.hostAddress = blasGeometry.hostIndexData;
+        build.geometry.geometry.triangles.transformData.hostAddress = nullptr;
+        build.geometry.flags = VK_GEOMETRY_OPAQUE_BIT_KHR;
+        build.pGeometry = &build.geometry;
+
+        build.buildOffset.primitiveCount = blasGeometry.indexCount / 3;
+        build.buildOffset.primitiveOffset = blasGeometry.indexOffset;
+        build.buildOffset.firstVertex = blasGeometry.vertexOffset;
+        build.buildOffset.transformOffset = 0;
+        build.pBuildOffset = &build.buildOffset;
+
+        VK_CHECK_RESULT(functions.vkCreateDeferredOperationKHR(device, nullptr, &build.operation), "create deferred operation");
+
+        build.deferredInfo.sType = VK_STRUCTURE_TYPE_DEFERRED_OPERATION_INFO_KHR;
+        build.deferredInfo.pNext = nullptr;
+        build.deferredInfo.operationHandle = build.operation;
+
+        build.buildInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR;
+        build.buildInfo.pNext = &build.deferredInfo;
+        build.buildInfo.type = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR;
+        build.buildInfo.flags = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR;
+        build.buildInfo.update = VK_FALSE;
+        build.buildInfo.srcAccelerationStructure = VK_NULL_HANDLE;
+        build.buildInfo.dstAccelerationStructure = build.accelerationStructure;
+        build.buildInfo.geometryArrayOfPointers = VK_FALSE;
+        build.buildInfo.geometryCount = 1;
+        build.buildInfo.ppGeometries = &build.pGeometry;
+        build.buildInfo.scratchData.hostAddress = build.scratch.data();
+
+        build.result = functions.vkBuildAccelerationStructureKHR(device, 1, &build.buildInfo, &build.pBuildOffset);
+    }
+
+    std::vector<uint8_t> Serialize(VkAccelerationStructureKHR accelerationStructure)
+    {
+        const estun::DynamicFunctions &functions = estun::FunctionsLocator::GetFunctions();
+        VkDevice device = estun::DeviceLocator::GetLogicalDevice();
+
+        uint64_t size = 0;
+        if (functions.vkWriteAccelerationStructuresPropertiesKHR(device, 1, &accelerationStructure, VK_QUERY_TYPE_ACCELERATION_STRUCTURE_SERIALIZATION_SIZE_KHR, sizeof(size), &size, sizeof(size)) != VK_SUCCESS)
+        {
+            return std::vector<uint8_t>();
+        }
+
+        std::vector<uint8_t> data(size);
+
+        VkCopyAccelerationStructureToMemoryInfoKHR copyInfo = {};
+        copyInfo.sType = VK_STRUCTURE_TYPE_COPY_ACCELERATION_STRUCTURE_TO_MEMORY_INFO_KHR;
+        copyInfo.pNext = nullptr;
+        copyInfo.src = accelerationStructure;
+        copyInfo.dst.hostAddress = data.data();
+        copyInfo.mode = VK_COPY_ACCELERATION_STRUCTURE_MODE_SERIALIZE_KHR;
+
+        if (functions.vkCopyAccelerationStructureToMemoryKHR(device, &copyInfo) != VK_SUCCESS)
+        {
+            return std::vector<uint8_t>();
+        }
+
+        return data;
+    }
+} // namespace
+
+estun::HostBLASBuilder::HostBLASBuilder(std::shared_ptr<ThreadPool> pool)
+    : pool_(pool)
+{
+}
+
+estun::HostBLASBuilder::~HostBLASBuilder()
+{
+}
+
+bool estun::HostBLASBuilder::IsSupported()
+{
+    return DeviceLocator::GetDevice().SupportsHostAccelerationStructureCommands();
+}
+
+void estun::HostBLASBuilder::Join(VkDeferredOperationKHR operation)
+{
+    const DynamicFunctions &functions = FunctionsLocator::GetFunctions();
+    VkDevice device = DeviceLocator::GetLogicalDevice();
+
+    // Idle means no work is left for this thread right now but the operation is not finished yet
+    VkResult result = functions.vkDeferredOperationJoinKHR(device, operation);
+    while (result == VK_THREAD_IDLE_KHR)
+    {
+        std::this_thread::yield();
+        result = functions.vkDeferredOperationJoinKHR(device, operation);
+    }
+}
+
+uint32_t estun::HostBLASBuilder::Build(const std::vector<BLASGeometry> &geometries, std::shared_ptr<AccelerationStructureCache> cache)
+{
+    const DynamicFunctions &functions = FunctionsLocator::GetFunctions();
+    VkDevice device = DeviceLocator::GetLogicalDevice();
+
+    const auto start = std::chrono::high_resolution_clock::now();
+
+    std::vector<std::unique_ptr<HostBuild>> builds;
+    std::vector<std::future<void>> joins;
+
+    // Every operation is started from this thread and joined by the pool, so pool threads never wait on each other
+    for (const auto &geometry : geometries)
+    {
+        if (geometry.hash == 0 || geometry.hostVertexData == nullptr || geometry.hostIndexData == nullptr || cache->Contains(geometry.hash))
+        {
+            continue;
+        }
+
+        builds.emplace_back(new HostBuild());
+        HostBuild &build = *builds.back();
+        build.hash = geometry.hash;
+
+        Start(build, geometry);
+        if (build.result != VK_OPERATION_DEFERRED_KHR)
+        {
+            continue;
+        }
+
+        const uint32_t concurrency = std::min(std::max(functions.vkGetDeferredOperationMaxConcurrencyKHR(device, build.operation), 1u), pool_->GetThreadCount());
+        for (uint32_t i = 0; i < concurrency; i++)
+        {
+            VkDeferredOperationKHR operation = build.operation;
+            joins.push_back(pool_->Submit([this, operation]() { Join(operation); }));
+        }
+    }
+
+    for (auto &join : joins)
+    {
+        join.wait();
+    }
+
+    std::vector<std::future<void>> serializations;
+    for (auto &build : builds)
+    {
+        if (build->result == VK_OPERATION_DEFERRED_KHR)
+        {
+            build->result = functions.vkGetDeferredOperationResultKHR(device, build->operation);
+        }
+        if (build->result != VK_SUCCESS && build->result != VK_OPERATION_NOT_DEFERRED_KHR)
+        {
+            continue;
+        }
+
+        HostBuild *target = build.get();
+        serializations.push_back(pool_->Submit([target]() { target->serialized = Serialize(target->accelerationStructure); }));
+    }
+
+    for (auto &serialization : serializations)
+    {
+        serialization.wait();
+    }
+
+    uint32_t built = 0;
+    for (auto &build : builds)
+    {
+        if (!build->serialized.empty())
+        {
+            cache->Store(build->hash, std::move(build->serialized));
+            built++;
+        }
+        else
+        {
+            ES_CORE_WARN("Host acceleration structure build failed, falling back to a device build");
+        }
+
+        functions.vkDestroyDeferredOperationKHR(device, build->operation, nullptr);
+        functions.vkDestroyAccelerationStructureKHR(device, build->accelerationStructure, nullptr);
+    }
+
+    const auto elapsed = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    ES_CORE_INFO("Built {0} BLASes on the host with {1} threads in {2} ms", built, pool_->GetThreadCount(), elapsed);
+
+    return built;
+}
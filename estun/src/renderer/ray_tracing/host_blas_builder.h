@@ -0,0 +1,36 @@
+#pragma once
+
+#include "renderer/common.h"
+#include "renderer/ray_tracing/bottom_level_acceleration_structure.h"
+
+namespace estun
+{
+
+    class ThreadPool;
+    class AccelerationStructureCache;
+
+    // Builds bottom level structures on the CPU with deferred operations spread over a thread pool.
+    // Results go to the cache in serialized form, so BLAS creation afterwards only deserializes them.
+    class HostBLASBuilder
+    {
+    public:
+        HostBLASBuilder(const HostBLASBuilder &) = delete;
+        HostBLASBuilder(HostBLASBuilder &&) = delete;
+        HostBLASBuilder &operator=(const HostBLASBuilder &) = delete;
+        HostBLASBuilder &operator=(HostBLASBuilder &&) = delete;
+
+        HostBLASBuilder(std::shared_ptr<ThreadPool> pool);
+        ~HostBLASBuilder();
+
+        static bool IsSupported();
+
+        // Skips geometries without host data or hash and the ones already cached, returns the number built
+        uint32_t Build(const std::vector<BLASGeometry> &geometries, std::shared_ptr<AccelerationStructureCache> cache);
+
+    private:
+        void Join(VkDeferredOperationKHR operation);
+
+        std::shared_ptr<ThreadPool> pool_;
+    };
+
+} // namespace estun
@@ -0,0 +1,78 @@
+#include "renderer/ray_tracing/pipeline_permutations.h"
+#include "renderer/ray_tracing/ray_tracing_pipeline.h"
+#include "renderer/ray_tracing/shader_binding_table.h"
+#include "renderer/ray_tracing_render.h"
+#include "core/core.h"
+
+estun::PipelinePermutations::PipelinePermutations(
+    std::shared_ptr<RayTracingRender> render,
+    const std::vector<std::vector<Shader>> shaderGroups,
+    const std::shared_ptr<Descriptor> descriptor)
+    : render_(render), shaderGroups_(shaderGroups), descriptor_(descriptor)
+{
+}
+
+estun::PipelinePermutations::~PipelinePermutations()
+{
+    permutations_.clear();
+}
+
+void estun::PipelinePermutations::Add(const std::string &preset, const SpecializationConstants &constants)
+{
+    for (const auto &permutation : permutations_)
+    {
+        if (permutation.second.constants.GetValues() == constants.GetValues())
+        {
+            ES_CORE_INFO(std::string("Preset ") + preset + " reuses pipeline of " + permutation.first);
+            permutations_[preset] = permutation.second;
+            if (current_.empty())
+            {
+                current_ = preset;
+            }
+            return;
+        }
+    }
+
+    Permutation permutation;
+    permutation.constants = constants;
+    permutation.pipeline = render_->CreatePipeline(shaderGroups_, descriptor_, constants);
+    permutation.shaderBindingTable = std::make_shared<ShaderBindingTable>(permutation.pipeline);
+    permutations_[preset] = permutation;
+
+    if (current_.empty())
+    {
+        current_ = preset;
+    }
+}
+
+bool estun::PipelinePermutations::Select(const std::string &preset)
+{
+    if (preset == current_)
+    {
+        return false;
+    }
+
+    if (permutations_.find(preset) == permutations_.end())
+    {
+        ES_CORE_ASSERT(std::string("Unknown pipeline preset ") + preset);
+        return false;
+    }
+
+    current_ = preset;
+    return true;
+}
+
+const estun::SpecializationConstants &estun::PipelinePermutations::GetConstants() const
+{
+    return permutations_.at(current_).constants;
+}
+
+std::shared_ptr<estun::RayTracingPipeline> estun::PipelinePermutations::GetPipeline() const
+{
+    return permutations_.at(current_).pipeline;
+}
+
+std::shared_ptr<estun::ShaderBindingTable> estun::PipelinePermutations::GetShaderBindingTable() const
+{
+    return permutations_.at(current_).shaderBindingTable;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "renderer/common.h"
+#include "renderer/material/shader.h"
+#include "renderer/material/specialization_constants.h"
+
+namespace estun
+{
+
+    class RayTracingRender;
+    class RayTracingPipeline;
+    class ShaderBindingTable;
+    class Descriptor;
+
+    class PipelinePermutations
+    {
+    public:
+        PipelinePermutations(const PipelinePermutations &) = delete;
+        PipelinePermutations(PipelinePermutations &&) = delete;
+        PipelinePermutations &operator=(const PipelinePermutations &) = delete;
+        PipelinePermutations &operator=(PipelinePermutations &&) = delete;
+
+        PipelinePermutations(
+            std::shared_ptr<RayTracingRender> render,
+            const std::vector<std::vector<Shader>> shaderGroups,
+            const std::shared_ptr<Descriptor> descriptor);
+        ~PipelinePermutations();
+
+        void Add(const std::string &preset, const SpecializationConstants &constants);
+        bool Select(const std::string &preset);
+
+        const std::string &GetCurrentPreset() const { return current_; }
+        const SpecializationConstants &GetConstants() const;
+        std::shared_ptr<RayTracingPipeline> GetPipeline() const;
+        std::shared_ptr<ShaderBindingTable> GetShaderBindingTable() const;
+
+    private:
+        struct Permutation
+        {
+            SpecializationConstants constants;
+            std::shared_ptr<RayTracingPipeline> pipeline;
+            std::shared_ptr<ShaderBindingTable> shaderBindingTable;
+        };
+
+        std::shared_ptr<RayTracingRender> render_;
+        std::vector<std::vector<Shader>> shaderGroups_;
+        std::shared_ptr<Descriptor> descriptor_;
+
+        std::map<std::string, Permutation> permutations_;
+        std::string current_;
+    };
+
+} // namespace estun
@@ -11,7 +11,8 @@
 
 estun::RayTracingPipeline::RayTracingPipeline(
     const std::vector<std::vector<Shader>> shaderGroups,
-    const std::shared_ptr<Descriptor> descriptor)
+    const std::shared_ptr<Descriptor> descriptor,
+    const SpecializationConstants &constants)
 {
     // Load shaders.
 
@@ -19,6 +20,7 @@ estun::RayTracingPipeline::RayTracingPipeline(
     std::vector<std::shared_ptr<ShaderModule>> shaderModules;
 
     std::vector<VkRayTracingShaderGroupCreateInfoKHR> groups;
+    const VkSpecializationInfo *specializationInfo = constants.GetInfo();
     int groupIndex = 0;
     int index = 0;
     for (auto &group : shaderGroups)
@@ -36,7 +38,7 @@ estun::RayTracingPipeline::RayTracingPipeline(
         for (auto &shader : group)
         {
             shaderModules.push_back(std::make_shared<ShaderModule>(shader.name));
-            shaderStages.push_back(shaderModules.back()->CreateShaderStage(shader.bits));
+            shaderStages.push_back(shaderModules.back()->CreateShaderStage(shader.bits, specializationInfo));
             switch (shader.bits)
             {
             case VK_SHADER_STAGE_INTERSECTION_BIT_KHR:
@@ -3,6 +3,7 @@
 #include "renderer/common.h"
 #include "renderer/context/utils.h"
 #include "renderer/material/shader.h"
+#include "renderer/material/specialization_constants.h"
 
 namespace estun
 {
@@ -31,12 +32,19 @@ namespace estun
 
         RayTracingPipeline(
             const std::vector<std::vector<Shader>> shaderGroups,
-            const std::shared_ptr<Descriptor> descriptor);
+            const std::shared_ptr<Descriptor> descriptor,
+            const SpecializationConstants &constants = SpecializationConstants());
         ~RayTracingPipeline();
 
         void Bind(VkCommandBuffer &commandBuffer);
         
-        uint32_t GetGroupCount() const { return !rayGenGroups.empty() + !missGroups.empty() + !hitGroups.empty() + !callGroups.empty(); }
+        uint32_t GetGroupCount() const { return static_cast<uint32_t>(rayGenGroups.size() + missGroups.size() + hitGroups.size() + callGroups.size()); }
+
+        // Group indices of each kind in creation order, hit group i is selected by an instance SBT offset of i
+        const std::vector<uint32_t> &GetRayGenGroups() const { return rayGenGroups; }
+        const std::vector<uint32_t> &GetMissGroups() const { return missGroups; }
+        const std::vector<uint32_t> &GetHitGroups() const { return hitGroups; }
+        const std::vector<uint32_t> &GetCallableGroups() const { return callGroups; }
 
         VkDescriptorSet DescriptorSet(uint32_t index) const;
 
@@ -0,0 +1,141 @@
+#include "renderer/ray_tracing/scatter_set.h"
+#include "renderer/ray_tracing/top_level_acceleration_structure.h"
+#include "renderer/context.h"
+#include "renderer/context/pipeline_barrier.h"
+#include "renderer/material/descriptor_binding.h"
+#include "core/core.h"
+
+namespace
+{
+    const uint32_t groupSize = 64;
+}
+
+estun::ScatterSet::ScatterSet(const std::vector<ScatterPrototype> &prototypes, std::vector<ScatterRegion> regions, const std::string &shaderName)
+    : shaderName_(shaderName)
+{
+    if (prototypes.empty() || regions.empty())
+    {
+        ES_CORE_ASSERT("Scatter set needs at least one prototype and one region");
+        return;
+    }
+
+    std::vector<ScatterPrototypeData> prototypeData;
+    for (const auto &prototype : prototypes)
+    {
+        if (prototype.lods.empty() || prototype.lods.size() > ScatterPrototypeData::MaxLods || prototype.lods.size() != prototype.lodDistances.size())
+        {
+            ES_CORE_ASSERT("Scatter prototype needs one to four LODs with a distance each");
+            return;
+        }
+
+        ScatterPrototypeData data = {};
+        data.lodCount = static_cast<uint32_t>(prototype.lods.size());
+        // The hit shaders of every LOD are the same, only the mesh differs
+        data.hitGroup = prototype.lods[0]->GetHitGroup();
+        data.mask = prototype.mask;
+        for (uint32_t lod = 0; lod < data.lodCount; lod++)
+        {
+            const uint32_t customIndex = prototype.lods[lod]->GetCustomIndex();
+            data.lodReferences[lod] = prototype.lods[lod]->GetDeviceAddress();
+            data.lodCustomIndices[lod] = customIndex != std::numeric_limits<uint32_t>::max() ? customIndex : 0;
+            data.lodDistances[lod] = prototype.lodDistances[lod];
+        }
+        prototypeData.push_back(data);
+
+        blases_.insert(blases_.end(), prototype.lods.begin(), prototype.lods.end());
+    }
+
+    uint32_t instanceCount = 0;
+    for (auto &region : regions)
+    {
+        if (region.prototype >= prototypes.size())
+        {
+            ES_CORE_ASSERT("Scatter region refers to a missing prototype");
+            return;
+        }
+        region.firstInstance = instanceCount;
+        instanceCount += region.instanceCount;
+    }
+
+    ubo_ = {};
+    ubo_.instanceCount = instanceCount;
+    ubo_.regionCount = static_cast<uint32_t>(regions.size());
+
+    regionBuffer_ = std::make_shared<StorageBuffer<ScatterRegion>>(regions);
+    prototypeBuffer_ = std::make_shared<StorageBuffer<ScatterPrototypeData>>(prototypeData);
+
+    const size_t imageCount = ContextLocator::GetSwapChain()->GetImageViews().size();
+    uniformBuffers_ = std::vector<UniformBuffer<ScatterUBO>>(imageCount);
+}
+
+estun::ScatterSet::~ScatterSet()
+{
+    pipeline_.reset();
+    descriptor_.reset();
+    uniformBuffers_.clear();
+    regionBuffer_.reset();
+    prototypeBuffer_.reset();
+    blases_.clear();
+}
+
+void estun::ScatterSet::SetTarget(std::shared_ptr<TLAS> tlas, uint32_t firstInstance)
+{
+    if (tlas->GetDeviceInstanceBuffer() == nullptr || firstInstance < tlas->GetInstanceCount() ||
+        firstInstance + ubo_.instanceCount > tlas->GetInstanceCount() + tlas->GetDeviceInstanceCount())
+    {
+        ES_CORE_ASSERT("TLAS has no room for the scattered instances");
+        return;
+    }
+
+    ubo_.firstInstance = firstInstance;
+    for (auto &uniformBuffer : uniformBuffers_)
+    {
+        uniformBuffer.SetValue(ubo_);
+    }
+
+    std::vector<DescriptorBinding> bindings = {
+        DescriptorBinding::Storage(0, tlas->GetDeviceInstanceBuffer(), VK_SHADER_STAGE_COMPUTE_BIT),
+        DescriptorBinding::Storage(1, regionBuffer_, VK_SHADER_STAGE_COMPUTE_BIT),
+        DescriptorBinding::Storage(2, prototypeBuffer_, VK_SHADER_STAGE_COMPUTE_BIT),
+        DescriptorBinding::Uniform(3, uniformBuffers_, VK_SHADER_STAGE_COMPUTE_BIT)};
+
+    if (descriptor_ == nullptr)
+    {
+        descriptor_ = std::make_shared<Descriptor>(bindings, uniformBuffers_.size());
+        pipeline_ = std::make_shared<ComputePipeline>(shaderName_, descriptor_);
+    }
+    else
+    {
+        descriptor_->Update(bindings);
+    }
+}
+
+void estun::ScatterSet::SetCamera(const glm::vec3 &position, uint32_t imageIndex)
+{
+    ubo_.cameraPosition = glm::vec4(position, 1.0f);
+    uniformBuffers_[imageIndex].SetValue(ubo_);
+}
+
+void estun::ScatterSet::Record(VkCommandBuffer commandBuffer)
+{
+    if (pipeline_ == nullptr)
+    {
+        ES_CORE_ASSERT("Scatter set has no target TLAS");
+        return;
+    }
+
+    // The previous build may still read the instances about to be overwritten
+    PipelineBarrier::Insert(
+        commandBuffer,
+        VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR | VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+        VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+
+    pipeline_->Bind(commandBuffer);
+    descriptor_->Bind(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE);
+    vkCmdDispatch(commandBuffer, (ubo_.instanceCount + groupSize - 1) / groupSize, 1, 1);
+
+    PipelineBarrier::Insert(
+        commandBuffer,
+        VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR | VK_ACCESS_SHADER_READ_BIT,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR);
+}
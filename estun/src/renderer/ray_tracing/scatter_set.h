@@ -0,0 +1,98 @@
+#pragma once
+
+#include "renderer/common.h"
+#include "renderer/buffers/storage_buffer.h"
+#include "renderer/buffers/uniform_buffer.h"
+#include "renderer/material/compute_pipeline.h"
+#include "renderer/material/descriptor.h"
+#include "renderer/ray_tracing/bottom_level_acceleration_structure.h"
+
+namespace estun
+{
+
+    class TLAS;
+
+    // Matches Region in scatter.comp. Instances are spread over a disc on the xz plane with a
+    // random yaw and uniform scale, all derived on the device from the seed and instance index.
+    struct ScatterRegion
+    {
+        glm::vec4 centerRadius;
+        glm::vec2 scaleRange;
+        uint32_t seed;
+        uint32_t prototype;
+        uint32_t instanceCount;
+        // Filled by ScatterSet
+        uint32_t firstInstance;
+        uint32_t pad[2];
+    };
+
+    struct ScatterPrototype
+    {
+        // One BLAS per LOD, each traced up to its distance from the camera and culled past the last one
+        std::vector<std::shared_ptr<BLAS>> lods;
+        std::vector<float> lodDistances;
+        uint32_t mask = 0xFF;
+    };
+
+    // Matches Prototype in scatter.comp
+    struct ScatterPrototypeData
+    {
+        static const uint32_t MaxLods = 4;
+
+        VkDeviceAddress lodReferences[MaxLods];
+        glm::uvec4 lodCustomIndices;
+        glm::vec4 lodDistances;
+        uint32_t lodCount;
+        uint32_t hitGroup;
+        uint32_t mask;
+        uint32_t pad;
+    };
+
+    // Matches ScatterUniforms in scatter.comp
+    struct ScatterUBO
+    {
+        glm::vec4 cameraPosition;
+        uint32_t firstInstance;
+        uint32_t instanceCount;
+        uint32_t regionCount;
+        uint32_t pad;
+    };
+
+    // Expands a few scatter regions into TLAS instances with a compute shader writing straight into
+    // the device instance array of a TLAS, so per instance data never exists on the host.
+    class ScatterSet
+    {
+    public:
+        ScatterSet(const ScatterSet &) = delete;
+        ScatterSet(ScatterSet &&) = delete;
+
+        ScatterSet &operator=(const ScatterSet &) = delete;
+        ScatterSet &operator=(ScatterSet &&) = delete;
+
+        ScatterSet(const std::vector<ScatterPrototype> &prototypes, std::vector<ScatterRegion> regions, const std::string &shaderName);
+        ~ScatterSet();
+
+        // Writes the device instances of the TLAS starting at firstInstance, called again for every new TLAS
+        void SetTarget(std::shared_ptr<TLAS> tlas, uint32_t firstInstance);
+        // Camera the LODs of the image's expansion are chosen for
+        void SetCamera(const glm::vec3 &position, uint32_t imageIndex);
+
+        // Records the expansion for the image being recorded, the TLAS build has to follow
+        void Record(VkCommandBuffer commandBuffer);
+
+        uint32_t GetInstanceCount() const { return ubo_.instanceCount; }
+
+    private:
+        std::vector<std::shared_ptr<BLAS>> blases_;
+        std::string shaderName_;
+        ScatterUBO ubo_;
+
+        std::shared_ptr<StorageBuffer<ScatterRegion>> regionBuffer_;
+        std::shared_ptr<StorageBuffer<ScatterPrototypeData>> prototypeBuffer_;
+        std::vector<UniformBuffer<ScatterUBO>> uniformBuffers_;
+
+        std::shared_ptr<Descriptor> descriptor_;
+        std::shared_ptr<ComputePipeline> pipeline_;
+    };
+
+} // namespace estun
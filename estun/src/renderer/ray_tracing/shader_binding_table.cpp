@@ -10,28 +10,44 @@
 estun::ShaderBindingTable::ShaderBindingTable(
     const std::shared_ptr<RayTracingPipeline> rayTracingPipeline)
 {
+    const size_t groupHandleSize = estun::RayTracingPropertiesLocator::GetProperties().ShaderGroupHandleSize();
+    const size_t groupHandlealignment = estun::RayTracingPropertiesLocator::GetProperties().ShaderGroupBaseAlignment();
+    const uint32_t shaderBindingTableGroupCount = rayTracingPipeline->GetGroupCount();
 
-    uint32_t groupHandleSize = estun::RayTracingPropertiesLocator::GetProperties().ShaderGroupHandleSize();
-    uint32_t groupHandlealignment = estun::RayTracingPropertiesLocator::GetProperties().ShaderGroupBaseAlignment();
-    uint32_t shaderBindingTableGroupCount = rayTracingPipeline->GetGroupCount();
-    sbtSize_ = static_cast<size_t>(shaderBindingTableGroupCount) * groupHandlealignment;
+    // Each group kind gets a region starting on the base alignment, entries inside a region are packed by handle size
+    const auto regionSize = [groupHandleSize, groupHandlealignment](const std::vector<uint32_t> &groups) {
+        return (groups.size() * groupHandleSize + groupHandlealignment - 1) / groupHandlealignment * groupHandlealignment;
+    };
+
+    rayGenOffset_ = 0;
+    missOffset_ = rayGenOffset_ + regionSize(rayTracingPipeline->GetRayGenGroups());
+    hitGroupOffset_ = missOffset_ + regionSize(rayTracingPipeline->GetMissGroups());
+    callOffset_ = hitGroupOffset_ + regionSize(rayTracingPipeline->GetHitGroups());
+    sbtSize_ = callOffset_ + regionSize(rayTracingPipeline->GetCallableGroups());
 
     buffer_.reset(new estun::Buffer(sbtSize_, VK_BUFFER_USAGE_TRANSFER_SRC_BIT));
     bufferMemory_.reset(new estun::DeviceMemory(buffer_->AllocateMemory(VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)));
 
-    auto *dstData = static_cast<uint8_t *>(bufferMemory_->Map(0, sbtSize_));
-
-    std::vector<uint8_t> shaderHandleStorage(sbtSize_);
+    std::vector<uint8_t> shaderHandleStorage(shaderBindingTableGroupCount * groupHandleSize);
     estun::FunctionsLocator::GetFunctions().vkGetRayTracingShaderGroupHandlesKHR(
         estun::DeviceLocator::GetLogicalDevice(), rayTracingPipeline->GetPipeline(),
         0, shaderBindingTableGroupCount,
-        sbtSize_, shaderHandleStorage.data());
+        shaderHandleStorage.size(), shaderHandleStorage.data());
+
+    auto *data = static_cast<uint8_t *>(bufferMemory_->Map(0, sbtSize_));
 
-    for (uint32_t i = 0; i < shaderBindingTableGroupCount; i++)
-    {
-        memcpy(dstData, shaderHandleStorage.data() + static_cast<size_t>(i) * groupHandleSize, groupHandleSize);
-        dstData += groupHandlealignment;
-    }
+    const auto copyRegion = [&shaderHandleStorage, groupHandleSize](uint8_t *dstData, const std::vector<uint32_t> &groups) {
+        for (const uint32_t group : groups)
+        {
+            memcpy(dstData, shaderHandleStorage.data() + group * groupHandleSize, groupHandleSize);
+            dstData += groupHandleSize;
+        }
+    };
+
+    copyRegion(data + rayGenOffset_, rayTracingPipeline->GetRayGenGroups());
+    copyRegion(data + missOffset_, rayTracingPipeline->GetMissGroups());
+    copyRegion(data + hitGroupOffset_, rayTracingPipeline->GetHitGroups());
+    copyRegion(data + callOffset_, rayTracingPipeline->GetCallableGroups());
 
     bufferMemory_->Unmap();
 
@@ -39,11 +55,6 @@ estun::ShaderBindingTable::ShaderBindingTable(
     missEntrySize_ = groupHandleSize;
     hitGroupEntrySize_ = groupHandleSize;
     callEntrySize_ = groupHandleSize;
-
-    rayGenOffset_ = 0;
-    missOffset_ = groupHandlealignment;
-    hitGroupOffset_ = static_cast<size_t>(groupHandlealignment) * 2;
-    callOffset_ = static_cast<size_t>(groupHandlealignment) * 3;
 }
 
 estun::ShaderBindingTable::~ShaderBindingTable()
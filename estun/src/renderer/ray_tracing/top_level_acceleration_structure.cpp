@@ -2,6 +2,8 @@
 #include "renderer/ray_tracing/bottom_level_acceleration_structure.h"
 #include "renderer/buffers/buffer.h"
 #include "renderer/buffers/storage_buffer.h"
+#include "renderer/context.h"
+#include "renderer/context/pipeline_barrier.h"
 #include "renderer/context/device.h"
 #include "renderer/context/dynamic_functions.h"
 #include "renderer/context/single_time_commands.h"
@@ -23,15 +25,21 @@ VkMemoryRequirements estun::TLAS::GetBufferMemoryRequirements(VkAccelerationStru
     return memoryRequirements2.memoryRequirements;
 }
 
-estun::TLAS::TLAS(std::vector<std::shared_ptr<estun::BLAS>> blases)
+estun::TLAS::TLAS(std::vector<std::shared_ptr<estun::BLAS>> blases, bool allowUpdate, uint32_t deviceInstanceCount)
+    : deviceInstanceCount_(deviceInstanceCount)
 {
     ES_CORE_INFO("creating TLAS ...");
 
+    if (allowUpdate)
+    {
+        flags_ |= VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_UPDATE_BIT_KHR;
+    }
+
     VkAccelerationStructureCreateGeometryTypeInfoKHR geometryTypeInfo = {};
     geometryTypeInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_CREATE_GEOMETRY_TYPE_INFO_KHR;
     geometryTypeInfo.pNext = nullptr;
     geometryTypeInfo.geometryType = VK_GEOMETRY_TYPE_INSTANCES_KHR;
-    geometryTypeInfo.maxPrimitiveCount = blases.size();
+    geometryTypeInfo.maxPrimitiveCount = blases.size() + deviceInstanceCount_;
     geometryTypeInfo.indexType = VK_INDEX_TYPE_NONE_KHR;
     geometryTypeInfo.maxVertexCount = 0;
     geometryTypeInfo.vertexFormat = VK_FORMAT_UNDEFINED;
@@ -42,7 +50,7 @@ estun::TLAS::TLAS(std::vector<std::shared_ptr<estun::BLAS>> blases)
     structureCreateInfo.pNext = nullptr;
     structureCreateInfo.compactedSize = 0;
     structureCreateInfo.type = VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR;
-    structureCreateInfo.flags = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR;
+    structureCreateInfo.flags = flags_;
     structureCreateInfo.maxGeometryCount = 1;
     structureCreateInfo.pGeometryInfos = &geometryTypeInfo;
     structureCreateInfo.deviceAddress = 0;
@@ -52,10 +60,15 @@ estun::TLAS::TLAS(std::vector<std::shared_ptr<estun::BLAS>> blases)
    
     auto tlasMemoryRequirements = GetBufferMemoryRequirements(accelerationStructure_, VK_ACCELERATION_STRUCTURE_MEMORY_REQUIREMENTS_TYPE_OBJECT_KHR);
     buildScratchSize_ = GetBufferMemoryRequirements(accelerationStructure_, VK_ACCELERATION_STRUCTURE_MEMORY_REQUIREMENTS_TYPE_BUILD_SCRATCH_KHR).size;
+    if (allowUpdate)
+    {
+        const uint32_t updateScratchSize = GetBufferMemoryRequirements(accelerationStructure_, VK_ACCELERATION_STRUCTURE_MEMORY_REQUIREMENTS_TYPE_UPDATE_SCRATCH_KHR).size;
+        buildScratchSize_ = std::max(buildScratchSize_, updateScratchSize);
+    }
     objectSize_ = tlasMemoryRequirements.size;
 
-    std::shared_ptr<Buffer> scratchBuffer = std::make_shared<Buffer>(buildScratchSize_, VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT);
-    std::shared_ptr<DeviceMemory> scratchMemory = std::make_shared<DeviceMemory>(scratchBuffer->AllocateMemory(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, true));
+    scratchBuffer_ = std::make_shared<Buffer>(buildScratchSize_, VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT);
+    scratchMemory_ = std::make_shared<DeviceMemory>(scratchBuffer_->AllocateMemory(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, true));
 
     VkAccelerationStructureDeviceAddressInfoKHR devAddrInfo = {};
     devAddrInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_DEVICE_ADDRESS_INFO_KHR;
@@ -68,8 +81,8 @@ estun::TLAS::TLAS(std::vector<std::shared_ptr<estun::BLAS>> blases)
     for (auto &blas : blases)
     {
         VkAccelerationStructureInstanceKHR geometryInstance = {};
-        std::memcpy(&geometryInstance.transform, blas->GetTransformMatrix(), sizeof(glm::mat4)); //sizeof() бы приделать
-        geometryInstance.instanceCustomIndex = instanceId;
+        geometryInstance.transform = ToTransformMatrix(*blas->GetTransformMatrix());
+        geometryInstance.instanceCustomIndex = blas->GetCustomIndex() != std::numeric_limits<uint32_t>::max() ? blas->GetCustomIndex() : instanceId;
         geometryInstance.mask = 0xFF;
         geometryInstance.instanceShaderBindingTableRecordOffset = blas->GetHitGroup();
         geometryInstance.flags = VK_GEOMETRY_INSTANCE_TRIANGLE_FACING_CULL_DISABLE_BIT_KHR; // Disable culling - more fine control could be provided by the application
@@ -78,13 +91,20 @@ estun::TLAS::TLAS(std::vector<std::shared_ptr<estun::BLAS>> blases)
         instanceId++;
     }
 
+    // Refits of different images may be in flight while the host moves instances for the next one
+    instanceCount_ = static_cast<uint32_t>(geometryInstances.size());
+    instanceSetCount_ = allowUpdate || deviceInstanceCount_ > 0 ? static_cast<uint32_t>(ContextLocator::GetSwapChain()->GetImageViews().size()) : 1;
+
+    // Buffers can not be empty when every instance is written on the device
     uint32_t instancesSize = geometryInstances.size() * sizeof(VkAccelerationStructureInstanceKHR);
-    std::shared_ptr<Buffer> instancesBuffer = std::make_shared<Buffer>(instancesSize, VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT);
-    std::shared_ptr<DeviceMemory> instancesMemory = std::make_shared<DeviceMemory>(instancesBuffer->AllocateMemory(VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, true));
+    instancesBuffer_ = std::make_shared<Buffer>(std::max<size_t>(instancesSize * instanceSetCount_, sizeof(VkAccelerationStructureInstanceKHR)), VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
+    instancesMemory_ = std::make_shared<DeviceMemory>(instancesBuffer_->AllocateMemory(VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, true));
 
-    const auto data = instancesMemory->Map(0, instancesSize);
-    std::memcpy(data, geometryInstances.data(), instancesSize);
-    instancesMemory->Unmap();
+    instances_ = static_cast<VkAccelerationStructureInstanceKHR *>(instancesMemory_->Map(0, std::max<size_t>(instancesSize * instanceSetCount_, sizeof(VkAccelerationStructureInstanceKHR))));
+    for (uint32_t i = 0; i < instanceSetCount_; i++)
+    {
+        std::memcpy(instances_ + i * instanceCount_, geometryInstances.data(), instancesSize);
+    }
 
     VkAccelerationStructureGeometryKHR geometry = {};
     geometry.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR;
@@ -95,16 +115,16 @@ estun::TLAS::TLAS(std::vector<std::shared_ptr<estun::BLAS>> blases)
     geometry.geometry.instances.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_INSTANCES_DATA_KHR;
     geometry.geometry.instances.pNext = nullptr;
     geometry.geometry.instances.arrayOfPointers = VK_FALSE;
-    geometry.geometry.instances.data.deviceAddress = instancesBuffer->GetDeviceAddress();
+    geometry.geometry.instances.data.deviceAddress = instancesBuffer_->GetDeviceAddress();
 
     VkAccelerationStructureBuildOffsetInfoKHR buildOffsetInfo = {};
-    buildOffsetInfo.primitiveCount = blases.size();
+    buildOffsetInfo.primitiveCount = blases.size() + deviceInstanceCount_;
     buildOffsetInfo.primitiveOffset = 0;
     buildOffsetInfo.firstVertex = 0;
     buildOffsetInfo.transformOffset = 0;
 
     accelerationGeometries_.push_back(geometry);
-    buildOffsets_.push_back(&buildOffsetInfo);
+    buildOffsets_.push_back(buildOffsetInfo);
 
     tlasMemory_.reset(new DeviceMemory(objectSize_, tlasMemoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, true));
 
@@ -119,33 +139,144 @@ estun::TLAS::TLAS(std::vector<std::shared_ptr<estun::BLAS>> blases)
 
     VK_CHECK_RESULT(FunctionsLocator::GetFunctions().vkBindAccelerationStructureMemoryKHR(DeviceLocator::GetLogicalDevice(), 1, &bindMemoryInfo), "bind acceleration structure");
 
-    SingleTimeCommands::SubmitCompute([this, scratchBuffer](VkCommandBuffer commandBuffer) {
-        const VkAccelerationStructureGeometryKHR *pGeometries = accelerationGeometries_.data();
-
-        VkAccelerationStructureBuildGeometryInfoKHR buildGeometryInfo = {};
-        buildGeometryInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR;
-        buildGeometryInfo.pNext = nullptr;
-        buildGeometryInfo.type = VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR;
-        buildGeometryInfo.flags = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR;
-        buildGeometryInfo.update = VK_FALSE;
-        buildGeometryInfo.srcAccelerationStructure = VK_NULL_HANDLE;
-        buildGeometryInfo.dstAccelerationStructure = accelerationStructure_;
-        buildGeometryInfo.geometryArrayOfPointers = VK_FALSE;
-        buildGeometryInfo.geometryCount = 1;
-        buildGeometryInfo.ppGeometries = &pGeometries;
-        buildGeometryInfo.scratchData.deviceAddress = scratchBuffer->GetDeviceAddress();
-
-        FunctionsLocator::GetFunctions().vkCmdBuildAccelerationStructureKHR(commandBuffer, 1, &buildGeometryInfo, buildOffsets_.data());
-    }, "create tlas");
+    if (deviceInstanceCount_ > 0)
+    {
+        deviceInstancesBuffer_ = std::make_shared<InstanceBuffer>(instanceCount_ + deviceInstanceCount_);
+    }
+    else
+    {
+        SingleTimeCommands::SubmitCompute([this](VkCommandBuffer commandBuffer) {
+            Record(commandBuffer, false, scratchBuffer_->GetDeviceAddress(), 0);
+        }, "create tlas");
+    }
+
+    // Instances and scratch are only needed again for refits and device builds
+    if (!allowUpdate && deviceInstanceCount_ == 0)
+    {
+        instancesMemory_->Unmap();
+        instances_ = nullptr;
+        instancesBuffer_.reset();
+        instancesMemory_.reset();
+        scratchBuffer_.reset();
+        scratchMemory_.reset();
+    }
 
     ES_CORE_INFO("TLAS created");
 }
 
+void estun::TLAS::Update(VkCommandBuffer commandBuffer)
+{
+    if (scratchBuffer_ == nullptr)
+    {
+        ES_CORE_ASSERT("TLAS was not created with allowUpdate");
+        return;
+    }
+
+    Record(commandBuffer, true, scratchBuffer_->GetDeviceAddress(), ContextLocator::GetImageIndex() % instanceSetCount_);
+}
+
+void estun::TLAS::Build(VkCommandBuffer commandBuffer)
+{
+    if (scratchBuffer_ == nullptr)
+    {
+        ES_CORE_ASSERT("TLAS was not created with allowUpdate or device instances");
+        return;
+    }
+
+    Record(commandBuffer, false, scratchBuffer_->GetDeviceAddress(), ContextLocator::GetImageIndex() % instanceSetCount_);
+}
+
+VkAccelerationStructureInstanceKHR *estun::TLAS::GetInstances(uint32_t imageIndex)
+{
+    if (instances_ == nullptr)
+    {
+        ES_CORE_ASSERT("TLAS was not created with allowUpdate");
+        return nullptr;
+    }
+
+    return instances_ + (imageIndex % instanceSetCount_) * instanceCount_;
+}
+
+VkTransformMatrixKHR estun::TLAS::ToTransformMatrix(const glm::mat4 &transform)
+{
+    VkTransformMatrixKHR matrix;
+    for (uint32_t row = 0; row < 3; row++)
+    {
+        for (uint32_t column = 0; column < 4; column++)
+        {
+            matrix.matrix[row][column] = transform[column][row];
+        }
+    }
+
+    return matrix;
+}
+
+void estun::TLAS::Record(VkCommandBuffer commandBuffer, bool update, VkDeviceAddress scratchAddress, uint32_t instanceSet)
+{
+    const VkDeviceSize setOffset = instanceSet * instanceCount_ * sizeof(VkAccelerationStructureInstanceKHR);
+
+    if (deviceInstancesBuffer_ != nullptr)
+    {
+        // The host instances join the device written ones, after the previous build stopped reading them
+        if (instanceCount_ > 0)
+        {
+            PipelineBarrier::Insert(
+                commandBuffer,
+                VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR, VK_ACCESS_TRANSFER_WRITE_BIT,
+                VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR, VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+            VkBufferCopy region = {setOffset, 0, instanceCount_ * sizeof(VkAccelerationStructureInstanceKHR)};
+            vkCmdCopyBuffer(commandBuffer, instancesBuffer_->GetBuffer(), deviceInstancesBuffer_->GetBuffer().GetBuffer(), 1, &region);
+
+            PipelineBarrier::Insert(
+                commandBuffer,
+                VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR | VK_ACCESS_SHADER_READ_BIT,
+                VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR);
+        }
+
+        accelerationGeometries_[0].geometry.instances.data.deviceAddress = deviceInstancesBuffer_->GetDeviceAddress();
+    }
+    else
+    {
+        accelerationGeometries_[0].geometry.instances.data.deviceAddress = instancesBuffer_->GetDeviceAddress() + setOffset;
+    }
+
+    const VkAccelerationStructureGeometryKHR *pGeometries = accelerationGeometries_.data();
+    const VkAccelerationStructureBuildOffsetInfoKHR *pBuildOffsets = buildOffsets_.data();
+
+    VkAccelerationStructureBuildGeometryInfoKHR buildGeometryInfo = {};
+    buildGeometryInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR;
+    buildGeometryInfo.pNext = nullptr;
+    buildGeometryInfo.type = VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR;
+    buildGeometryInfo.flags = flags_;
+    buildGeometryInfo.update = update ? VK_TRUE : VK_FALSE;
+    buildGeometryInfo.srcAccelerationStructure = update ? accelerationStructure_ : VK_NULL_HANDLE;
+    buildGeometryInfo.dstAccelerationStructure = accelerationStructure_;
+    buildGeometryInfo.geometryArrayOfPointers = VK_FALSE;
+    buildGeometryInfo.geometryCount = 1;
+    buildGeometryInfo.ppGeometries = &pGeometries;
+    buildGeometryInfo.scratchData.deviceAddress = scratchAddress;
+
+    FunctionsLocator::GetFunctions().vkCmdBuildAccelerationStructureKHR(commandBuffer, 1, &buildGeometryInfo, &pBuildOffsets);
+}
+
 estun::TLAS::~TLAS()
 {
+    if (instances_ != nullptr)
+    {
+        instancesMemory_->Unmap();
+        instances_ = nullptr;
+    }
+    instancesBuffer_.reset();
+    instancesMemory_.reset();
+    deviceInstancesBuffer_.reset();
+    scratchBuffer_.reset();
+    scratchMemory_.reset();
     if (accelerationStructure_ != nullptr)
     {
-        FunctionsLocator::GetFunctions().vkDestroyAccelerationStructureKHR(DeviceLocator::GetLogicalDevice(), accelerationStructure_, nullptr);
+        DeviceLocator::GetDevice().GetDeletionQueue().Push([handle = accelerationStructure_]() {
+            FunctionsLocator::GetFunctions().vkDestroyAccelerationStructureKHR(DeviceLocator::GetLogicalDevice(), handle, nullptr);
+        });
         accelerationStructure_ = nullptr;
     }
 }
@@ -2,6 +2,7 @@
 
 #include "renderer/common.h"
 #include "renderer/material/descriptable.h"
+#include "glm/glm.hpp"
 
 namespace estun
 {
@@ -10,6 +11,7 @@ namespace estun
     class Model;
     class BLAS;
     class DeviceMemory;
+    class InstanceBuffer;
 
     class TLAS : public Descriptable
     {
@@ -20,9 +22,29 @@ namespace estun
         TLAS &operator=(const TLAS &) = delete;
         TLAS &operator=(TLAS &&) = delete;
 
-        TLAS(std::vector<std::shared_ptr<estun::BLAS>> blases);
+        // Device instances follow the BLAS instances and are written on the device, e.g. by a ScatterSet.
+        // Such a TLAS is not built until Build is recorded after they were written.
+        TLAS(std::vector<std::shared_ptr<estun::BLAS>> blases, bool allowUpdate = false, uint32_t deviceInstanceCount = 0);
         ~TLAS();
 
+        // Records a refit against the current contents of the instanced BLASes and the instance array of the
+        // image being recorded, the caller owns the barriers around it
+        void Update(VkCommandBuffer commandBuffer);
+        // Records a full build, needed once device instances were written and whenever they move too far for a refit
+        void Build(VkCommandBuffer commandBuffer);
+
+        // An updatable TLAS keeps one host visible instance array per swapchain image, mapped for its lifetime.
+        // Transforms written to an image's array are picked up by refits recorded for that image.
+        VkAccelerationStructureInstanceKHR *GetInstances(uint32_t imageIndex);
+        uint32_t GetInstanceCount() const { return instanceCount_; }
+
+        // Device local array holding the BLAS instances copied from the image's host array, then the device instances
+        std::shared_ptr<InstanceBuffer> GetDeviceInstanceBuffer() { return deviceInstancesBuffer_; }
+        uint32_t GetDeviceInstanceCount() const { return deviceInstanceCount_; }
+
+        // Instances take a row major 3x4 matrix while glm stores columns
+        static VkTransformMatrixKHR ToTransformMatrix(const glm::mat4 &transform);
+
         VkMemoryRequirements GetBufferMemoryRequirements(VkAccelerationStructureKHR accelerationStructure, VkAccelerationStructureMemoryRequirementsTypeKHR type);
 
         DescriptableInfo GetInfo() override;
@@ -30,14 +52,26 @@ namespace estun
         uint32_t GetBufferSize(VkAccelerationStructureKHR accelerationStructure, VkAccelerationStructureMemoryRequirementsTypeKHR type);
 
     private:
+        void Record(VkCommandBuffer commandBuffer, bool update, VkDeviceAddress scratchAddress, uint32_t instanceSet);
+
         std::shared_ptr<DeviceMemory> tlasMemory_;
+        std::shared_ptr<Buffer> instancesBuffer_;
+        std::shared_ptr<DeviceMemory> instancesMemory_;
+        VkAccelerationStructureInstanceKHR *instances_ = nullptr;
+        uint32_t instanceCount_ = 0;
+        uint32_t instanceSetCount_ = 1;
+        std::shared_ptr<InstanceBuffer> deviceInstancesBuffer_;
+        uint32_t deviceInstanceCount_ = 0;
+        std::shared_ptr<Buffer> scratchBuffer_;
+        std::shared_ptr<DeviceMemory> scratchMemory_;
+        VkBuildAccelerationStructureFlagsKHR flags_ = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR;
 
         VkDeviceAddress deviceAddress_;
         uint32_t buildScratchSize_;
         uint32_t objectSize_;
         VkAccelerationStructureKHR accelerationStructure_;
 
-        std::vector<VkAccelerationStructureBuildOffsetInfoKHR *> buildOffsets_;
+        std::vector<VkAccelerationStructureBuildOffsetInfoKHR> buildOffsets_;
         std::vector<VkAccelerationStructureGeometryKHR> accelerationGeometries_;
     };
 
@@ -17,9 +17,10 @@ estun::RayTracingRender::~RayTracingRender()
 
 std::shared_ptr<estun::RayTracingPipeline> estun::RayTracingRender::CreatePipeline(
     const std::vector<std::vector<Shader>> shaderGroups,
-    const std::shared_ptr<Descriptor> descriptor)
+    const std::shared_ptr<Descriptor> descriptor,
+    const SpecializationConstants &constants)
 {
-    std::shared_ptr<RayTracingPipeline> pipeline = std::make_shared<RayTracingPipeline>(shaderGroups, descriptor);
+    std::shared_ptr<RayTracingPipeline> pipeline = std::make_shared<RayTracingPipeline>(shaderGroups, descriptor, constants);
     pipelines_.push_back(pipeline);
     return pipeline;
 }
@@ -45,6 +46,11 @@ void estun::RayTracingRender::Bind(std::shared_ptr<RayTracingPipeline> pipeline)
 }
 
 void estun::RayTracingRender::TraceRays(std::shared_ptr<ShaderBindingTable> sbtable, uint32_t width, uint32_t height)
+{
+    TraceRays(GetCurrCommandBuffer(), sbtable, width, height);
+}
+
+void estun::RayTracingRender::TraceRays(VkCommandBuffer commandBuffer, std::shared_ptr<ShaderBindingTable> sbtable, uint32_t width, uint32_t height)
 {
     const VkStridedBufferRegionKHR raygenShaderBindingTable = {sbtable->GetBuffer().GetBuffer(), sbtable->GetRayGenOffset(), sbtable->GetRayGenEntrySize(), sbtable->GetSize()};
     const VkStridedBufferRegionKHR missShaderBindingTable = {sbtable->GetBuffer().GetBuffer(), sbtable->GetMissOffset(), sbtable->GetMissEntrySize(), sbtable->GetSize()};
@@ -52,7 +58,7 @@ void estun::RayTracingRender::TraceRays(std::shared_ptr<ShaderBindingTable> sbta
     const VkStridedBufferRegionKHR callableShaderBindingTable = {sbtable->GetBuffer().GetBuffer(), sbtable->GetCallableOffset(), sbtable->GetCallableEntrySize(), sbtable->GetSize()};
 
     FunctionsLocator::GetFunctions().vkCmdTraceRaysKHR(
-        GetCurrCommandBuffer(),
+        commandBuffer,
         &raygenShaderBindingTable,
         &missShaderBindingTable,
         &hitShaderBindingTable,
@@ -64,21 +70,21 @@ void estun::RayTracingRender::CopyImage(std::shared_ptr<Image> image1, std::shar
 {
     image1->Barrier(
         GetCurrCommandBuffer(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-        VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_SHADER_READ_BIT,
-        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+        VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT,
+        VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR, VK_PIPELINE_STAGE_TRANSFER_BIT);
     image2->Barrier(
         GetCurrCommandBuffer(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-        VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_SHADER_READ_BIT,
-        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+        VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+        VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR, VK_PIPELINE_STAGE_TRANSFER_BIT);
     image1->CopyTo(GetCurrCommandBuffer(), image2);
     image1->Barrier(
         GetCurrCommandBuffer(), VK_IMAGE_LAYOUT_GENERAL,
-        VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_SHADER_READ_BIT,
-        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+        0, VK_ACCESS_SHADER_WRITE_BIT,
+        VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR);
     image2->Barrier(
         GetCurrCommandBuffer(), VK_IMAGE_LAYOUT_GENERAL,
-        VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_SHADER_READ_BIT,
-        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+        VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+        VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR);
 }
 
 VkCommandBuffer &estun::RayTracingRender::GetCurrCommandBuffer()
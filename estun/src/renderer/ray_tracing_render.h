@@ -39,7 +39,8 @@ namespace estun
 
         std::shared_ptr<RayTracingPipeline> CreatePipeline(
             const std::vector<std::vector<Shader>> shaderGroups,
-            const std::shared_ptr<Descriptor> descriptor);
+            const std::shared_ptr<Descriptor> descriptor,
+            const SpecializationConstants &constants = SpecializationConstants());
 
         void BeginBuffer();
         void EndBuffer();
@@ -48,6 +49,8 @@ namespace estun
         void Bind(std::shared_ptr<RayTracingPipeline> pipeline);
 
         void TraceRays(std::shared_ptr<ShaderBindingTable> sbtable, uint32_t width, uint32_t height);
+        // For secondary buffers recorded on other threads
+        void TraceRays(VkCommandBuffer commandBuffer, std::shared_ptr<ShaderBindingTable> sbtable, uint32_t width, uint32_t height);
 
         void CopyImage(std::shared_ptr<Image> image1, std::shared_ptr<Image> image2);
 
@@ -0,0 +1,497 @@
+#include "renderer/render_graph.h"
+#include "renderer/context.h"
+#include "renderer/context/image.h"
+#include "renderer/context/base_image.h"
+#include "renderer/context/command_recorder.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace
+{
+    struct UsageInfo
+    {
+        VkPipelineStageFlags stage;
+        VkAccessFlags access;
+        VkImageLayout layout;
+        bool write;
+    };
+
+    UsageInfo GetUsageInfo(estun::ResourceUsage usage)
+    {
+        switch (usage)
+        {
+        case estun::ResourceUsage::ComputeRead:
+            return {VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_GENERAL, false};
+        case estun::ResourceUsage::ComputeWrite:
+            return {VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL, true};
+        case estun::ResourceUsage::RayTracingRead:
+            return {VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_GENERAL, false};
+        case estun::ResourceUsage::RayTracingSample:
+            return {VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, false};
+        case estun::ResourceUsage::RayTracingWrite:
+            return {VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL, true};
+        case estun::ResourceUsage::AccelerationStructureRead:
+            return {VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR, VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR, VK_IMAGE_LAYOUT_UNDEFINED, false};
+        case estun::ResourceUsage::AccelerationStructureBuildInput:
+            return {VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR, VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR | VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED, false};
+        case estun::ResourceUsage::AccelerationStructureWrite:
+            return {VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR, VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR | VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR, VK_IMAGE_LAYOUT_UNDEFINED, true};
+        case estun::ResourceUsage::TransferRead:
+            return {VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, false};
+        case estun::ResourceUsage::TransferWrite:
+            return {VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, true};
+        case estun::ResourceUsage::HostRead:
+            return {VK_PIPELINE_STAGE_HOST_BIT, VK_ACCESS_HOST_READ_BIT, VK_IMAGE_LAYOUT_GENERAL, false};
+        default:
+            return {0, 0, VK_IMAGE_LAYOUT_UNDEFINED, false};
+        }
+    }
+
+    // Only writes have to be made available, read bits in a source mask do nothing
+    const VkAccessFlags writeAccessMask = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR |
+                                          VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_HOST_WRITE_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+
+    const uint32_t invalidIndex = std::numeric_limits<uint32_t>::max();
+} // namespace
+
+estun::RenderGraph::~RenderGraph()
+{
+    passes_.clear();
+    physicals_.clear();
+    transientImages_.clear();
+    resources_.clear();
+}
+
+uint32_t estun::RenderGraph::ImportImage(const std::string &name, std::shared_ptr<Image> image)
+{
+    resources_.push_back({name, Imported, true, image, image->GetLayout(), ResourceUsage::None, {}, invalidIndex});
+    dirty_ = true;
+    return static_cast<uint32_t>(resources_.size() - 1);
+}
+
+uint32_t estun::RenderGraph::ImportSwapChainImage(const std::string &name)
+{
+    resources_.push_back({name, SwapChainImage, true, nullptr, VK_IMAGE_LAYOUT_UNDEFINED, ResourceUsage::None, {}, invalidIndex});
+    dirty_ = true;
+    return static_cast<uint32_t>(resources_.size() - 1);
+}
+
+uint32_t estun::RenderGraph::ImportBuffer(const std::string &name, ResourceUsage finalUsage)
+{
+    resources_.push_back({name, Imported, false, nullptr, VK_IMAGE_LAYOUT_UNDEFINED, finalUsage, {}, invalidIndex});
+    dirty_ = true;
+    return static_cast<uint32_t>(resources_.size() - 1);
+}
+
+uint32_t estun::RenderGraph::CreateImage(const std::string &name, const TransientImageDesc &desc)
+{
+    resources_.push_back({name, Transient, true, nullptr, VK_IMAGE_LAYOUT_UNDEFINED, ResourceUsage::None, desc, invalidIndex});
+    dirty_ = true;
+    return static_cast<uint32_t>(resources_.size() - 1);
+}
+
+void estun::RenderGraph::SetImage(uint32_t resource, std::shared_ptr<Image> image)
+{
+    if (resource >= resources_.size() || resources_[resource].kind != Imported || !resources_[resource].isImage)
+    {
+        ES_CORE_WARN(std::string("Render graph resource ") + std::to_string(resource) + std::string(" is no imported image"));
+        return;
+    }
+
+    // The closing barriers return to the layout of the image, a new one may have another
+    dirty_ |= image->GetLayout() != resources_[resource].layout;
+    resources_[resource].image = image;
+    resources_[resource].layout = image->GetLayout();
+}
+
+std::shared_ptr<estun::Image> estun::RenderGraph::GetImage(uint32_t resource) const
+{
+    const Resource &entry = resources_[resource];
+    if (entry.kind == Transient)
+    {
+        return entry.physical != invalidIndex ? physicals_[entry.physical].transient : nullptr;
+    }
+    return entry.image;
+}
+
+uint32_t estun::RenderGraph::AddPass(const std::string &name, const std::vector<ResourceUse> &uses, std::function<void(VkCommandBuffer)> record, bool sideEffects)
+{
+    passes_.push_back({name, uses, record, sideEffects});
+    dirty_ = true;
+    return static_cast<uint32_t>(passes_.size() - 1);
+}
+
+void estun::RenderGraph::Record(VkCommandBuffer primary, uint32_t frame, CommandRecorder *recorder)
+{
+    if (dirty_)
+    {
+        Compile();
+    }
+
+    std::vector<VkCommandBuffer> secondaries;
+    if (recorder != nullptr)
+    {
+        std::vector<std::function<void(VkCommandBuffer)>> parts;
+        for (const uint32_t pass : livePasses_)
+        {
+            parts.push_back(passes_[pass].record);
+        }
+        secondaries = recorder->RecordSecondaries(frame, parts);
+    }
+
+    for (size_t i = 0; i < livePasses_.size(); i++)
+    {
+        Insert(primary, barriers_[i]);
+        if (recorder != nullptr)
+        {
+            vkCmdExecuteCommands(primary, 1, &secondaries[i]);
+        }
+        else
+        {
+            passes_[livePasses_[i]].record(primary);
+        }
+    }
+    Insert(primary, barriers_.back());
+}
+
+void estun::RenderGraph::Compile()
+{
+    Cull();
+    Alias();
+
+    std::vector<State> states(physicals_.size());
+    for (size_t i = 0; i < physicals_.size(); i++)
+    {
+        const Resource &resource = resources_[physicals_[i].resource];
+        if (resource.kind == Imported)
+        {
+            states[i].layout = resource.layout;
+        }
+        else if (resource.kind == SwapChainImage)
+        {
+            // The stage the ray tracing submission waits on the acquired image at
+            states[i].writeStages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        }
+    }
+
+    barriers_.assign(livePasses_.size() + 1, Barriers());
+    // Logical resource that used each physical one last, a transient taking over an image discards it
+    std::vector<uint32_t> owners(physicals_.size(), invalidIndex);
+    for (size_t i = 0; i < livePasses_.size(); i++)
+    {
+        for (const auto &use : passes_[livePasses_[i]].uses)
+        {
+            const Resource &resource = resources_[use.resource];
+            const uint32_t physical = resource.physical;
+            const bool discard = resource.kind != Imported && owners[physical] != use.resource;
+            owners[physical] = use.resource;
+            Use(states[physical], resource, physical, use.usage, discard, barriers_[i]);
+        }
+    }
+
+    for (size_t i = 0; i < physicals_.size(); i++)
+    {
+        if (states[i].used)
+        {
+            Close(states[i], resources_[physicals_[i].resource], static_cast<uint32_t>(i), barriers_.back());
+        }
+    }
+
+    dirty_ = false;
+}
+
+void estun::RenderGraph::Cull()
+{
+    // Imported resources outlive the frame, writing them is a result
+    std::vector<bool> needed(resources_.size());
+    for (size_t i = 0; i < resources_.size(); i++)
+    {
+        needed[i] = resources_[i].kind != Transient;
+    }
+
+    std::vector<bool> live(passes_.size(), false);
+    for (size_t i = passes_.size(); i-- > 0;)
+    {
+        live[i] = passes_[i].sideEffects;
+        for (const auto &use : passes_[i].uses)
+        {
+            live[i] = live[i] || (GetUsageInfo(use.usage).write && needed[use.resource]);
+        }
+
+        if (live[i])
+        {
+            for (const auto &use : passes_[i].uses)
+            {
+                needed[use.resource] = true;
+            }
+        }
+    }
+
+    livePasses_.clear();
+    for (size_t i = 0; i < passes_.size(); i++)
+    {
+        if (live[i])
+        {
+            livePasses_.push_back(static_cast<uint32_t>(i));
+        }
+    }
+}
+
+void estun::RenderGraph::Alias()
+{
+    physicals_.clear();
+
+    std::vector<uint32_t> firstUse(resources_.size(), invalidIndex);
+    std::vector<uint32_t> lastUse(resources_.size(), 0);
+    for (uint32_t i = 0; i < livePasses_.size(); i++)
+    {
+        for (const auto &use : passes_[livePasses_[i]].uses)
+        {
+            firstUse[use.resource] = std::min(firstUse[use.resource], i);
+            lastUse[use.resource] = i;
+        }
+    }
+
+    std::vector<uint32_t> transients;
+    for (uint32_t i = 0; i < resources_.size(); i++)
+    {
+        resources_[i].physical = invalidIndex;
+        if (resources_[i].kind != Transient)
+        {
+            resources_[i].physical = static_cast<uint32_t>(physicals_.size());
+            physicals_.push_back({i, nullptr});
+        }
+        else if (firstUse[i] != invalidIndex)
+        {
+            transients.push_back(i);
+        }
+    }
+
+    std::sort(transients.begin(), transients.end(), [&firstUse](uint32_t a, uint32_t b) { return firstUse[a] < firstUse[b]; });
+
+    // A transient takes over the image of one that is no longer used, created images are kept when they fit
+    std::vector<uint32_t> physicalLastUse(physicals_.size(), 0);
+    std::vector<bool> taken(transientImages_.size(), false);
+    for (const uint32_t transient : transients)
+    {
+        Resource &resource = resources_[transient];
+        for (size_t i = 0; i < physicals_.size(); i++)
+        {
+            const Resource &owner = resources_[physicals_[i].resource];
+            if (owner.kind == Transient && owner.desc == resource.desc && physicalLastUse[i] < firstUse[transient])
+            {
+                resource.physical = static_cast<uint32_t>(i);
+                physicalLastUse[i] = lastUse[transient];
+                break;
+            }
+        }
+        if (resource.physical != invalidIndex)
+        {
+            continue;
+        }
+
+        std::shared_ptr<Image> image;
+        for (size_t i = 0; i < transientImages_.size() && image == nullptr; i++)
+        {
+            if (!taken[i] && transientImages_[i].first == resource.desc)
+            {
+                taken[i] = true;
+                image = transientImages_[i].second;
+            }
+        }
+        if (image == nullptr)
+        {
+            image = std::make_shared<Image>(
+                resource.desc.width, resource.desc.height, VK_SAMPLE_COUNT_1_BIT, resource.desc.format,
+                VK_IMAGE_TILING_OPTIMAL, resource.desc.usage, VK_IMAGE_ASPECT_COLOR_BIT);
+            transientImages_.push_back(std::make_pair(resource.desc, image));
+            taken.push_back(true);
+        }
+
+        resource.physical = static_cast<uint32_t>(physicals_.size());
+        physicals_.push_back({transient, image});
+        physicalLastUse.push_back(lastUse[transient]);
+    }
+
+    // Images no pass needs anymore go through the deletion queue
+    for (size_t i = taken.size(); i-- > 0;)
+    {
+        if (!taken[i])
+        {
+            transientImages_.erase(transientImages_.begin() + i);
+        }
+    }
+}
+
+void estun::RenderGraph::Use(State &state, const Resource &resource, uint32_t physical, ResourceUsage usage, bool discard, Barriers &barriers) const
+{
+    const UsageInfo info = GetUsageInfo(usage);
+    if (info.stage == 0)
+    {
+        return;
+    }
+
+    if (!state.used)
+    {
+        state.used = true;
+        state.firstUsage = usage;
+    }
+
+    const bool layoutChange = resource.isImage && (discard || state.layout != info.layout);
+
+    // Writes wait for every earlier access, reads only for a write they have not seen yet
+    bool needed = false;
+    VkPipelineStageFlags srcStages = 0;
+    if (info.write)
+    {
+        needed = layoutChange || state.writeStages != 0 || state.readStages != 0;
+        srcStages = state.writeStages | state.readStages;
+    }
+    else
+    {
+        const bool unseen = (info.stage & ~state.readStages) != 0 || (info.access & ~state.readAccess) != 0;
+        needed = layoutChange || (state.writeStages != 0 && unseen);
+        srcStages = state.writeStages | (layoutChange ? state.readStages : 0);
+    }
+
+    if (needed)
+    {
+        // Nothing pending in this frame, the barriers closing the last one waited with this stage as target
+        if (srcStages == 0)
+        {
+            srcStages = info.stage;
+        }
+
+        barriers.srcStages |= srcStages;
+        barriers.dstStages |= info.stage;
+        if (resource.isImage)
+        {
+            barriers.images.push_back({physical, state.writeAccess, info.access, discard ? VK_IMAGE_LAYOUT_UNDEFINED : state.layout, info.layout});
+        }
+        else
+        {
+            barriers.memory = true;
+            barriers.srcAccess |= state.writeAccess;
+            barriers.dstAccess |= info.access;
+        }
+    }
+
+    if (info.write)
+    {
+        state.writeStages = info.stage;
+        state.writeAccess = info.access & writeAccessMask;
+        state.readStages = 0;
+        state.readAccess = 0;
+    }
+    else if (layoutChange)
+    {
+        // The transition itself is a write, later reads in other stages have to wait for it
+        state.writeStages = info.stage;
+        state.writeAccess = 0;
+        state.readStages = info.stage;
+        state.readAccess = info.access;
+    }
+    else
+    {
+        state.readStages |= info.stage;
+        state.readAccess |= info.access;
+    }
+
+    if (resource.isImage)
+    {
+        state.layout = info.layout;
+    }
+}
+
+void estun::RenderGraph::Close(State &state, const Resource &resource, uint32_t physical, Barriers &barriers) const
+{
+    const VkPipelineStageFlags pendingStages = state.writeStages | state.readStages;
+
+    if (resource.kind == SwapChainImage)
+    {
+        barriers.srcStages |= pendingStages != 0 ? pendingStages : static_cast<VkPipelineStageFlags>(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+        barriers.dstStages |= VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+        barriers.images.push_back({physical, state.writeAccess, 0, state.layout, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR});
+        return;
+    }
+
+    // The next frame starts with the first usage again, the hazards across the frame boundary are resolved here
+    const UsageInfo first = GetUsageInfo(state.firstUsage);
+    const UsageInfo last = GetUsageInfo(resource.finalUsage);
+    const VkPipelineStageFlags dstStages = first.stage | last.stage;
+    const VkAccessFlags dstAccess = first.access | last.access;
+
+    const VkImageLayout endLayout = resource.kind == Imported ? resource.layout : state.layout;
+    const bool layoutChange = resource.isImage && state.layout != endLayout;
+    if (!layoutChange && state.writeStages == 0 && !(first.write && state.readStages != 0))
+    {
+        return;
+    }
+
+    barriers.srcStages |= pendingStages != 0 ? pendingStages : dstStages;
+    barriers.dstStages |= dstStages;
+    if (resource.isImage)
+    {
+        barriers.images.push_back({physical, state.writeAccess, dstAccess, state.layout, endLayout});
+    }
+    else
+    {
+        barriers.memory = true;
+        barriers.srcAccess |= state.writeAccess;
+        barriers.dstAccess |= dstAccess;
+    }
+}
+
+void estun::RenderGraph::Insert(VkCommandBuffer commandBuffer, const Barriers &barriers) const
+{
+    if (!barriers.memory && barriers.images.empty())
+    {
+        return;
+    }
+
+    VkMemoryBarrier memoryBarrier = {};
+    memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    memoryBarrier.srcAccessMask = barriers.srcAccess;
+    memoryBarrier.dstAccessMask = barriers.dstAccess;
+
+    std::vector<VkImageMemoryBarrier> imageBarriers;
+    for (const auto &transition : barriers.images)
+    {
+        VkImageMemoryBarrier barrier = {};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.oldLayout = transition.oldLayout;
+        barrier.newLayout = transition.newLayout;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = GetVkImage(transition.physical);
+        barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        barrier.subresourceRange.baseMipLevel = 0;
+        barrier.subresourceRange.levelCount = 1;
+        barrier.subresourceRange.baseArrayLayer = 0;
+        barrier.subresourceRange.layerCount = 1;
+        barrier.srcAccessMask = transition.srcAccess;
+        barrier.dstAccessMask = transition.dstAccess;
+        imageBarriers.push_back(barrier);
+    }
+
+    vkCmdPipelineBarrier(
+        commandBuffer, barriers.srcStages, barriers.dstStages, 0,
+        barriers.memory ? 1 : 0, &memoryBarrier,
+        0, nullptr,
+        static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
+}
+
+VkImage estun::RenderGraph::GetVkImage(uint32_t physical) const
+{
+    const Resource &resource = resources_[physicals_[physical].resource];
+    switch (resource.kind)
+    {
+    case SwapChainImage:
+        return ContextLocator::GetSwapChain()->GetImages()[ContextLocator::GetImageIndex()];
+    case Transient:
+        return physicals_[physical].transient->GetImage().GetImage();
+    default:
+        return resource.image->GetImage().GetImage();
+    }
+}
@@ -0,0 +1,174 @@
+#pragma once
+
+#include "renderer/common.h"
+
+namespace estun
+{
+
+    class Image;
+    class CommandRecorder;
+
+    // How a pass touches a resource, each usage maps to the stages, accesses and image layout it needs
+    enum class ResourceUsage : uint32_t
+    {
+        None,
+        ComputeRead,
+        ComputeWrite,
+        RayTracingRead,
+        RayTracingSample,
+        RayTracingWrite,
+        AccelerationStructureRead,
+        AccelerationStructureBuildInput,
+        AccelerationStructureWrite,
+        TransferRead,
+        TransferWrite,
+        HostRead,
+    };
+
+    struct ResourceUse
+    {
+        uint32_t resource;
+        ResourceUsage usage;
+    };
+
+    struct TransientImageDesc
+    {
+        uint32_t width;
+        uint32_t height;
+        VkFormat format;
+        VkImageUsageFlags usage;
+
+        bool operator==(const TransientImageDesc &other) const
+        {
+            return width == other.width && height == other.height && format == other.format && usage == other.usage;
+        }
+    };
+
+    // The passes of a frame in submission order. Passes only declare the resources they use and how, the
+    // graph places the barriers and layout transitions between them, and the ones closing the frame so that
+    // the next frame finds every resource as it expects. Passes whose results nobody uses are culled, and
+    // transient images whose lifetimes do not overlap share one image.
+    //
+    // Buffers and acceleration structures are synchronized with global memory barriers, a resource of the
+    // graph may stand for several of them that are always used together. Barriers inside a pass stay its own.
+    class RenderGraph
+    {
+    public:
+        RenderGraph(const RenderGraph &) = delete;
+        RenderGraph(RenderGraph &&) = delete;
+        RenderGraph &operator=(const RenderGraph &) = delete;
+        RenderGraph &operator=(RenderGraph &&) = delete;
+
+        RenderGraph() = default;
+        ~RenderGraph();
+
+        // Starts and ends every frame in the layout the image has now
+        uint32_t ImportImage(const std::string &name, std::shared_ptr<Image> image);
+        // The acquired image, undefined at the start of the frame and ready to present at its end
+        uint32_t ImportSwapChainImage(const std::string &name);
+        // The final usage is made visible at the end of each frame, e.g. for reading results on the host
+        uint32_t ImportBuffer(const std::string &name, ResourceUsage finalUsage = ResourceUsage::None);
+        // Lives within the frame only, the contents are undefined at its first use
+        uint32_t CreateImage(const std::string &name, const TransientImageDesc &desc);
+
+        // Replaces an imported image, e.g. after a resize
+        void SetImage(uint32_t resource, std::shared_ptr<Image> image);
+        // Valid for transient images after the first Record
+        std::shared_ptr<Image> GetImage(uint32_t resource) const;
+
+        // Passes with side effects, such as writing the host visible results of a readback, are never culled
+        uint32_t AddPass(const std::string &name, const std::vector<ResourceUse> &uses, std::function<void(VkCommandBuffer)> record, bool sideEffects = false);
+
+        // Records the live passes with their barriers, in parallel secondary buffers when a recorder is given.
+        // The primary buffer has to be recording outside of a render pass.
+        void Record(VkCommandBuffer primary, uint32_t frame, CommandRecorder *recorder = nullptr);
+
+        uint32_t GetLivePassCount() const { return static_cast<uint32_t>(livePasses_.size()); }
+
+    private:
+        enum ResourceKind
+        {
+            Imported,
+            SwapChainImage,
+            Transient,
+        };
+
+        struct Resource
+        {
+            std::string name;
+            ResourceKind kind;
+            bool isImage;
+            std::shared_ptr<Image> image;
+            VkImageLayout layout;
+            ResourceUsage finalUsage;
+            TransientImageDesc desc;
+            uint32_t physical;
+        };
+
+        struct Pass
+        {
+            std::string name;
+            std::vector<ResourceUse> uses;
+            std::function<void(VkCommandBuffer)> record;
+            bool sideEffects;
+        };
+
+        // One per imported resource and per transient image, transients that alias each other share it
+        struct Physical
+        {
+            uint32_t resource;
+            std::shared_ptr<Image> transient;
+        };
+
+        struct ImageTransition
+        {
+            uint32_t physical;
+            VkAccessFlags srcAccess;
+            VkAccessFlags dstAccess;
+            VkImageLayout oldLayout;
+            VkImageLayout newLayout;
+        };
+
+        struct Barriers
+        {
+            VkPipelineStageFlags srcStages = 0;
+            VkPipelineStageFlags dstStages = 0;
+            VkAccessFlags srcAccess = 0;
+            VkAccessFlags dstAccess = 0;
+            bool memory = false;
+            std::vector<ImageTransition> images;
+        };
+
+        // What the device did to a physical resource last and what was already made visible since
+        struct State
+        {
+            VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+            VkPipelineStageFlags writeStages = 0;
+            VkAccessFlags writeAccess = 0;
+            VkPipelineStageFlags readStages = 0;
+            VkAccessFlags readAccess = 0;
+            ResourceUsage firstUsage = ResourceUsage::None;
+            bool used = false;
+        };
+
+        void Compile();
+        void Cull();
+        void Alias();
+        void Use(State &state, const Resource &resource, uint32_t physical, ResourceUsage usage, bool discard, Barriers &barriers) const;
+        void Close(State &state, const Resource &resource, uint32_t physical, Barriers &barriers) const;
+        void Insert(VkCommandBuffer commandBuffer, const Barriers &barriers) const;
+        VkImage GetVkImage(uint32_t physical) const;
+
+        std::vector<Resource> resources_;
+        std::vector<Pass> passes_;
+
+        std::vector<uint32_t> livePasses_;
+        std::vector<Physical> physicals_;
+        // Barriers before each live pass, the last entry closes the frame
+        std::vector<Barriers> barriers_;
+        // Created transient images, kept across compilations while their description still matches
+        std::vector<std::pair<TransientImageDesc, std::shared_ptr<Image>>> transientImages_;
+        bool dirty_ = true;
+    };
+
+} // namespace estun
@@ -1,18 +1,38 @@
 #include "renderer/context.h"
 
 #include "renderer/model.h"
+#include "renderer/mesh_optimizer.h"
+#include "renderer/deformable_mesh.h"
+#include "renderer/scene.h"
+#include "renderer/scene_graph.h"
+#include "renderer/render_graph.h"
+#include "renderer/dynamic_resolution.h"
+#include "renderer/sample_controller.h"
+#include "renderer/upscaler.h"
 #include "renderer/material/material.h"
 #include "renderer/buffers/storage_buffer.h"
+#include "renderer/buffers/compact_geometry.h"
+#include "renderer/buffers/procedural_spheres.h"
 #include "renderer/buffers/uniform_buffer.h"
 #include "renderer/context/render_pass.h"
 #include "renderer/context/image.h"
+#include "renderer/context/pipeline_barrier.h"
+#include "renderer/context/command_recorder.h"
+#include "renderer/context/gpu_timer.h"
 #include "renderer/material/descriptor.h"
 #include "renderer/material/descriptor_binding.h"
 #include "renderer/material/graphics_pipeline.h"
+#include "renderer/material/texture_manager.h"
+#include "renderer/material/texture_cache.h"
+#include "renderer/material/resource_table.h"
 #include "renderer/ray_tracing/top_level_acceleration_structure.h"
 #include "renderer/ray_tracing/bottom_level_acceleration_structure.h"
 #include "renderer/ray_tracing/bottom_level_acceleration_structure.h"
+#include "renderer/ray_tracing/acceleration_structure_cache.h"
+#include "renderer/ray_tracing/host_blas_builder.h"
 #include "renderer/ray_tracing/top_level_acceleration_structure.h"
 #include "renderer/ray_tracing/shader_binding_table.h"
 #include "renderer/ray_tracing/ray_tracing_pipeline.h"
+#include "renderer/ray_tracing/pipeline_permutations.h"
+#include "renderer/ray_tracing/scatter_set.h"
 #include "renderer/ray_tracing/ray_tracing_properties.h"
@@ -0,0 +1,45 @@
+#include "renderer/sample_controller.h"
+
+#include <algorithm>
+#include <cmath>
+
+estun::SampleController::SampleController(const SampleControllerConfig &config)
+    : config_(config)
+{
+    config_.minSamples = std::max(config_.minSamples, 1u);
+    config_.maxSamples = std::max(config_.maxSamples, config_.minSamples);
+    samples_ = config_.minSamples;
+}
+
+void estun::SampleController::Update(float traceMilliseconds, float frameMilliseconds, uint32_t samples)
+{
+    if (samples == 0)
+    {
+        return;
+    }
+
+    const float sample = traceMilliseconds / samples;
+    const float other = std::max(frameMilliseconds - traceMilliseconds, 0.0f);
+    if (hasAverage_)
+    {
+        sampleMilliseconds_ += config_.smoothing * (sample - sampleMilliseconds_);
+        otherMilliseconds_ += config_.smoothing * (other - otherMilliseconds_);
+    }
+    else
+    {
+        sampleMilliseconds_ = sample;
+        otherMilliseconds_ = other;
+        hasAverage_ = true;
+    }
+
+    const float budget = config_.targetMilliseconds - otherMilliseconds_;
+    const float fit = budget > 0.0f ? std::floor(budget / std::max(sampleMilliseconds_, 0.001f)) : 0.0f;
+    const uint32_t desired = static_cast<uint32_t>(std::min(fit, static_cast<float>(config_.maxSamples)));
+    samples_ = std::clamp(std::min(desired, 2 * samples_), config_.minSamples, config_.maxSamples);
+}
+
+void estun::SampleController::Reset()
+{
+    hasAverage_ = false;
+    samples_ = config_.minSamples;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "renderer/common.h"
+
+namespace estun
+{
+
+    struct SampleControllerConfig
+    {
+        // Device time of a whole frame the samples are chosen for
+        float targetMilliseconds = 16.0f;
+        uint32_t minSamples = 1;
+        uint32_t maxSamples = 32;
+        // Weight of a new frame in the running averages
+        float smoothing = 0.25f;
+    };
+
+    // Picks the samples per pixel of the next frames from the measured device time of the trace and of
+    // the rest of the frame. The trace costs about the same for every sample, so the samples are what
+    // is left of the target after the rest of the frame, divided by the average time of one sample.
+    // The measurements lag behind by the frames in flight, the count at most doubles from one to the next.
+    class SampleController
+    {
+    public:
+        explicit SampleController(const SampleControllerConfig &config = SampleControllerConfig());
+
+        // Times of a finished frame and the samples it traced, frames without samples are skipped
+        void Update(float traceMilliseconds, float frameMilliseconds, uint32_t samples);
+        // Forgets the measured times, e.g. when the resolution or the pipeline changed
+        void Reset();
+
+        uint32_t GetSamples() const { return samples_; }
+        float GetSampleMilliseconds() const { return sampleMilliseconds_; }
+
+    private:
+        SampleControllerConfig config_;
+        uint32_t samples_;
+        float sampleMilliseconds_ = 0.0f;
+        float otherMilliseconds_ = 0.0f;
+        bool hasAverage_ = false;
+    };
+
+} // namespace estun
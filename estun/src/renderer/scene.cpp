@@ -0,0 +1,655 @@
+#include "renderer/scene.h"
+#include "renderer/model.h"
+#include "renderer/context.h"
+#include "renderer/context/device.h"
+#include "renderer/material/resource_table.h"
+#include "renderer/ray_tracing/acceleration_structure_cache.h"
+#include "renderer/ray_tracing/host_blas_builder.h"
+#include "renderer/ray_tracing/scatter_set.h"
+#include "renderer/ray_tracing/top_level_acceleration_structure.h"
+#include "core/core.h"
+
+#include <chrono>
+
+estun::Scene::Scene(const SceneConfig &config, std::shared_ptr<AccelerationStructureCache> cache, std::shared_ptr<HostBLASBuilder> hostBuilder, std::shared_ptr<ResourceTable> table)
+    : config_(config),
+      cache_(cache),
+      hostBuilder_(hostBuilder),
+      table_(table),
+      vertexAllocator_(config.vertexCapacity),
+      indexAllocator_(config.indexCapacity),
+      materialIdAllocator_(config.materialIdCapacity),
+      materialAllocator_(config.materialCapacity),
+      clusterAllocator_(config.clusterCapacity)
+{
+    const VkBufferUsageFlags usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
+    positionBuffer_ = std::make_shared<GrowableBuffer<glm::vec3>>(config.vertexCapacity, usage);
+    attributeBuffer_ = std::make_shared<GrowableBuffer<CompactVertex>>(config.vertexCapacity);
+    indexBuffer_ = std::make_shared<GrowableBuffer<uint32_t>>(config.indexCapacity, usage | VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+    materialIdBuffer_ = std::make_shared<GrowableBuffer<uint32_t>>(config.materialIdCapacity);
+    materialBuffer_ = std::make_shared<GrowableBuffer<Material>>(config.materialCapacity);
+    offsetBuffer_ = std::make_shared<GrowableBuffer<MeshOffsets>>(config.clusterCapacity);
+
+    if (table_ != nullptr)
+    {
+        bufferHandles_.attributes = table_->AddBuffer(attributeBuffer_.get());
+        bufferHandles_.indices = table_->AddBuffer(indexBuffer_.get());
+        bufferHandles_.materials = table_->AddBuffer(materialBuffer_.get());
+        bufferHandles_.offsets = table_->AddBuffer(offsetBuffer_.get());
+        bufferHandles_.materialIds = table_->AddBuffer(materialIdBuffer_.get());
+    }
+}
+
+estun::Scene::~Scene()
+{
+    if (table_ != nullptr)
+    {
+        table_->RemoveBuffer(bufferHandles_.attributes);
+        table_->RemoveBuffer(bufferHandles_.indices);
+        table_->RemoveBuffer(bufferHandles_.materials);
+        table_->RemoveBuffer(bufferHandles_.offsets);
+        table_->RemoveBuffer(bufferHandles_.materialIds);
+        table_.reset();
+    }
+    tlas_.reset();
+    scatterSets_.clear();
+    instances_.clear();
+    retired_.clear();
+    entries_.clear();
+    positionBuffer_.reset();
+    attributeBuffer_.reset();
+    indexBuffer_.reset();
+    materialIdBuffer_.reset();
+    materialBuffer_.reset();
+    offsetBuffer_.reset();
+}
+
+template <class T>
+uint32_t estun::Scene::Allocate(RangeAllocator &allocator, std::shared_ptr<GrowableBuffer<T>> &buffer, uint32_t size)
+{
+    if (size == 0)
+    {
+        return 0;
+    }
+
+    uint32_t offset = allocator.Allocate(size);
+    if (offset != RangeAllocator::InvalidOffset)
+    {
+        return offset;
+    }
+
+    // Doubling keeps the number of reallocations logarithmic in the scene size
+    const uint32_t oldCapacity = allocator.GetCapacity();
+    const uint32_t capacity = std::max(oldCapacity * 2, oldCapacity + size);
+    allocator.Grow(capacity);
+    buffer->Reallocate(capacity, {{0, 0, oldCapacity}});
+    buffersChanged_ = true;
+
+    return allocator.Allocate(size);
+}
+
+uint32_t estun::Scene::AddEntry(std::shared_ptr<Model> model, bool deformable, bool instanced)
+{
+    Entry entry;
+    entry.model = model;
+    entry.packed = CompactGeometry::Pack(*model, config_.clusters);
+    entry.deformable = deformable;
+    entry.instanced = instanced;
+    entry.vertexCount = static_cast<uint32_t>(entry.packed.positions.size());
+    entry.indexCount = static_cast<uint32_t>(entry.packed.indices.size() / sizeof(uint32_t));
+    entry.materialIdCount = static_cast<uint32_t>(entry.packed.materialIds.size() / sizeof(uint32_t));
+    entry.materialCount = static_cast<uint32_t>(model->GetMaterials().size());
+    entry.clusters = entry.packed.clusters;
+    entry.indexCounts = entry.packed.indexCounts;
+    entry.hashes = entry.packed.hashes;
+
+    const uint32_t handle = nextHandle_++;
+    entries_.emplace(handle, std::move(entry));
+    return handle;
+}
+
+uint32_t estun::Scene::AddModel(std::shared_ptr<Model> model, bool deformable)
+{
+    const uint32_t handle = AddEntry(model, deformable, true);
+
+    // Deformed streams only exist for the full model
+    if (!deformable && !model->GetLods().empty())
+    {
+        std::vector<uint32_t> lodHandles;
+        for (const auto &lod : model->GetLods())
+        {
+            lodHandles.push_back(AddEntry(lod, false, false));
+        }
+
+        glm::vec3 minBound(std::numeric_limits<float>::max());
+        glm::vec3 maxBound(std::numeric_limits<float>::lowest());
+        for (const auto &vertex : model->GetVertices())
+        {
+            minBound = glm::min(minBound, vertex.position);
+            maxBound = glm::max(maxBound, vertex.position);
+        }
+
+        Entry &base = entries_.at(handle);
+        base.instanced = false;
+        base.lodHandles = lodHandles;
+        base.lodErrors = model->GetLodErrors();
+        base.center = 0.5f * (minBound + maxBound);
+        base.radius = 0.5f * glm::length(maxBound - minBound);
+        lodModelCount_++;
+    }
+
+    return handle;
+}
+
+uint32_t estun::Scene::AddPrototype(std::shared_ptr<Model> model)
+{
+    return AddEntry(model, false, false);
+}
+
+void estun::Scene::RemoveModel(uint32_t handle)
+{
+    auto it = entries_.find(handle);
+    if (it == entries_.end())
+    {
+        ES_CORE_WARN("Scene has no model with handle {0}", handle);
+        return;
+    }
+
+    // The LOD entries go first, erasing them leaves the iterator of the base model valid
+    const std::vector<uint32_t> lodHandles = it->second.lodHandles;
+    for (const uint32_t lodHandle : lodHandles)
+    {
+        RemoveModel(lodHandle);
+    }
+    if (!lodHandles.empty())
+    {
+        lodModelCount_--;
+        tlasDirty_ = true;
+    }
+
+    Entry &entry = it->second;
+    if (entry.resident)
+    {
+        // Frames in flight still read the ranges, they are handed back to the allocators afterwards
+        const ReleasedRanges ranges = {compactions_,
+                                       entry.vertexOffset, entry.vertexCount,
+                                       entry.indexOffset, entry.indexCount,
+                                       entry.materialIdOffset, entry.materialIdCount,
+                                       entry.materialOffset, entry.materialCount,
+                                       entry.clusterOffset, static_cast<uint32_t>(entry.clusters.size())};
+        std::weak_ptr<std::vector<ReleasedRanges>> released = released_;
+        DeviceLocator::GetDevice().GetDeletionQueue().Push([released, ranges]() {
+            if (auto list = released.lock())
+            {
+                list->push_back(ranges);
+            }
+        });
+        retired_.insert(retired_.end(), entry.blases.begin(), entry.blases.end());
+        tlasDirty_ = true;
+    }
+
+    entries_.erase(it);
+}
+
+uint32_t estun::Scene::AddMaterials(const std::vector<Material> &materials)
+{
+    const uint32_t offset = Allocate(materialAllocator_, materialBuffer_, static_cast<uint32_t>(materials.size()));
+    materialBuffer_->Write(offset, materials.data(), static_cast<uint32_t>(materials.size()));
+    return offset;
+}
+
+void estun::Scene::AddInstance(std::shared_ptr<BLAS> blas)
+{
+    instances_.push_back(blas);
+    tlasDirty_ = true;
+}
+
+void estun::Scene::AddScatter(std::shared_ptr<ScatterSet> scatter)
+{
+    scatterSets_.push_back(scatter);
+    tlasDirty_ = true;
+}
+
+void estun::Scene::Record(VkCommandBuffer commandBuffer)
+{
+    if (tlas_ == nullptr)
+    {
+        return;
+    }
+
+    if (!scatterSets_.empty() || lodModelCount_ > 0)
+    {
+        for (auto &scatter : scatterSets_)
+        {
+            scatter->Record(commandBuffer);
+        }
+        tlas_->Build(commandBuffer);
+    }
+    else if (config_.updatableTLAS)
+    {
+        tlas_->Update(commandBuffer);
+    }
+}
+
+void estun::Scene::Upload(Entry &entry)
+{
+    const PackedModel &packed = entry.packed;
+
+    entry.vertexOffset = Allocate(vertexAllocator_, positionBuffer_, entry.vertexCount);
+    // Attributes share the vertex allocation, only their buffer has to follow its capacity
+    if (attributeBuffer_->GetCapacity() != positionBuffer_->GetCapacity())
+    {
+        attributeBuffer_->Reallocate(positionBuffer_->GetCapacity(), {{0, 0, attributeBuffer_->GetCapacity()}});
+    }
+    entry.indexOffset = Allocate(indexAllocator_, indexBuffer_, entry.indexCount);
+    entry.materialIdOffset = Allocate(materialIdAllocator_, materialIdBuffer_, entry.materialIdCount);
+    entry.materialOffset = Allocate(materialAllocator_, materialBuffer_, entry.materialCount);
+    entry.clusterOffset = Allocate(clusterAllocator_, offsetBuffer_, static_cast<uint32_t>(entry.clusters.size()));
+
+    positionBuffer_->Write(entry.vertexOffset, packed.positions.data(), entry.vertexCount);
+    attributeBuffer_->Write(entry.vertexOffset, packed.attributes.data(), entry.vertexCount);
+    indexBuffer_->Write(entry.indexOffset, packed.indices.data(), entry.indexCount);
+    materialIdBuffer_->Write(entry.materialIdOffset, packed.materialIds.data(), entry.materialIdCount);
+    materialBuffer_->Write(entry.materialOffset, entry.model->GetMaterials().data(), entry.materialCount);
+    WriteOffsets(entry);
+}
+
+void estun::Scene::WriteOffsets(const Entry &entry)
+{
+    std::vector<MeshOffsets> offsets = entry.clusters;
+    for (auto &cluster : offsets)
+    {
+        cluster.vertexOffset += entry.vertexOffset;
+        cluster.indexOffset += entry.indexOffset * sizeof(uint32_t);
+        cluster.materialIdOffset += entry.materialIdOffset * sizeof(uint32_t);
+        cluster.lodOffset += entry.materialIdOffset * sizeof(uint32_t);
+        cluster.materialOffset += entry.materialOffset;
+    }
+
+    offsetBuffer_->Write(entry.clusterOffset, offsets.data(), static_cast<uint32_t>(offsets.size()));
+}
+
+std::vector<estun::BLASGeometry> estun::Scene::GetBLASGeometries(const Entry &entry) const
+{
+    std::vector<BLASGeometry> geometries;
+
+    for (size_t i = 0; i < entry.clusters.size(); i++)
+    {
+        BLASGeometry geometry = {};
+        geometry.vertexAddress = positionBuffer_->GetDeviceAddress();
+        geometry.vertexStride = sizeof(glm::vec3);
+        geometry.indexAddress = indexBuffer_->GetDeviceAddress();
+        geometry.indexType = entry.clusters[i].indexSize == sizeof(uint16_t) ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+        geometry.vertexCount = entry.vertexCount;
+        geometry.indexCount = entry.indexCounts[i];
+        geometry.vertexOffset = entry.vertexOffset + entry.clusters[i].vertexOffset;
+        geometry.indexOffset = entry.indexOffset * sizeof(uint32_t) + entry.clusters[i].indexOffset;
+        // A cached tree is built for the rest pose without update support
+        geometry.hash = entry.deformable ? 0 : entry.hashes[i];
+        geometry.allowUpdate = entry.deformable;
+        geometries.push_back(geometry);
+    }
+
+    return geometries;
+}
+
+void estun::Scene::BuildBLASes(Entry &entry)
+{
+    retired_.insert(retired_.end(), entry.blases.begin(), entry.blases.end());
+    entry.blases = BLAS::CreateBlases(GetBLASGeometries(entry), cache_);
+
+    for (size_t i = 0; i < entry.blases.size(); i++)
+    {
+        entry.blases[i]->SetCustomIndex(entry.clusterOffset + static_cast<uint32_t>(i));
+    }
+}
+
+void estun::Scene::FreeReleasedRanges()
+{
+    for (const auto &ranges : *released_)
+    {
+        // Compaction left the removed data behind in the previous buffers
+        if (ranges.compaction == compactions_)
+        {
+            vertexAllocator_.Free(ranges.vertexOffset, ranges.vertexCount);
+            indexAllocator_.Free(ranges.indexOffset, ranges.indexCount);
+            materialIdAllocator_.Free(ranges.materialIdOffset, ranges.materialIdCount);
+        }
+        materialAllocator_.Free(ranges.materialOffset, ranges.materialCount);
+        clusterAllocator_.Free(ranges.clusterOffset, ranges.clusterCount);
+    }
+    released_->clear();
+}
+
+bool estun::Scene::Commit(bool compact)
+{
+    FreeReleasedRanges();
+
+    const float threshold = config_.compactionThreshold;
+    if (compact ||
+        vertexAllocator_.GetFragmented() > threshold * vertexAllocator_.GetCapacity() ||
+        indexAllocator_.GetFragmented() > threshold * indexAllocator_.GetCapacity() ||
+        materialIdAllocator_.GetFragmented() > threshold * materialIdAllocator_.GetCapacity())
+    {
+        Compact();
+    }
+
+    std::vector<Entry *> pending;
+    for (auto &entry : entries_)
+    {
+        if (!entry.second.resident)
+        {
+            pending.push_back(&entry.second);
+        }
+    }
+
+    for (Entry *entry : pending)
+    {
+        Upload(*entry);
+    }
+
+    // Refits read their inputs through the device addresses captured at build time
+    if (buffersChanged_)
+    {
+        for (auto &entry : entries_)
+        {
+            if (entry.second.resident && entry.second.deformable)
+            {
+                BuildBLASes(entry.second);
+                tlasDirty_ = true;
+            }
+        }
+    }
+
+    if (hostBuilder_ != nullptr && cache_ != nullptr && !pending.empty())
+    {
+        // Host builds read the packed streams, so their offsets stay relative to the model
+        std::vector<BLASGeometry> hostGeometries;
+        for (const Entry *entry : pending)
+        {
+            std::vector<BLASGeometry> geometries = GetBLASGeometries(*entry);
+            for (size_t i = 0; i < geometries.size(); i++)
+            {
+                geometries[i].vertexOffset = entry->clusters[i].vertexOffset;
+                geometries[i].indexOffset = entry->clusters[i].indexOffset;
+                geometries[i].hostVertexData = entry->packed.positions.data();
+                geometries[i].hostIndexData = entry->packed.indices.data();
+            }
+            hostGeometries.insert(hostGeometries.end(), geometries.begin(), geometries.end());
+        }
+        hostBuilder_->Build(hostGeometries, cache_);
+    }
+
+    for (Entry *entry : pending)
+    {
+        BuildBLASes(*entry);
+        entry->packed = PackedModel();
+        entry->resident = true;
+        tlasDirty_ = true;
+    }
+
+    const bool changed = buffersChanged_ || tlasDirty_;
+
+    // The table hands the new buffers to each image's set once the frames reading the old ones are done
+    if (buffersChanged_)
+    {
+        WriteSlots();
+    }
+
+    if (tlasDirty_)
+    {
+        std::vector<std::shared_ptr<BLAS>> blases;
+        for (const auto &entry : entries_)
+        {
+            if (entry.second.instanced)
+            {
+                blases.insert(blases.end(), entry.second.blases.begin(), entry.second.blases.end());
+            }
+        }
+        blases.insert(blases.end(), instances_.begin(), instances_.end());
+
+        // Enough slots for the level with the most clusters, twice when secondary rays see other levels
+        for (auto &it : entries_)
+        {
+            Entry &entry = it.second;
+            if (entry.lodHandles.empty())
+            {
+                continue;
+            }
+
+            uint32_t clusterCount = static_cast<uint32_t>(entry.blases.size());
+            for (const uint32_t lodHandle : entry.lodHandles)
+            {
+                clusterCount = std::max(clusterCount, static_cast<uint32_t>(entries_.at(lodHandle).blases.size()));
+            }
+
+            entry.firstSlot = static_cast<uint32_t>(blases.size());
+            entry.slotCount = clusterCount;
+            entry.selectedLod = 0;
+            const uint32_t slots = config_.secondaryLodBias > 0 ? 2 * clusterCount : clusterCount;
+            for (uint32_t slot = 0; slot < slots; slot++)
+            {
+                blases.push_back(entry.blases.front());
+            }
+        }
+
+        uint32_t scatterCount = 0;
+        for (const auto &scatter : scatterSets_)
+        {
+            scatterCount += scatter->GetInstanceCount();
+        }
+
+        tlas_.reset();
+        if (!blases.empty() || scatterCount > 0)
+        {
+            tlas_ = std::make_shared<TLAS>(blases, config_.updatableTLAS || lodModelCount_ > 0, scatterCount);
+
+            // Every image starts at the full models until its first selection
+            const uint32_t imageCount = static_cast<uint32_t>(ContextLocator::GetSwapChain()->GetImageViews().size());
+            for (const auto &it : entries_)
+            {
+                if (it.second.lodHandles.empty())
+                {
+                    continue;
+                }
+                for (uint32_t image = 0; image < imageCount; image++)
+                {
+                    SelectLod(it.second, 0, image);
+                }
+            }
+
+            uint32_t firstInstance = static_cast<uint32_t>(blases.size());
+            for (auto &scatter : scatterSets_)
+            {
+                scatter->SetTarget(tlas_, firstInstance);
+                firstInstance += scatter->GetInstanceCount();
+            }
+        }
+    }
+
+    // The rebuilt TLAS no longer references them, frames still in flight are covered by the deletion queue
+    retired_.clear();
+
+    buffersChanged_ = false;
+    tlasDirty_ = false;
+
+    return changed;
+}
+
+void estun::Scene::WriteSlots()
+{
+    if (table_ == nullptr)
+    {
+        return;
+    }
+
+    table_->SetBuffer(bufferHandles_.attributes, *attributeBuffer_);
+    table_->SetBuffer(bufferHandles_.indices, *indexBuffer_);
+    table_->SetBuffer(bufferHandles_.materials, *materialBuffer_);
+    table_->SetBuffer(bufferHandles_.offsets, *offsetBuffer_);
+    table_->SetBuffer(bufferHandles_.materialIds, *materialIdBuffer_);
+}
+
+void estun::Scene::Compact()
+{
+    const auto start = std::chrono::high_resolution_clock::now();
+
+    std::vector<VkBufferCopy> vertexRegions;
+    std::vector<VkBufferCopy> indexRegions;
+    std::vector<VkBufferCopy> materialIdRegions;
+    uint32_t vertexEnd = 0;
+    uint32_t indexEnd = 0;
+    uint32_t materialIdEnd = 0;
+
+    // Resident models are packed to the front in handle order, pending ones own no ranges yet
+    for (auto &it : entries_)
+    {
+        Entry &entry = it.second;
+        if (!entry.resident)
+        {
+            continue;
+        }
+
+        vertexRegions.push_back({entry.vertexOffset, vertexEnd, entry.vertexCount});
+        indexRegions.push_back({entry.indexOffset, indexEnd, entry.indexCount});
+        materialIdRegions.push_back({entry.materialIdOffset, materialIdEnd, entry.materialIdCount});
+
+        entry.vertexOffset = vertexEnd;
+        entry.indexOffset = indexEnd;
+        entry.materialIdOffset = entry.materialIdCount > 0 ? materialIdEnd : 0;
+        vertexEnd += entry.vertexCount;
+        indexEnd += entry.indexCount;
+        materialIdEnd += entry.materialIdCount;
+    }
+
+    positionBuffer_->Reallocate(vertexAllocator_.GetCapacity(), vertexRegions);
+    attributeBuffer_->Reallocate(vertexAllocator_.GetCapacity(), vertexRegions);
+    indexBuffer_->Reallocate(indexAllocator_.GetCapacity(), indexRegions);
+    materialIdBuffer_->Reallocate(materialIdAllocator_.GetCapacity(), materialIdRegions);
+
+    vertexAllocator_.Reset(vertexAllocator_.GetCapacity(), vertexEnd);
+    indexAllocator_.Reset(indexAllocator_.GetCapacity(), indexEnd);
+    materialIdAllocator_.Reset(materialIdAllocator_.GetCapacity(), materialIdEnd);
+
+    // Frames in flight read the offsets of the old layout, the new ones go into a new table
+    offsetBuffer_->Reallocate(clusterAllocator_.GetCapacity(), {{0, 0, clusterAllocator_.GetCapacity()}});
+    compactions_++;
+
+    // Built structures do not reference their inputs, only the tables have to follow
+    for (const auto &entry : entries_)
+    {
+        if (entry.second.resident)
+        {
+            WriteOffsets(entry.second);
+        }
+    }
+
+    buffersChanged_ = true;
+
+    const auto elapsed = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    ES_CORE_INFO("Scene compacted to {0} vertices and {1} index words in {2} ms", vertexEnd, indexEnd, elapsed);
+}
+
+estun::DeformTarget estun::Scene::GetDeformTarget(uint32_t handle) const
+{
+    const Entry &entry = entries_.at(handle);
+    return DeformTarget{positionBuffer_, attributeBuffer_, entry.vertexOffset, entry.blases};
+}
+
+void estun::Scene::WriteLodSlots(VkAccelerationStructureInstanceKHR *instances, const Entry &entry, uint32_t firstSlot, uint32_t lod, uint32_t mask) const
+{
+    const auto &lodBlases = lod == 0 ? entry.blases : entries_.at(entry.lodHandles[lod - 1]).blases;
+
+    for (uint32_t slot = 0; slot < entry.slotCount; slot++)
+    {
+        VkAccelerationStructureInstanceKHR &instance = instances[firstSlot + slot];
+        if (slot >= lodBlases.size())
+        {
+            instance.mask = 0;
+            continue;
+        }
+
+        instance.accelerationStructureReference = lodBlases[slot]->GetDeviceAddress();
+        instance.instanceCustomIndex = lodBlases[slot]->GetCustomIndex();
+        instance.instanceShaderBindingTableRecordOffset = lodBlases[slot]->GetHitGroup();
+        instance.mask = mask;
+    }
+}
+
+void estun::Scene::SelectLod(const Entry &entry, uint32_t lod, uint32_t imageIndex)
+{
+    VkAccelerationStructureInstanceKHR *instances = tlas_->GetInstances(imageIndex);
+    const uint32_t lastLod = static_cast<uint32_t>(entry.lodHandles.size());
+
+    if (config_.secondaryLodBias == 0)
+    {
+        WriteLodSlots(instances, entry, entry.firstSlot, lod, 0xFF);
+        return;
+    }
+
+    WriteLodSlots(instances, entry, entry.firstSlot, lod, PrimaryRayMask);
+    WriteLodSlots(instances, entry, entry.firstSlot + entry.slotCount, std::min(lod + config_.secondaryLodBias, lastLod), SecondaryRayMask);
+}
+
+void estun::Scene::SelectLods(const glm::vec3 &cameraPosition, float pixelsPerUnit, float maxPixelError, uint32_t imageIndex)
+{
+    if (tlas_ == nullptr || lodModelCount_ == 0)
+    {
+        return;
+    }
+
+    for (auto &it : entries_)
+    {
+        Entry &entry = it.second;
+        if (entry.lodHandles.empty() || !entry.resident)
+        {
+            continue;
+        }
+
+        // Closest point of the bounding sphere, the camera inside it sees the full model
+        const float distance = glm::length(entry.center - cameraPosition) - entry.radius;
+        uint32_t lod = 0;
+        if (distance > 0.0f)
+        {
+            while (lod < entry.lodErrors.size() && entry.lodErrors[lod] * pixelsPerUnit / distance <= maxPixelError)
+            {
+                lod++;
+            }
+        }
+
+        entry.selectedLod = lod;
+        SelectLod(entry, lod, imageIndex);
+    }
+}
+
+uint32_t estun::Scene::GetInstanceIndex(const std::shared_ptr<BLAS> &blas) const
+{
+    // Commit places the models' BLASes in handle order ahead of the instances
+    uint32_t index = 0;
+    for (const auto &entry : entries_)
+    {
+        if (entry.second.instanced)
+        {
+            index += static_cast<uint32_t>(entry.second.blases.size());
+        }
+    }
+
+    const auto it = std::find(instances_.begin(), instances_.end(), blas);
+    if (it == instances_.end())
+    {
+        ES_CORE_WARN("BLAS is not an instance of the scene");
+        return std::numeric_limits<uint32_t>::max();
+    }
+
+    return index + static_cast<uint32_t>(it - instances_.begin());
+}
+
+VkDeviceSize estun::Scene::GetSize() const
+{
+    return positionBuffer_->GetCapacity() * sizeof(glm::vec3) +
+           attributeBuffer_->GetCapacity() * sizeof(CompactVertex) +
+           indexBuffer_->GetCapacity() * sizeof(uint32_t) +
+           materialIdBuffer_->GetCapacity() * sizeof(uint32_t) +
+           materialBuffer_->GetCapacity() * sizeof(Material) +
+           offsetBuffer_->GetCapacity() * sizeof(MeshOffsets);
+}
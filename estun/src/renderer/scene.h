@@ -0,0 +1,214 @@
+#pragma once
+
+#include "renderer/common.h"
+#include "renderer/deformable_mesh.h"
+#include "renderer/buffers/compact_geometry.h"
+#include "renderer/buffers/growable_buffer.h"
+#include "renderer/buffers/range_allocator.h"
+#include "renderer/material/material.h"
+#include "renderer/ray_tracing/bottom_level_acceleration_structure.h"
+
+namespace estun
+{
+
+    class Model;
+    class TLAS;
+    class AccelerationStructureCache;
+    class HostBLASBuilder;
+    class ScatterSet;
+    class ResourceTable;
+
+    // Resource table slots of the streams the hit shaders read, stable for the lifetime of the scene
+    struct SceneBufferHandles
+    {
+        uint32_t attributes = 0;
+        uint32_t indices = 0;
+        uint32_t materials = 0;
+        uint32_t offsets = 0;
+        uint32_t materialIds = 0;
+    };
+
+    struct SceneConfig
+    {
+        ClusterConfig clusters;
+        // Initial capacities in elements, index and material id streams count whole words
+        uint32_t vertexCapacity = 1 << 16;
+        uint32_t indexCapacity = 1 << 16;
+        uint32_t materialIdCapacity = 1 << 12;
+        uint32_t materialCapacity = 256;
+        uint32_t clusterCapacity = 256;
+        // Holes left by removed models, relative to a stream's capacity, that make Commit compact the streams
+        float compactionThreshold = 0.25f;
+        bool updatableTLAS = false;
+        // Secondary rays trace models with LODs this many levels coarser, see PrimaryRayMask
+        uint32_t secondaryLodBias = 0;
+    };
+
+    // Owns every model's compact streams in growable device local megabuffers. Models are placed in
+    // free ranges so adding or removing one only uploads its own data, rewrites its entries of the
+    // offset and material tables and builds its own BLASes, followed by a TLAS rebuild.
+    class Scene
+    {
+    public:
+        // Cull masks of main.rgen, only LOD instances of models traced coarser by secondary rays tell them apart
+        static const uint32_t PrimaryRayMask = 0x01;
+        static const uint32_t SecondaryRayMask = 0x02;
+
+        Scene(const Scene &) = delete;
+        Scene(Scene &&) = delete;
+        Scene &operator=(const Scene &) = delete;
+        Scene &operator=(Scene &&) = delete;
+
+        // With a resource table the streams read by the hit shaders get a slot each, kept current by Commit
+        Scene(const SceneConfig &config = SceneConfig(), std::shared_ptr<AccelerationStructureCache> cache = nullptr, std::shared_ptr<HostBLASBuilder> hostBuilder = nullptr,
+              std::shared_ptr<ResourceTable> table = nullptr);
+        ~Scene();
+
+        // The model is packed right away and reaches the device on the next Commit. The LODs of a rigid
+        // model come along and share its instances, which SelectLods switches between.
+        uint32_t AddModel(std::shared_ptr<Model> model, bool deformable = false);
+        // Uploaded and built like a model but only instanced through scatter sets
+        uint32_t AddPrototype(std::shared_ptr<Model> model);
+        void RemoveModel(uint32_t handle);
+
+        // Materials addressed by absolute index, e.g. from procedural geometry, compaction never moves them
+        uint32_t AddMaterials(const std::vector<Material> &materials);
+        // BLASes built outside the scene, instanced after the scene's own
+        void AddInstance(std::shared_ptr<BLAS> blas);
+        // Device expanded instances placed after all others, the TLAS is then fully built by Record every frame
+        void AddScatter(std::shared_ptr<ScatterSet> scatter);
+
+        // Compacts when forced or too fragmented, uploads pending models and rebuilds the TLAS without
+        // waiting for the frames in flight: compaction and growth copy into new buffers, and uploads only
+        // reuse ranges of removed models once the frames that read them are done. Returns true when
+        // buffers or the TLAS were replaced, so descriptors and recorded commands are stale and deformable
+        // meshes need their new targets. Slots in the resource table follow on their own and stay valid.
+        bool Commit(bool compact = false);
+
+        // Picks the coarsest LOD of every model whose error stays below maxPixelError on screen and writes it to
+        // the image's instances. pixelsPerUnit is the projected size of one unit at distance one.
+        void SelectLods(const glm::vec3 &cameraPosition, float pixelsPerUnit, float maxPixelError, uint32_t imageIndex);
+        uint32_t GetSelectedLod(uint32_t handle) const { return entries_.at(handle).selectedLod; }
+
+        // Records scatter expansion and the TLAS build, a build when LODs may have switched, or a refit
+        void Record(VkCommandBuffer commandBuffer);
+
+        uint32_t GetModelCount() const { return static_cast<uint32_t>(entries_.size()); }
+        DeformTarget GetDeformTarget(uint32_t handle) const;
+        // Position of an added instance in the current TLAS, changes whenever Commit rebuilt it
+        uint32_t GetInstanceIndex(const std::shared_ptr<BLAS> &blas) const;
+        const std::vector<std::shared_ptr<BLAS>> &GetBLASes(uint32_t handle) const { return entries_.at(handle).blases; }
+
+        std::shared_ptr<GrowableBuffer<glm::vec3>> GetPositionBuffer() { return positionBuffer_; }
+        std::shared_ptr<GrowableBuffer<CompactVertex>> GetAttributeBuffer() { return attributeBuffer_; }
+        std::shared_ptr<GrowableBuffer<uint32_t>> GetIndexBuffer() { return indexBuffer_; }
+        std::shared_ptr<GrowableBuffer<uint32_t>> GetMaterialIdBuffer() { return materialIdBuffer_; }
+        std::shared_ptr<GrowableBuffer<Material>> GetMaterialBuffer() { return materialBuffer_; }
+        std::shared_ptr<GrowableBuffer<MeshOffsets>> GetOffsetBuffer() { return offsetBuffer_; }
+        std::shared_ptr<TLAS> GetTLAS() { return tlas_; }
+        const SceneBufferHandles &GetBufferHandles() const { return bufferHandles_; }
+
+        VkDeviceSize GetSize() const;
+
+    private:
+        struct Entry
+        {
+            std::shared_ptr<Model> model;
+            // Host streams are dropped once uploaded
+            PackedModel packed;
+            bool deformable = false;
+            bool instanced = true;
+
+            // Models with LODs are instanced through slots that hold the BLASes of the selected level
+            std::vector<uint32_t> lodHandles;
+            std::vector<float> lodErrors;
+            glm::vec3 center = glm::vec3(0.0f);
+            float radius = 0.0f;
+            uint32_t firstSlot = 0;
+            uint32_t slotCount = 0;
+            uint32_t selectedLod = 0;
+            bool resident = false;
+
+            uint32_t vertexOffset = 0;
+            uint32_t vertexCount = 0;
+            uint32_t indexOffset = 0;
+            uint32_t indexCount = 0;
+            uint32_t materialIdOffset = 0;
+            uint32_t materialIdCount = 0;
+            uint32_t materialOffset = 0;
+            uint32_t materialCount = 0;
+            uint32_t clusterOffset = 0;
+
+            std::vector<MeshOffsets> clusters;
+            std::vector<uint32_t> indexCounts;
+            std::vector<uint64_t> hashes;
+            std::vector<std::shared_ptr<BLAS>> blases;
+        };
+
+        // Ranges of a removed model, the streams drop the first three when they were compacted since
+        struct ReleasedRanges
+        {
+            uint64_t compaction;
+            uint32_t vertexOffset;
+            uint32_t vertexCount;
+            uint32_t indexOffset;
+            uint32_t indexCount;
+            uint32_t materialIdOffset;
+            uint32_t materialIdCount;
+            uint32_t materialOffset;
+            uint32_t materialCount;
+            uint32_t clusterOffset;
+            uint32_t clusterCount;
+        };
+
+        uint32_t AddEntry(std::shared_ptr<Model> model, bool deformable, bool instanced);
+        void FreeReleasedRanges();
+
+        template <class T>
+        uint32_t Allocate(RangeAllocator &allocator, std::shared_ptr<GrowableBuffer<T>> &buffer, uint32_t size);
+
+        void Compact();
+        void Upload(Entry &entry);
+        void WriteOffsets(const Entry &entry);
+        std::vector<BLASGeometry> GetBLASGeometries(const Entry &entry) const;
+        void BuildBLASes(Entry &entry);
+        void WriteLodSlots(VkAccelerationStructureInstanceKHR *instances, const Entry &entry, uint32_t firstSlot, uint32_t lod, uint32_t mask) const;
+        void SelectLod(const Entry &entry, uint32_t lod, uint32_t imageIndex);
+        void WriteSlots();
+
+        SceneConfig config_;
+        std::shared_ptr<AccelerationStructureCache> cache_;
+        std::shared_ptr<HostBLASBuilder> hostBuilder_;
+        std::shared_ptr<ResourceTable> table_;
+        SceneBufferHandles bufferHandles_;
+
+        std::map<uint32_t, Entry> entries_;
+        uint32_t nextHandle_ = 0;
+        std::vector<std::shared_ptr<BLAS>> instances_;
+        std::vector<std::shared_ptr<ScatterSet>> scatterSets_;
+        uint32_t lodModelCount_ = 0;
+        // Structures of removed or rebuilt models stay alive until Commit replaced the TLAS that references them
+        std::vector<std::shared_ptr<BLAS>> retired_;
+        // Filled by the deletion queue once no frame in flight reads the ranges any more
+        std::shared_ptr<std::vector<ReleasedRanges>> released_ = std::make_shared<std::vector<ReleasedRanges>>();
+        uint64_t compactions_ = 0;
+
+        RangeAllocator vertexAllocator_;
+        RangeAllocator indexAllocator_;
+        RangeAllocator materialIdAllocator_;
+        RangeAllocator materialAllocator_;
+        RangeAllocator clusterAllocator_;
+
+        std::shared_ptr<GrowableBuffer<glm::vec3>> positionBuffer_;
+        std::shared_ptr<GrowableBuffer<CompactVertex>> attributeBuffer_;
+        std::shared_ptr<GrowableBuffer<uint32_t>> indexBuffer_;
+        std::shared_ptr<GrowableBuffer<uint32_t>> materialIdBuffer_;
+        std::shared_ptr<GrowableBuffer<Material>> materialBuffer_;
+        std::shared_ptr<GrowableBuffer<MeshOffsets>> offsetBuffer_;
+        std::shared_ptr<TLAS> tlas_;
+
+        bool buffersChanged_ = false;
+        bool tlasDirty_ = false;
+    };
+
+} // namespace estun
@@ -0,0 +1,148 @@
+#include "renderer/scene_graph.h"
+#include "renderer/ray_tracing/top_level_acceleration_structure.h"
+#include "core/core.h"
+#include "core/thread_pool.h"
+
+#include <atomic>
+
+namespace
+{
+    // Small enough to balance uneven levels, large enough to keep submission overhead below the work
+    const uint32_t chunkSize = 4096;
+}
+
+estun::SceneGraph::SceneGraph(std::shared_ptr<ThreadPool> pool)
+    : pool_(pool)
+{
+}
+
+estun::SceneGraph::~SceneGraph()
+{
+    pool_.reset();
+}
+
+void estun::SceneGraph::ParallelFor(uint32_t count, const std::function<void(uint32_t begin, uint32_t end)> &function)
+{
+    if (pool_ == nullptr)
+    {
+        function(0, count);
+        return;
+    }
+    pool_->ParallelFor(count, chunkSize, function);
+}
+
+uint32_t estun::SceneGraph::CreateNode(uint32_t parent, const glm::mat4 &local)
+{
+    if (parent != InvalidNode && parent >= parents_.size())
+    {
+        ES_CORE_ASSERT("Scene graph parent does not exist");
+        return InvalidNode;
+    }
+
+    const uint32_t node = static_cast<uint32_t>(parents_.size());
+    const uint32_t depth = parent == InvalidNode ? 0 : depths_[parent] + 1;
+
+    locals_.push_back(local);
+    worlds_.push_back(local);
+    parents_.push_back(parent);
+    depths_.push_back(depth);
+    instances_.push_back(InvalidNode);
+    dirty_.push_back(1);
+    stamps_.push_back(0);
+
+    if (depth >= levels_.size())
+    {
+        levels_.resize(depth + 1);
+    }
+    levels_[depth].push_back(node);
+
+    return node;
+}
+
+void estun::SceneGraph::SetLocal(uint32_t node, const glm::mat4 &local)
+{
+    locals_[node] = local;
+    dirty_[node] = 1;
+}
+
+void estun::SceneGraph::SetInstance(uint32_t node, uint32_t instanceIndex)
+{
+    if (instances_[node] == InvalidNode)
+    {
+        instanceNodes_.push_back(node);
+    }
+    instances_[node] = instanceIndex;
+    // Stamps the node again so every image's array receives it at its new index
+    dirty_[node] = 1;
+}
+
+void estun::SceneGraph::Invalidate()
+{
+    std::fill(written_.begin(), written_.end(), 0);
+    for (const uint32_t node : instanceNodes_)
+    {
+        dirty_[node] = 1;
+    }
+}
+
+uint32_t estun::SceneGraph::Flatten(TLAS &tlas, uint32_t imageIndex)
+{
+    frame_++;
+
+    // Parents are finished a level earlier, so a node sees whether its own parent moved this flatten
+    for (const auto &level : levels_)
+    {
+        ParallelFor(static_cast<uint32_t>(level.size()), [this, &level](uint32_t begin, uint32_t end) {
+            for (uint32_t i = begin; i < end; i++)
+            {
+                const uint32_t node = level[i];
+                const uint32_t parent = parents_[node];
+                const bool parentMoved = parent != InvalidNode && stamps_[parent] == frame_;
+                if (!dirty_[node] && !parentMoved)
+                {
+                    continue;
+                }
+
+                worlds_[node] = parent == InvalidNode ? locals_[node] : worlds_[parent] * locals_[node];
+                stamps_[node] = frame_;
+                dirty_[node] = 0;
+            }
+        });
+    }
+
+    if (imageIndex >= written_.size())
+    {
+        written_.resize(imageIndex + 1, 0);
+    }
+
+    VkAccelerationStructureInstanceKHR *instances = tlas.GetInstances(imageIndex);
+    if (instances == nullptr)
+    {
+        return 0;
+    }
+
+    const uint64_t written = written_[imageIndex];
+    const uint32_t instanceCount = tlas.GetInstanceCount();
+    std::atomic<uint32_t> writeCount(0);
+
+    ParallelFor(static_cast<uint32_t>(instanceNodes_.size()), [&](uint32_t begin, uint32_t end) {
+        uint32_t count = 0;
+        for (uint32_t i = begin; i < end; i++)
+        {
+            const uint32_t node = instanceNodes_[i];
+            // Bindings past the end belong to a TLAS that was replaced and not rebound yet
+            if (stamps_[node] <= written || instances_[node] >= instanceCount)
+            {
+                continue;
+            }
+
+            instances[instances_[node]].transform = TLAS::ToTransformMatrix(worlds_[node]);
+            count++;
+        }
+        writeCount += count;
+    });
+
+    written_[imageIndex] = frame_;
+
+    return writeCount;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "renderer/common.h"
+#include "includes/glm.h"
+
+namespace estun
+{
+
+    class ThreadPool;
+    class TLAS;
+
+    // Parent and child transforms kept as parallel arrays indexed by node. Nodes are grouped by depth so a
+    // level only depends on the one above it, and flattening walks the levels top down, splitting each one
+    // across the pool. Only nodes that were changed, or whose parent changed, are multiplied again.
+    class SceneGraph
+    {
+    public:
+        SceneGraph(const SceneGraph &) = delete;
+        SceneGraph(SceneGraph &&) = delete;
+        SceneGraph &operator=(const SceneGraph &) = delete;
+        SceneGraph &operator=(SceneGraph &&) = delete;
+
+        static const uint32_t InvalidNode = std::numeric_limits<uint32_t>::max();
+
+        explicit SceneGraph(std::shared_ptr<ThreadPool> pool = nullptr);
+        ~SceneGraph();
+
+        uint32_t CreateNode(uint32_t parent = InvalidNode, const glm::mat4 &local = glm::mat4(1.0f));
+
+        void SetLocal(uint32_t node, const glm::mat4 &local);
+        const glm::mat4 &GetLocal(uint32_t node) const { return locals_[node]; }
+        // Valid after the Flatten that followed the last change
+        const glm::mat4 &GetWorld(uint32_t node) const { return worlds_[node]; }
+
+        // Drives the transform of a TLAS instance, rebind after the TLAS was rebuilt with other indices
+        void SetInstance(uint32_t node, uint32_t instanceIndex);
+        // Writes every bound instance again on the next Flatten of each image, e.g. for a new TLAS
+        void Invalidate();
+
+        // Updates dirty subtrees and writes the transforms the image's instance array has not seen yet.
+        // Returns the number of instances written, the TLAS needs a refit when it is not zero.
+        uint32_t Flatten(TLAS &tlas, uint32_t imageIndex);
+
+        uint32_t GetNodeCount() const { return static_cast<uint32_t>(parents_.size()); }
+
+    private:
+        void ParallelFor(uint32_t count, const std::function<void(uint32_t begin, uint32_t end)> &function);
+
+        std::shared_ptr<ThreadPool> pool_;
+
+        std::vector<glm::mat4> locals_;
+        std::vector<glm::mat4> worlds_;
+        std::vector<uint32_t> parents_;
+        std::vector<uint32_t> depths_;
+        std::vector<uint32_t> instances_;
+        // Bytes rather than bits so neighbouring nodes can be written from different threads
+        std::vector<uint8_t> dirty_;
+        // Flatten that last changed the world transform of a node
+        std::vector<uint64_t> stamps_;
+
+        std::vector<std::vector<uint32_t>> levels_;
+        std::vector<uint32_t> instanceNodes_;
+
+        uint64_t frame_ = 0;
+        // Flatten that last wrote each image's instance array
+        std::vector<uint64_t> written_;
+    };
+
+} // namespace estun
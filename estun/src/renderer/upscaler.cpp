@@ -0,0 +1,86 @@
+#include "renderer/upscaler.h"
+#include "renderer/context.h"
+#include "renderer/context/image.h"
+#include "renderer/context/base_image.h"
+#include "renderer/material/compute_pipeline.h"
+#include "renderer/material/descriptor.h"
+#include "renderer/material/descriptor_binding.h"
+
+namespace
+{
+    const uint32_t groupSize = 8;
+}
+
+estun::Upscaler::Upscaler(const std::string &shaderName, float sharpness)
+    : shaderName_(shaderName)
+{
+    ubo_ = {};
+    ubo_.sharpness = sharpness;
+
+    const size_t imageCount = ContextLocator::GetSwapChain()->GetImageViews().size();
+    uniformBuffers_ = std::vector<UniformBuffer<UpscaleUBO>>(imageCount);
+}
+
+estun::Upscaler::~Upscaler()
+{
+    pipeline_.reset();
+    descriptor_.reset();
+    uniformBuffers_.clear();
+    source_.reset();
+    target_.reset();
+}
+
+void estun::Upscaler::SetImages(std::shared_ptr<Image> source, std::shared_ptr<Image> target)
+{
+    source_ = source;
+    target_ = target;
+
+    // Every image traces the whole source until its frame sets a smaller extent
+    ubo_.sourceExtent = glm::uvec2(source_->GetImage().GetWidth(), source_->GetImage().GetHeight());
+    ubo_.targetExtent = glm::uvec2(target_->GetImage().GetWidth(), target_->GetImage().GetHeight());
+    for (auto &uniformBuffer : uniformBuffers_)
+    {
+        uniformBuffer.SetValue(ubo_);
+    }
+
+    std::vector<DescriptorBinding> bindings = {
+        DescriptorBinding::StorageImage(0, source_, VK_SHADER_STAGE_COMPUTE_BIT),
+        DescriptorBinding::StorageImage(1, target_, VK_SHADER_STAGE_COMPUTE_BIT),
+        DescriptorBinding::Uniform(2, uniformBuffers_, VK_SHADER_STAGE_COMPUTE_BIT)};
+
+    if (descriptor_ == nullptr)
+    {
+        descriptor_ = std::make_shared<Descriptor>(bindings, uniformBuffers_.size());
+        pipeline_ = std::make_shared<ComputePipeline>(shaderName_, descriptor_);
+    }
+    else
+    {
+        descriptor_->Update(bindings);
+    }
+}
+
+void estun::Upscaler::SetSourceExtent(const VkExtent2D &sourceExtent, uint32_t imageIndex)
+{
+    if (source_ == nullptr)
+    {
+        return;
+    }
+
+    ubo_.sourceExtent = glm::uvec2(
+        std::min(sourceExtent.width, source_->GetImage().GetWidth()),
+        std::min(sourceExtent.height, source_->GetImage().GetHeight()));
+    uniformBuffers_[imageIndex].SetValue(ubo_);
+}
+
+void estun::Upscaler::Record(VkCommandBuffer commandBuffer)
+{
+    if (pipeline_ == nullptr)
+    {
+        ES_CORE_ASSERT("Upscaler has no images");
+        return;
+    }
+
+    pipeline_->Bind(commandBuffer);
+    descriptor_->Bind(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE);
+    vkCmdDispatch(commandBuffer, (ubo_.targetExtent.x + groupSize - 1) / groupSize, (ubo_.targetExtent.y + groupSize - 1) / groupSize, 1);
+}
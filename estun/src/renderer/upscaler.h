@@ -0,0 +1,60 @@
+#pragma once
+
+#include "renderer/common.h"
+#include "renderer/buffers/uniform_buffer.h"
+#include "includes/glm.h"
+
+namespace estun
+{
+
+    class Image;
+    class Descriptor;
+    class ComputePipeline;
+
+    // Matches UpscaleUBO in upscale.comp
+    struct UpscaleUBO
+    {
+        glm::uvec2 sourceExtent;
+        glm::uvec2 targetExtent;
+        float sharpness;
+    };
+
+    // Scales the rendered part of an image up to the whole of another with a compute shader. The source
+    // is filtered bilinearly and sharpened against its neighbourhood, limited to the neighbourhood's
+    // range so edges do not ring. Both images are storage images in the general layout.
+    class Upscaler
+    {
+    public:
+        Upscaler(const Upscaler &) = delete;
+        Upscaler(Upscaler &&) = delete;
+
+        Upscaler &operator=(const Upscaler &) = delete;
+        Upscaler &operator=(Upscaler &&) = delete;
+
+        Upscaler(const std::string &shaderName, float sharpness = 0.25f);
+        ~Upscaler();
+
+        // Called again whenever either image is replaced, no frame may use the previous ones anymore
+        void SetImages(std::shared_ptr<Image> source, std::shared_ptr<Image> target);
+
+        // Top left part of the source the image's frame traced, a new extent needs no recording
+        void SetSourceExtent(const VkExtent2D &sourceExtent, uint32_t imageIndex);
+        // Taken by the next SetSourceExtent, zero only filters
+        void SetSharpness(float sharpness) { ubo_.sharpness = sharpness; }
+
+        // Scales the source extent of the image being recorded to the whole target
+        void Record(VkCommandBuffer commandBuffer);
+
+    private:
+        std::string shaderName_;
+        UpscaleUBO ubo_;
+
+        std::shared_ptr<Image> source_;
+        std::shared_ptr<Image> target_;
+
+        std::vector<UniformBuffer<UpscaleUBO>> uniformBuffers_;
+        std::shared_ptr<Descriptor> descriptor_;
+        std::shared_ptr<ComputePipeline> pipeline_;
+    };
+
+} // namespace estun
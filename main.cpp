@@ -1,12 +1,15 @@
 #include "estun.h"
 
 #include <GLFW/glfw3.h>
+#include <chrono>
 #include <iostream>
+#include <random>
 #include <unordered_map>
 #include "tiny_obj_loader.h"
 #include "time.h"
 
 #include "cornell_box.h"
+#include "water_surface.h"
 
 #define WIDTH 800
 #define HEIGHT 800
@@ -25,6 +28,8 @@ void mouse_callback(double xpos, double ypos);
 void scroll_callback(double xoffset, double yoffset);
 void mouse_button_callback(int button, int action, int mods);
 void framebuffer_size_callback(int width, int height);
+void RunSphereBenchmark(uint32_t count);
+bool RunScene(std::shared_ptr<estun::Context> context);
 
 estun::WindowConfig winConf = {"Ray tracing", WIDTH, HEIGHT, "assets/textures/icon.png", false, false, true};
 estun::GameInfo info("test", {0, 0, 1}, WIDTH, HEIGHT, false, false, true);
@@ -40,6 +45,9 @@ struct CameraUBO
     uint32_t totalNumberOfSamples;
     uint32_t numberOfSamples;
     uint32_t numberOfBounces;
+    // Top left part of the store image the frame traces
+    uint32_t traceWidth;
+    uint32_t traceHeight;
 };
 /*
 glm::mat4 modelView;
@@ -59,11 +67,69 @@ uint32_t hasSky;
 int surface_size = 256;
 float surface_scale = 10.0f;
 bool wireframe = false;
+// P starts the water, the twisting box and the bobbing sphere, animated frames can not accumulate samples
+bool animateScene = false;
+float sceneTime = 0.0f;
+
+// B adds or removes an extra model at runtime
+const uint32_t noModel = std::numeric_limits<uint32_t>::max();
+uint32_t extraModelHandle = noModel;
+bool toggleExtraModel = false;
 
 uint32_t maxNumberOfSamples = 4096;
-uint32_t numberOfSamples = 4;
+// Samples per pixel and frame, the sample controller picks them within these bounds while the camera is still
+uint32_t minSamplesPerFrame = 1;
+uint32_t maxSamplesPerFrame = 32;
 bool restartSampling = true;
 
+enum SpecializationIds
+{
+    MaxSamplesId = 0,
+    MaxBouncesId = 1,
+    UseTexturesId = 2,
+    AttributeBufferId = 3,
+    IndexBufferId = 4,
+    MaterialBufferId = 5,
+    OffsetBufferId = 6,
+    MaterialIdBufferId = 7,
+};
+
+// Timed parts of a frame, the trace is timed on its own for the samples it can afford
+enum TimerIntervals
+{
+    FrameInterval = 0,
+    TraceInterval = 1,
+};
+
+// Instance SBT offsets, in the order of the hit groups below
+enum HitGroups
+{
+    TriangleHitGroup = 0,
+    SphereHitGroup = 1,
+    WaterHitGroup = 2,
+};
+
+struct QualityPreset
+{
+    uint32_t samples;
+    uint32_t bounces;
+    bool textures;
+};
+
+std::map<std::string, QualityPreset> presets = {
+    {"preview", {minSamplesPerFrame, 2, false}},
+    {"final", {maxSamplesPerFrame, 4, true}}};
+
+// Seconds without camera input before switching back to the final preset
+float previewHoldTime = 0.25f;
+float lastMoveTime = 0.0f;
+
+// Largest projected LOD error, in pixels, before a finer level is traced
+float maxLodPixelError = 1.0f;
+
+// Device time per frame, the trace resolution is scaled for it while moving and the samples fill it while still
+float targetFrameTime = 1000.0f / 60.0f;
+
 int main(int argc, const char **argv)
 {
     estun::Log::Init();
@@ -78,6 +144,34 @@ int main(int argc, const char **argv)
     std::shared_ptr<estun::Context> context = std::make_shared<estun::Context>(window->GetWindow(), &info);
     estun::ContextLocator::Provide(context.get());
 
+    if (argc > 1 && std::string(argv[1]) == "--sphere-benchmark")
+    {
+        RunSphereBenchmark(argc > 2 ? static_cast<uint32_t>(std::stoul(argv[2])) : 1000000);
+        context->Clear();
+        window.reset();
+        context.reset();
+        return 0;
+    }
+
+    // A swap chain with another image count changes the size of everything created per image,
+    // the scene is then built again from scratch
+    while (RunScene(context))
+    {
+    }
+
+    context->Clear();
+    window.reset();
+    context.reset();
+    return 0;
+}
+
+// Builds the scene and draws it until the window closes, true when it has to be built again
+bool RunScene(std::shared_ptr<estun::Context> context)
+{
+    // Handles of the previous scene mean nothing to the new one
+    extraModelHandle = noModel;
+    restartSampling = true;
+
     CameraUBO camUBO = {};
     camUBO.numberOfBounces = 4;
     camUBO.totalNumberOfSamples = 0;
@@ -107,92 +201,267 @@ int main(int argc, const char **argv)
     transform = glm::rotate(transform, glm::radians(25.0f), glm::vec3(0.0f, 1.0f, 0.0f));
     transform = glm::translate(transform, glm::vec3(-0.2f * box_scale, -0.5f * box_scale, -2.0f));
     models.back()->Transform(transform);
-    models.push_back(std::make_shared<estun::Model>(estun::Model::CreateSphere(glm::vec3(0.0f), 0.4f, colorMaterial)));
-    transform = glm::translate(glm::mat4(1.0f), glm::vec3(0.2f * box_scale, -0.5f * box_scale + 0.4f, -2.0f));
-    models.back()->Transform(transform);
-
-    std::vector<estun::Texture> textures;
+    const size_t twistedBoxIndex = models.size() - 1;
+
+    // Models loaded with LoadModel request their MTL maps here, decoding starts right away. Block compressed
+    // maps are encoded on the first run only, later runs upload them from the cache as they are.
+    // Streaming uploads only the small levels before the first frame and adds the rest as the hits ask for them.
+    // Textures and scene streams live in the bindless resource table, so new ones need no rebinding.
+    std::shared_ptr<estun::ResourceTable> resourceTable = std::make_shared<estun::ResourceTable>();
+    estun::TextureStreamingConfig textureStreaming;
+    textureStreaming.enabled = true;
+    std::shared_ptr<estun::TextureCache> textureCache = std::make_shared<estun::TextureCache>("cache/textures");
+    std::shared_ptr<estun::ThreadPool> threadPool = std::make_shared<estun::ThreadPool>();
+    std::shared_ptr<estun::TextureManager> textureManager = std::make_shared<estun::TextureManager>(threadPool, textureCache, textureStreaming, resourceTable);
+    textureManager->Flush();
+
+    estun::MeshOptimizer::Optimize(models, threadPool);
+
+    estun::SceneConfig sceneConfig;
+    sceneConfig.clusters.maxTriangles = 1 << 18;
+    sceneConfig.updatableTLAS = true;
+    sceneConfig.secondaryLodBias = 1;
+
+    std::shared_ptr<estun::AccelerationStructureCache> blasCache = std::make_shared<estun::AccelerationStructureCache>("cache/blas");
+    std::shared_ptr<estun::HostBLASBuilder> hostBuilder;
+    if (estun::HostBLASBuilder::IsSupported())
+    {
+        hostBuilder = std::make_shared<estun::HostBLASBuilder>(threadPool);
+    }
+    std::shared_ptr<estun::Scene> scene = std::make_shared<estun::Scene>(sceneConfig, blasCache, hostBuilder, resourceTable);
 
-    // If there are no texture, add a dummy one. It makes the pipeline setup a lot easier.
-    if (textures.empty())
+    std::vector<uint32_t> modelHandles;
+    for (size_t i = 0; i < models.size(); i++)
     {
-        textures.push_back(estun::Texture("assets/textures/white.png"));
+        modelHandles.push_back(scene->AddModel(models[i], i == twistedBoxIndex));
     }
 
-    std::vector<estun::Vertex> vertices;
-    std::vector<uint32_t> indices;
-    std::vector<estun::Material> materials;
-    std::vector<glm::uvec2> offsets;
+    const std::vector<estun::Sphere> sphereParams = {{glm::vec3(0.2f * box_scale, -0.5f * box_scale + 0.4f, -2.0f), 0.4f}};
+    std::shared_ptr<estun::ProceduralSpheres> spheres = std::make_shared<estun::ProceduralSpheres>(sphereParams, std::vector<uint32_t>(sphereParams.size(), scene->AddMaterials({colorMaterial})), SphereHitGroup);
+    std::shared_ptr<estun::BLAS> sphereBlas = std::make_shared<estun::BLAS>(spheres->GetBLASGeometry());
+    scene->AddInstance(sphereBlas);
+    spheres->ReleaseAabbs();
+
+    const glm::vec3 waterOrigin(-0.5f * surface_scale, -0.5f * box_scale - 0.3f, -0.5f * surface_scale - 1.5f);
+    std::shared_ptr<WaterSurface> water = std::make_shared<WaterSurface>(surface_size, surface_scale, waterOrigin, scene->AddMaterials({estun::Material::Lambertian(glm::vec3(0.2f, 0.4f, 0.6f))}), WaterHitGroup);
+    scene->AddInstance(water->GetBLAS());
 
-    for (const auto &model : models)
+    std::shared_ptr<estun::Model> marker = std::make_shared<estun::Model>(estun::Model::CreateSphere(glm::vec3(0.0f), 0.04f, estun::Material::Lambertian(glm::vec3(0.8f, 0.3f, 0.1f))));
+    marker->GenerateLods(2);
+    std::vector<uint32_t> markerHandles = {scene->AddPrototype(marker)};
+    for (const auto &lod : marker->GetLods())
     {
-        const auto indexOffset = static_cast<uint32_t>(indices.size());
-        const auto vertexOffset = static_cast<uint32_t>(vertices.size());
-        const auto materialOffset = static_cast<uint32_t>(materials.size());
+        markerHandles.push_back(scene->AddPrototype(lod));
+    }
 
-        offsets.emplace_back(indexOffset, vertexOffset);
+    auto pixelsPerUnit = [&]() {
+        return info.height_ / (2.0f * glm::tan(0.5f * glm::radians(camera.Zoom)));
+    };
 
-        vertices.insert(vertices.end(), model->GetVertices().begin(), model->GetVertices().end());
-        indices.insert(indices.end(), model->GetIndices().begin(), model->GetIndices().end());
-        materials.insert(materials.end(), model->GetMaterials().begin(), model->GetMaterials().end());
+    scene->Commit();
 
-        for (size_t i = vertexOffset; i != vertices.size(); ++i)
-        {
-            vertices[i].materialIndex += materialOffset;
-        }
+    // Markers floating around the water, expanded into TLAS instances on the device every frame
+    estun::ScatterPrototype markerPrototype;
+    for (size_t lod = 0; lod < markerHandles.size(); lod++)
+    {
+        // A level is kept until the next one's error drops below the pixel budget, the last one until the markers are culled
+        markerPrototype.lods.push_back(scene->GetBLASes(markerHandles[lod]).front());
+        markerPrototype.lodDistances.push_back(lod < marker->GetLodErrors().size() ? marker->GetLodErrors()[lod] * pixelsPerUnit() / maxLodPixelError : 0.5f * surface_scale);
     }
+    estun::ScatterRegion markerRegion = {};
+    markerRegion.centerRadius = glm::vec4(waterOrigin + glm::vec3(0.5f * surface_scale, 0.0f, 0.5f * surface_scale), 0.45f * surface_scale);
+    markerRegion.scaleRange = glm::vec2(0.5f, 1.5f);
+    markerRegion.seed = 7;
+    markerRegion.instanceCount = 1 << 14;
+    std::shared_ptr<estun::ScatterSet> markers = std::make_shared<estun::ScatterSet>(std::vector<estun::ScatterPrototype>{markerPrototype}, std::vector<estun::ScatterRegion>{markerRegion}, "assets/shaders/scatter.comp.spv");
+    scene->AddScatter(markers);
+    scene->Commit();
+
+    // The procedural sphere hangs below a bobbing parent, its instance transform comes from the graph
+    std::shared_ptr<estun::SceneGraph> sceneGraph = std::make_shared<estun::SceneGraph>(threadPool);
+    const uint32_t sphereParentNode = sceneGraph->CreateNode();
+    const uint32_t sphereNode = sceneGraph->CreateNode(sphereParentNode);
+    sceneGraph->SetInstance(sphereNode, scene->GetInstanceIndex(sphereBlas));
+
+    // The tall box twists around its vertical axis, the bottom follows joint 0 and the top joint 1
+    const auto &boxVertices = models[twistedBoxIndex]->GetVertices();
+    glm::vec3 boxMin(std::numeric_limits<float>::max());
+    glm::vec3 boxMax(std::numeric_limits<float>::lowest());
+    for (const auto &vertex : boxVertices)
+    {
+        boxMin = glm::min(boxMin, vertex.position);
+        boxMax = glm::max(boxMax, vertex.position);
+    }
+    const glm::mat4 twistPivot = glm::translate(glm::mat4(1.0f), 0.5f * (boxMin + boxMax));
 
-    std::shared_ptr<estun::VertexBuffer> VB = std::make_shared<estun::VertexBuffer>(vertices);
-    std::shared_ptr<estun::IndexBuffer> IB = std::make_shared<estun::IndexBuffer>(indices);
-    std::shared_ptr<estun::StorageBuffer<estun::Material>> materialBuffer = std::make_shared<estun::StorageBuffer<estun::Material>>(materials);
-    std::shared_ptr<estun::StorageBuffer<glm::uvec2>> offsetBuffer = std::make_shared<estun::StorageBuffer<glm::uvec2>>(offsets);
-
-    std::vector<std::shared_ptr<estun::BLAS>> blases = estun::BLAS::CreateBlases(models, VB, IB);
-    std::shared_ptr<estun::TLAS> tlas = std::make_shared<estun::TLAS>(blases);
+    std::vector<estun::SkinWeights> boxSkin;
+    for (const auto &vertex : boxVertices)
+    {
+        const float top = (vertex.position.y - boxMin.y) / (boxMax.y - boxMin.y);
+        boxSkin.push_back({glm::uvec4(0, 1, 0, 0), glm::vec4(1.0f - top, top, 0.0f, 0.0f)});
+    }
+    std::shared_ptr<estun::DeformableMesh> twistedBox = std::make_shared<estun::DeformableMesh>(
+        *models[twistedBoxIndex], scene->GetDeformTarget(modelHandles[twistedBoxIndex]), boxSkin, std::vector<std::vector<estun::MorphDelta>>(), "assets/shaders/skin.comp.spv");
 
     auto extent = estun::ContextLocator::GetSwapChain()->GetExtent();
-    std::shared_ptr<estun::Image> storeImage = estun::Image::CreateStorageImage(extent.width, extent.height, estun::ContextLocator::GetSwapChain()->GetFormat());
+    std::shared_ptr<estun::Image> storeImage = estun::Image::CreateStorageImage(extent.width, extent.height, VK_FORMAT_R32G32B32A32_SFLOAT);
     storeImage->ToLayout(VK_IMAGE_LAYOUT_GENERAL);
     std::shared_ptr<estun::Image> accumulationImage = estun::Image::CreateStorageImage(extent.width, extent.height, VK_FORMAT_R32G32B32A32_SFLOAT);
     accumulationImage->ToLayout(VK_IMAGE_LAYOUT_GENERAL);
-
-    std::vector<estun::DescriptorBinding> descriptorBindings = {
-        estun::DescriptorBinding::AccelerationStructure(0, tlas, VK_SHADER_STAGE_RAYGEN_BIT_KHR),
-        estun::DescriptorBinding::StorageImage(1, storeImage, VK_SHADER_STAGE_RAYGEN_BIT_KHR),
-        estun::DescriptorBinding::StorageImage(2, accumulationImage, VK_SHADER_STAGE_RAYGEN_BIT_KHR),
-        estun::DescriptorBinding::Uniform(3, camUBs, VK_SHADER_STAGE_RAYGEN_BIT_KHR),
-        estun::DescriptorBinding::Storage(4, VB, VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR),
-        estun::DescriptorBinding::Storage(5, IB, VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR),
-        estun::DescriptorBinding::Storage(6, materialBuffer, VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR),
-        estun::DescriptorBinding::Storage(7, offsetBuffer, VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR),
-        estun::DescriptorBinding::Textures(8, textures, VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR)};
-
-    std::shared_ptr<estun::Descriptor> descriptor = std::make_shared<estun::Descriptor>(descriptorBindings, context->GetSwapChain()->GetImageViews().size());
-    descriptorBindings.clear();
+    std::shared_ptr<estun::Image> upscaledImage = estun::Image::CreateStorageImage(extent.width, extent.height, estun::ContextLocator::GetSwapChain()->GetFormat());
+    upscaledImage->ToLayout(VK_IMAGE_LAYOUT_GENERAL);
+
+    // The store and accumulation images are allocated at the full extent, only the top left part is traced
+    estun::DynamicResolutionConfig resolutionConfig;
+    resolutionConfig.targetMilliseconds = targetFrameTime;
+    estun::DynamicResolution resolution(resolutionConfig);
+    VkExtent2D traceExtent = resolution.GetExtent(extent);
+
+    std::shared_ptr<estun::Upscaler> upscaler = std::make_shared<estun::Upscaler>("assets/shaders/upscale.comp.spv");
+    upscaler->SetImages(storeImage, upscaledImage);
+
+    estun::SampleControllerConfig sampleConfig;
+    sampleConfig.targetMilliseconds = targetFrameTime;
+    sampleConfig.minSamples = minSamplesPerFrame;
+    sampleConfig.maxSamples = maxSamplesPerFrame;
+    estun::SampleController sampleController(sampleConfig);
+
+    std::shared_ptr<estun::GpuTimer> frameTimer = std::make_shared<estun::GpuTimer>(
+        static_cast<uint32_t>(context->GetSwapChain()->GetImageViews().size()), estun::DeviceLocator::GetDevice().GetQueueFamilyIndices().computeFamily.value(), 2);
+    // Samples traced by the last frame on each image, matched with its times once it comes around again
+    std::vector<uint32_t> tracedSamples(context->GetSwapChain()->GetImageViews().size(), 0);
+
+    // The TLAS is replaced when models come and go, the sets are rewritten from here
+    auto createBindings = [&]() {
+        return std::vector<estun::DescriptorBinding>{
+            estun::DescriptorBinding::AccelerationStructure(0, scene->GetTLAS(), VK_SHADER_STAGE_RAYGEN_BIT_KHR),
+            estun::DescriptorBinding::StorageImage(1, storeImage, VK_SHADER_STAGE_RAYGEN_BIT_KHR),
+            estun::DescriptorBinding::StorageImage(2, accumulationImage, VK_SHADER_STAGE_RAYGEN_BIT_KHR),
+            estun::DescriptorBinding::Uniform(3, camUBs, VK_SHADER_STAGE_RAYGEN_BIT_KHR),
+            estun::DescriptorBinding::Storage(10, spheres->GetSphereBuffer(), VK_SHADER_STAGE_INTERSECTION_BIT_KHR | VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR),
+            estun::DescriptorBinding::Storage(11, spheres->GetMaterialIndexBuffer(), VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR),
+            estun::DescriptorBinding::Storage(12, water->GetNormalBuffer(), VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR),
+            estun::DescriptorBinding::Uniform(13, water->GetUniformBuffers(), VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR),
+            estun::DescriptorBinding::Storage(14, textureManager->GetFeedbackBuffers(), VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR)};
+    };
+
+    std::shared_ptr<estun::Descriptor> descriptor = std::make_shared<estun::Descriptor>(createBindings(), context->GetSwapChain()->GetImageViews().size(), resourceTable);
 
     std::shared_ptr<estun::RayTracingRender> render = context->CreateRayTracingRender();
 
     std::vector<std::vector<estun::Shader>> shaderGroups = {
-        {{"../assets/shaders/main.rgen.spv", VK_SHADER_STAGE_RAYGEN_BIT_KHR}},
-        {{"../assets/shaders/main.rmiss.spv", VK_SHADER_STAGE_MISS_BIT_KHR}},
-        {{"../assets/shaders/main.rchit.spv", VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR}}};
+        {{"assets/shaders/main.rgen.spv", VK_SHADER_STAGE_RAYGEN_BIT_KHR}},
+        {{"assets/shaders/main.rmiss.spv", VK_SHADER_STAGE_MISS_BIT_KHR}},
+        {{"assets/shaders/main.rchit.spv", VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR}},
+        {{"assets/shaders/sphere.rint.spv", VK_SHADER_STAGE_INTERSECTION_BIT_KHR}, {"assets/shaders/sphere.rchit.spv", VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR}},
+        {{"assets/shaders/water.rchit.spv", VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR}}};
 
-    std::shared_ptr<estun::RayTracingPipeline> pipeline = render->CreatePipeline(shaderGroups, descriptor);
+    std::shared_ptr<estun::PipelinePermutations> permutations = std::make_shared<estun::PipelinePermutations>(render, shaderGroups, descriptor);
     shaderGroups.clear();
 
-    std::shared_ptr<estun::ShaderBindingTable> shaderBindingTable = std::make_shared<estun::ShaderBindingTable>(pipeline);
-
-    context->WriteBuffers([&]() {
+    const estun::SceneBufferHandles &sceneBuffers = scene->GetBufferHandles();
+    for (const auto &preset : presets)
+    {
+        estun::SpecializationConstants constants;
+        constants.Set(MaxSamplesId, preset.second.samples).Set(MaxBouncesId, preset.second.bounces).Set(UseTexturesId, preset.second.textures);
+        constants.Set(AttributeBufferId, sceneBuffers.attributes).Set(IndexBufferId, sceneBuffers.indices).Set(MaterialBufferId, sceneBuffers.materials);
+        constants.Set(OffsetBufferId, sceneBuffers.offsets).Set(MaterialIdBufferId, sceneBuffers.materialIds);
+        permutations->Add(preset.first, constants);
+    }
+    permutations->Select("final");
+
+    // The passes of a frame only declare what they use, the graph places the barriers and layout transitions.
+    // They are recorded on their own threads and run in this order.
+    std::shared_ptr<estun::RenderGraph> frameGraph = std::make_shared<estun::RenderGraph>();
+    const uint32_t waterNormalsResource = frameGraph->ImportBuffer("water normals");
+    const uint32_t waterBlasResource = frameGraph->ImportBuffer("water blas");
+    const uint32_t tlasResource = frameGraph->ImportBuffer("tlas");
+    const uint32_t feedbackResource = frameGraph->ImportBuffer("texture feedback", estun::ResourceUsage::HostRead);
+    const uint32_t storeResource = frameGraph->ImportImage("store", storeImage);
+    const uint32_t accumulationResource = frameGraph->ImportImage("accumulation", accumulationImage);
+    const uint32_t upscaledResource = frameGraph->ImportImage("upscaled", upscaledImage);
+    const uint32_t swapChainResource = frameGraph->ImportSwapChainImage("swap chain");
+
+    frameGraph->AddPass(
+        "water",
+        {{waterNormalsResource, estun::ResourceUsage::ComputeWrite},
+         {waterBlasResource, estun::ResourceUsage::AccelerationStructureWrite}},
+        [&](VkCommandBuffer commandBuffer) {
+            water->Record(commandBuffer);
+        });
+    frameGraph->AddPass(
+        "scene",
+        {{waterBlasResource, estun::ResourceUsage::AccelerationStructureBuildInput},
+         {tlasResource, estun::ResourceUsage::AccelerationStructureWrite}},
+        [&](VkCommandBuffer commandBuffer) {
+            scene->Record(commandBuffer);
+        });
+    frameGraph->AddPass(
+        "trace",
+        {{tlasResource, estun::ResourceUsage::AccelerationStructureRead},
+         {waterBlasResource, estun::ResourceUsage::AccelerationStructureRead},
+         {waterNormalsResource, estun::ResourceUsage::RayTracingRead},
+         {storeResource, estun::ResourceUsage::RayTracingWrite},
+         {accumulationResource, estun::ResourceUsage::RayTracingWrite},
+         {feedbackResource, estun::ResourceUsage::RayTracingWrite}},
+        [&](VkCommandBuffer commandBuffer) {
+            frameTimer->Begin(commandBuffer, context->GetImageIndex(), TraceInterval);
+            permutations->GetPipeline()->Bind(commandBuffer);
+            descriptor->Bind(commandBuffer, VK_PIPELINE_BIND_POINT_RAY_TRACING_KHR);
+            render->TraceRays(commandBuffer, permutations->GetShaderBindingTable(), storeImage->GetImage().GetWidth(), storeImage->GetImage().GetHeight());
+            frameTimer->End(commandBuffer, context->GetImageIndex(), TraceInterval);
+        });
+    frameGraph->AddPass(
+        "upscale",
+        {{storeResource, estun::ResourceUsage::ComputeRead},
+         {upscaledResource, estun::ResourceUsage::ComputeWrite}},
+        [&](VkCommandBuffer commandBuffer) {
+            upscaler->Record(commandBuffer);
+        });
+    frameGraph->AddPass(
+        "present",
+        {{upscaledResource, estun::ResourceUsage::TransferRead},
+         {swapChainResource, estun::ResourceUsage::TransferWrite}},
+        [&](VkCommandBuffer commandBuffer) {
+            context->CopyImageToSwapChain(commandBuffer, upscaledImage);
+        });
+
+    std::shared_ptr<estun::CommandRecorder> recorder = std::make_shared<estun::CommandRecorder>(estun::Compute, threadPool);
+    auto recordCommands = [&]() {
         render->BeginBuffer();
-        render->Bind(pipeline);
-        render->Bind(descriptor);
-        render->TraceRays(shaderBindingTable, storeImage->GetImage().GetWidth(), storeImage->GetImage().GetHeight());
-        context->CopyImageToSwapChain(render->GetCurrCommandBuffer(), storeImage);
+        frameTimer->Begin(render->GetCurrCommandBuffer(), context->GetImageIndex(), FrameInterval);
+        frameGraph->Record(render->GetCurrCommandBuffer(), context->GetImageIndex(), recorder.get());
+        frameTimer->End(render->GetCurrCommandBuffer(), context->GetImageIndex(), FrameInterval);
         render->EndBuffer();
+    };
+
+    context->WriteBuffers(recordCommands);
+
+    // Only the output images follow the window, the traced part keeps the current scale, pipelines, the scene and the textures stay as they are
+    context->AddResizeListener([&](const VkExtent2D &extent) {
+        storeImage = estun::Image::CreateStorageImage(extent.width, extent.height, VK_FORMAT_R32G32B32A32_SFLOAT);
+        storeImage->ToLayout(VK_IMAGE_LAYOUT_GENERAL);
+        accumulationImage = estun::Image::CreateStorageImage(extent.width, extent.height, VK_FORMAT_R32G32B32A32_SFLOAT);
+        accumulationImage->ToLayout(VK_IMAGE_LAYOUT_GENERAL);
+        upscaledImage = estun::Image::CreateStorageImage(extent.width, extent.height, estun::ContextLocator::GetSwapChain()->GetFormat());
+        upscaledImage->ToLayout(VK_IMAGE_LAYOUT_GENERAL);
+        frameGraph->SetImage(storeResource, storeImage);
+        frameGraph->SetImage(accumulationResource, accumulationImage);
+        frameGraph->SetImage(upscaledResource, upscaledImage);
+        upscaler->SetImages(storeImage, upscaledImage);
+        traceExtent = resolution.GetExtent(extent);
+        resolution.Reset();
+        sampleController.Reset();
+        descriptor->Update(createBindings());
+        context->RewriteBuffers(recordCommands);
+        restartSampling = true;
     });
 
     uint32_t fps = 0;
     double timeSum = 0;
+    float frameMilliseconds = 0.0f;
+    bool frameTimed = false;
+    bool rebuild = false;
 
     while (!glfwWindowShouldClose(window->GetWindow()))
     {
@@ -201,6 +470,74 @@ int main(int argc, const char **argv)
         lastFrame = currFrame;
         glfwPollEvents();
 
+        // A minimized window has no swap chain extent to render to
+        if (window->IsMinimized())
+        {
+            window->WaitForEvents();
+            continue;
+        }
+
+        // The resolution only follows the budget while moving, still frames fill it with samples instead.
+        // A new scale only reaches the uniforms, the accumulated samples were traced at the old one.
+        if (frameTimed && permutations->GetCurrentPreset() == "preview" && resolution.Update(frameMilliseconds))
+        {
+            traceExtent = resolution.GetExtent(context->GetSwapChain()->GetExtent());
+            restartSampling = true;
+        }
+        frameTimed = false;
+
+        if (restartSampling)
+        {
+            lastMoveTime = currFrame;
+        }
+
+        if (toggleExtraModel)
+        {
+            toggleExtraModel = false;
+            if (extraModelHandle != noModel)
+            {
+                scene->RemoveModel(extraModelHandle);
+                extraModelHandle = noModel;
+            }
+            else
+            {
+                const estun::Material extraMaterial = estun::Material::Metallic(glm::vec3(0.8f, 0.7f, 0.4f), 0.05f);
+                std::shared_ptr<estun::Model> extraModel = std::make_shared<estun::Model>(estun::Model::CreateSphere(glm::vec3(-0.25f * box_scale, -0.5f * box_scale + 0.3f, -1.2f), 0.3f, extraMaterial));
+                extraModel->GenerateLods(3);
+                extraModelHandle = scene->AddModel(extraModel);
+            }
+
+            if (scene->Commit())
+            {
+                descriptor->Update(createBindings());
+                twistedBox->SetTarget(scene->GetDeformTarget(modelHandles[twistedBoxIndex]));
+                sceneGraph->SetInstance(sphereNode, scene->GetInstanceIndex(sphereBlas));
+                sceneGraph->Invalidate();
+                context->RewriteBuffers(recordCommands);
+            }
+            restartSampling = true;
+        }
+
+        if (permutations->Select(currFrame - lastMoveTime < previewHoldTime ? "preview" : "final"))
+        {
+            // Still frames accumulate at the full extent
+            if (permutations->GetCurrentPreset() == "final" && resolution.Maximize())
+            {
+                traceExtent = resolution.GetExtent(context->GetSwapChain()->GetExtent());
+            }
+            context->RewriteBuffers(recordCommands);
+            resolution.Reset();
+            sampleController.Reset();
+            restartSampling = true;
+        }
+
+        // Moving geometry invalidates the accumulated image every frame without counting as camera input
+        if (animateScene)
+        {
+            sceneTime += deltaTime;
+            camUBO.totalNumberOfSamples = 0;
+        }
+
         if (restartSampling)
         {
             camUBO.numberOfSamples = 0;
@@ -208,52 +545,93 @@ int main(int argc, const char **argv)
             restartSampling = false;
         }
 
-        camUBO.numberOfSamples = glm::clamp(maxNumberOfSamples - camUBO.totalNumberOfSamples, 0u, numberOfSamples);
+        // Moving frames trace the preset's few samples, still ones as many as the budget allows
+        const QualityPreset &preset = presets[permutations->GetCurrentPreset()];
+        const uint32_t frameSamples = permutations->GetCurrentPreset() == "final" ? std::min(sampleController.GetSamples(), preset.samples) : preset.samples;
+        camUBO.numberOfBounces = preset.bounces;
+        camUBO.numberOfSamples = glm::clamp(maxNumberOfSamples - camUBO.totalNumberOfSamples, 0u, frameSamples);
         camUBO.totalNumberOfSamples += camUBO.numberOfSamples;
 
-        context->StartDraw();
+        if (!context->StartDraw())
+        {
+            rebuild = true;
+            break;
+        }
+
+        // The frame that last used the acquired image has finished
+        float traceMilliseconds = 0.0f;
+        frameTimed = frameTimer->GetMilliseconds(context->GetImageIndex(), frameMilliseconds, FrameInterval);
+        if (frameTimed && frameTimer->GetMilliseconds(context->GetImageIndex(), traceMilliseconds, TraceInterval))
+        {
+            sampleController.Update(traceMilliseconds, frameMilliseconds, tracedSamples[context->GetImageIndex()]);
+        }
+        tracedSamples[context->GetImageIndex()] = camUBO.numberOfSamples;
+
+        // Replaced textures and scene buffers reach this image's table set now that its last frame is done,
+        // the recorded commands stay valid
+        textureManager->Update(context->GetImageIndex());
+        resourceTable->Update(context->GetImageIndex());
 
         camUBO.camPos = glm::vec4(camera.Position, 1.0f);
         camUBO.camDir = glm::vec4(camera.Front, 1.0f);
         camUBO.camUp = glm::vec4(camera.Up, 1.0f);
         camUBO.camSide = glm::vec4(camera.Right, 1.0f);
         camUBO.camNearFarFov = glm::vec4(0.01f, 100.0f, glm::radians(camera.Zoom), 1.0f);
+        camUBO.traceWidth = traceExtent.width;
+        camUBO.traceHeight = traceExtent.height;
 
         camUBs[context->GetImageIndex()].SetValue(camUBO);
+        upscaler->SetSourceExtent(traceExtent, context->GetImageIndex());
+        water->SetTime(sceneTime, context->GetImageIndex());
+        markers->SetCamera(camera.Position, context->GetImageIndex());
+        scene->SelectLods(camera.Position, pixelsPerUnit(), maxLodPixelError, context->GetImageIndex());
+
+        if (animateScene)
+        {
+            const float twist = glm::radians(30.0f) * glm::sin(sceneTime);
+            twistedBox->SetPose({glm::mat4(1.0f), twistPivot * glm::rotate(glm::mat4(1.0f), twist, glm::vec3(0.0f, 1.0f, 0.0f)) * glm::inverse(twistPivot)});
+            twistedBox->Submit();
+
+            sceneGraph->SetLocal(sphereParentNode, glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.1f * glm::sin(2.0f * sceneTime), 0.0f)));
+        }
+        sceneGraph->Flatten(*scene->GetTLAS(), context->GetImageIndex());
 
         context->SubmitDraw();
 
-        /*
         timeSum += deltaTime;
         fps++;
         if (timeSum >= 1.0f)
         {
-            ES_CORE_INFO(std::to_string(fps));
+            ES_CORE_INFO("{0} fps, {1} ms on the device, traced at {2}% ({3}x{4}), {5} samples per frame at {6} ms each",
+                         fps, frameMilliseconds, static_cast<uint32_t>(resolution.GetScale() * 100.0f + 0.5f), traceExtent.width, traceExtent.height,
+                         camUBO.numberOfSamples, sampleController.GetSampleMilliseconds());
             fps = 0;
             timeSum = 0;
         }
-        */
     }
 
-    pipeline.reset();
+    permutations.reset();
     render.reset();
-    context->Clear();
-    blases.clear();
-    tlas.reset();
-    shaderBindingTable.reset();
+    context->ClearFrames();
+    recorder.reset();
+    frameGraph.reset();
+    upscaler.reset();
+    frameTimer.reset();
+    twistedBox.reset();
+    sceneGraph.reset();
+    sphereBlas.reset();
+    markers.reset();
+    scene.reset();
     storeImage.reset();
     accumulationImage.reset();
+    upscaledImage.reset();
     camUBs.clear();
-    VB.reset();
-    IB.reset();
-    materialBuffer.reset();
-    offsetBuffer.reset();
-    textures.clear();
-    materialBuffer.reset();
+    spheres.reset();
+    water.reset();
+    textureManager.reset();
     descriptor.reset();
-    window.reset();
-    context.reset();
-    return 0;
+    resourceTable.reset();
+    return rebuild;
 }
 
 bool cursor = false;
@@ -288,6 +666,13 @@ void processInput(int key, int scancode, int action, int mods)
     }
     if (key == GLFW_KEY_Q && action == GLFW_PRESS)
         wireframe = !wireframe;
+    if (key == GLFW_KEY_P && action == GLFW_PRESS)
+    {
+        animateScene = !animateScene;
+        restartSampling = true;
+    }
+    if (key == GLFW_KEY_B && action == GLFW_PRESS)
+        toggleExtraModel = true;
     if (key == GLFW_KEY_C && action == GLFW_PRESS)
     {
         window->ToggleCursor(!cursor);
@@ -331,6 +716,57 @@ void mouse_button_callback(int button, int action, int mods)
 
 void framebuffer_size_callback(int width, int height)
 {
-    info.width_ = width;
-    info.height_ = height;
+    estun::ContextLocator::GetContext()->Resize(width, height);
+}
+
+void RunSphereBenchmark(uint32_t count)
+{
+    std::mt19937 random(1);
+    std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+    std::uniform_real_distribution<float> radius(0.05f, 0.5f);
+
+    std::vector<estun::Sphere> spheres(count);
+    for (auto &sphere : spheres)
+    {
+        sphere.center = glm::vec3(position(random), position(random), position(random));
+        sphere.radius = radius(random);
+    }
+
+    {
+        const auto start = std::chrono::high_resolution_clock::now();
+        estun::ProceduralSpheres procedural(spheres, std::vector<uint32_t>(count, 0), SphereHitGroup);
+        estun::BLAS blas(procedural.GetBLASGeometry());
+        const auto elapsed = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+        ES_CORE_INFO("Procedural: {0} spheres, {1} bytes of buffers, {2} bytes of BLAS, {3} ms", count, procedural.GetSize(), blas.GetSize(), elapsed);
+    }
+
+    // Tessellating every sphere would not fit in memory, the triangle path is measured on a subset and scaled
+    const uint32_t tessellatedCount = std::min(count, 8192u);
+    const estun::Material material = estun::Material::Lambertian(glm::vec3(0.5f));
+
+    std::vector<estun::Vertex> vertices;
+    std::vector<uint32_t> indices;
+    for (uint32_t i = 0; i < tessellatedCount; i++)
+    {
+        const estun::Model sphere = estun::Model::CreateSphere(spheres[i].center, spheres[i].radius, material);
+        const uint32_t vertexOffset = static_cast<uint32_t>(vertices.size());
+        vertices.insert(vertices.end(), sphere.GetVertices().begin(), sphere.GetVertices().end());
+        for (const uint32_t index : sphere.GetIndices())
+        {
+            indices.push_back(vertexOffset + index);
+        }
+    }
+
+    const std::vector<std::shared_ptr<estun::Model>> models = {
+        std::make_shared<estun::Model>("spheres", std::move(vertices), std::move(indices), std::vector<estun::Material>{material})};
+
+    const auto start = std::chrono::high_resolution_clock::now();
+    estun::CompactGeometry geometry(models);
+    estun::BLAS blas(geometry.GetBLASGeometries().front());
+    const auto elapsed = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+    const float scale = static_cast<float>(count) / tessellatedCount;
+    ES_CORE_INFO("Triangles: {0} spheres, {1} bytes of buffers, {2} bytes of BLAS, {3} ms", tessellatedCount, geometry.GetSize(), blas.GetSize(), elapsed);
+    ES_CORE_INFO("Triangles scaled to {0} spheres: {1} bytes, {2} ms", count, static_cast<uint64_t>((geometry.GetSize() + blas.GetSize()) * scale), elapsed * scale);
 }
@@ -0,0 +1,126 @@
+#include "water_surface.h"
+#include "renderer/context.h"
+#include "renderer/context/pipeline_barrier.h"
+#include "renderer/context/single_time_commands.h"
+#include "renderer/material/descriptor_binding.h"
+
+namespace
+{
+	const uint32_t groupSize = 16;
+}
+
+WaterSurface::WaterSurface(uint32_t size, float scale, const glm::vec3 &origin, uint32_t materialIndex, uint32_t hitGroup)
+{
+	ubo = {};
+	ubo.origin = glm::vec4(origin, scale);
+	ubo.waves[0] = glm::vec4(glm::normalize(glm::vec2(1.0f, 0.3f)), 0.25f, scale * 0.4f);
+	ubo.waves[1] = glm::vec4(glm::normalize(glm::vec2(-0.4f, 1.0f)), 0.2f, scale * 0.23f);
+	ubo.waves[2] = glm::vec4(glm::normalize(glm::vec2(0.7f, -0.8f)), 0.15f, scale * 0.11f);
+	ubo.waves[3] = glm::vec4(glm::normalize(glm::vec2(-1.0f, -0.2f)), 0.1f, scale * 0.06f);
+	ubo.time = 0.0f;
+	ubo.size = size;
+	ubo.materialIndex = materialIndex;
+	ubo.waveCount = 4;
+
+	// Two triangles per cell, water.rchit derives the same corners from gl_PrimitiveID
+	std::vector<uint32_t> indices;
+	indices.reserve((size - 1) * (size - 1) * 6);
+	for (uint32_t z = 0; z + 1 < size; z++)
+	{
+		for (uint32_t x = 0; x + 1 < size; x++)
+		{
+			const uint32_t corner = z * size + x;
+			indices.insert(indices.end(), {corner, corner + size, corner + 1, corner + 1, corner + size, corner + size + 1});
+		}
+	}
+
+	const VkBufferUsageFlags usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
+	positionBuffer = std::make_shared<estun::StorageBuffer<float>>(std::vector<float>(size * size * 3, 0.0f), usage);
+	normalBuffer = std::make_shared<estun::StorageBuffer<uint32_t>>(std::vector<uint32_t>(size * size, 0));
+	indexBuffer = std::make_shared<estun::StorageBuffer<uint32_t>>(indices, usage | VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+
+	const size_t imageCount = estun::ContextLocator::GetSwapChain()->GetImageViews().size();
+	uniformBuffers = std::vector<estun::UniformBuffer<WaterUBO>>(imageCount);
+	for (auto &uniformBuffer : uniformBuffers)
+	{
+		uniformBuffer.SetValue(ubo);
+	}
+
+	std::vector<estun::DescriptorBinding> bindings = {
+		estun::DescriptorBinding::Storage(0, positionBuffer, VK_SHADER_STAGE_COMPUTE_BIT),
+		estun::DescriptorBinding::Storage(1, normalBuffer, VK_SHADER_STAGE_COMPUTE_BIT),
+		estun::DescriptorBinding::Uniform(2, uniformBuffers, VK_SHADER_STAGE_COMPUTE_BIT)};
+
+	descriptor = std::make_shared<estun::Descriptor>(bindings, imageCount);
+	pipeline = std::make_shared<estun::ComputePipeline>("assets/shaders/water.comp.spv", descriptor);
+
+	// Displace once before the first build so refits start from a tree that fits the waves
+	estun::SingleTimeCommands::SubmitCompute([this](VkCommandBuffer commandBuffer) {
+		Dispatch(commandBuffer);
+		estun::PipelineBarrier::Insert(
+			commandBuffer,
+			VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR);
+	}, "displace water");
+
+	estun::BLASGeometry geometry = {};
+	geometry.vertexAddress = positionBuffer->GetDeviceAddress();
+	geometry.vertexStride = 3 * sizeof(float);
+	geometry.indexAddress = indexBuffer->GetDeviceAddress();
+	geometry.indexType = VK_INDEX_TYPE_UINT32;
+	geometry.vertexCount = size * size;
+	geometry.indexCount = static_cast<uint32_t>(indices.size());
+	geometry.vertexOffset = 0;
+	geometry.indexOffset = 0;
+	geometry.allowUpdate = true;
+	geometry.hitGroup = hitGroup;
+
+	blas = std::make_shared<estun::BLAS>(geometry);
+}
+
+WaterSurface::~WaterSurface()
+{
+	blas.reset();
+	pipeline.reset();
+	descriptor.reset();
+	uniformBuffers.clear();
+	positionBuffer.reset();
+	normalBuffer.reset();
+	indexBuffer.reset();
+}
+
+void WaterSurface::Dispatch(VkCommandBuffer commandBuffer)
+{
+	pipeline->Bind(commandBuffer);
+	descriptor->Bind(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE);
+	vkCmdDispatch(commandBuffer, (ubo.size + groupSize - 1) / groupSize, (ubo.size + groupSize - 1) / groupSize, 1);
+}
+
+void WaterSurface::Record(VkCommandBuffer commandBuffer)
+{
+	// Earlier frames may still trace against the normals and refit from the positions
+	estun::PipelineBarrier::Insert(
+		commandBuffer,
+		VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR, VK_ACCESS_SHADER_WRITE_BIT,
+		VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR | VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+
+	Dispatch(commandBuffer);
+
+	estun::PipelineBarrier::Insert(
+		commandBuffer,
+		VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR);
+
+	blas->Update(commandBuffer);
+
+	estun::PipelineBarrier::Insert(
+		commandBuffer,
+		VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR, VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR,
+		VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR, VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR);
+}
+
+void WaterSurface::SetTime(float time, uint32_t imageIndex)
+{
+	ubo.time = time;
+	uniformBuffers[imageIndex].SetValue(ubo);
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "renderer/buffers/storage_buffer.h"
+#include "renderer/buffers/uniform_buffer.h"
+#include "renderer/material/compute_pipeline.h"
+#include "renderer/material/descriptor.h"
+#include "renderer/ray_tracing/bottom_level_acceleration_structure.h"
+#include <vector>
+
+// Matches WaterUniforms in water.comp and water.rchit
+struct WaterUBO
+{
+	glm::vec4 origin;   // xyz corner of the grid, w edge length
+	glm::vec4 waves[4]; // xy direction, z steepness, w wavelength
+	float time;
+	uint32_t size;
+	uint32_t materialIndex;
+	uint32_t waveCount;
+};
+
+// Gerstner ocean displaced by a compute shader straight into a device local vertex buffer,
+// the BLAS is refit in the same command buffer so no vertex data ever crosses the bus per frame
+class WaterSurface
+{
+public:
+	WaterSurface(const WaterSurface &) = delete;
+	WaterSurface(WaterSurface &&) = delete;
+
+	WaterSurface &operator=(const WaterSurface &) = delete;
+	WaterSurface &operator=(WaterSurface &&) = delete;
+
+	WaterSurface(uint32_t size, float scale, const glm::vec3 &origin, uint32_t materialIndex, uint32_t hitGroup);
+	~WaterSurface();
+
+	// Displacement and BLAS refit with their barriers, the TLAS refit is left to the caller
+	void Record(VkCommandBuffer commandBuffer);
+	void SetTime(float time, uint32_t imageIndex);
+
+	std::shared_ptr<estun::BLAS> GetBLAS() { return blas; }
+	std::shared_ptr<estun::StorageBuffer<uint32_t>> GetNormalBuffer() { return normalBuffer; }
+	std::vector<estun::UniformBuffer<WaterUBO>> &GetUniformBuffers() { return uniformBuffers; }
+
+private:
+	void Dispatch(VkCommandBuffer commandBuffer);
+
+	WaterUBO ubo;
+
+	std::shared_ptr<estun::StorageBuffer<float>> positionBuffer;
+	std::shared_ptr<estun::StorageBuffer<uint32_t>> normalBuffer;
+	std::shared_ptr<estun::StorageBuffer<uint32_t>> indexBuffer;
+	std::vector<estun::UniformBuffer<WaterUBO>> uniformBuffers;
+
+	std::shared_ptr<estun::Descriptor> descriptor;
+	std::shared_ptr<estun::ComputePipeline> pipeline;
+	std::shared_ptr<estun::BLAS> blas;
+};